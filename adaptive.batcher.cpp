@@ -0,0 +1,118 @@
+#include "adaptive.batcher.hh"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace {
+size_t
+scale_down(size_t value, double factor, size_t min_value) {
+    return std::max(min_value,
+                    static_cast<size_t>(static_cast<double>(value) * factor));
+}
+} // namespace
+
+zarr::AdaptiveBatcher::Config
+zarr::AdaptiveBatcher::Config::for_device(const DeviceInfo& device) {
+    return for_device(device, Config{});
+}
+
+zarr::AdaptiveBatcher::Config
+zarr::AdaptiveBatcher::Config::for_device(const DeviceInfo& device,
+                                          Config base) {
+    Config config = base;
+    config.seed_from_device = false;
+    if (device.queue_depth > 0) {
+        // keep the device queue full from the start
+        config.initial_depth = std::clamp(
+          device.queue_depth, config.min_depth, config.max_depth);
+    }
+    if (device.rotational) {
+        // seeks dominate, so start with fewer, longer writes
+        config.initial_batch = 4 * config.initial_batch;
+    }
+    return config;
+}
+
+zarr::AdaptiveBatcher::AdaptiveBatcher(const Config& config)
+  : config_(config)
+  , batch_size_(std::clamp(config.initial_batch,
+                           config.min_batch,
+                           config.max_batch))
+  , queue_depth_(std::clamp(config.initial_depth,
+                            config.min_depth,
+                            config.max_depth))
+  , increases_(0)
+  , decreases_(0)
+  , window_writes_(0)
+  , window_bytes_(0)
+  , window_elapsed_(0)
+  , window_latency_(0)
+  , window_filled_batch_(false)
+  , last_throughput_(0) {
+    if (config.min_batch == 0 || config.min_batch > config.max_batch ||
+        config.min_depth == 0 || config.min_depth > config.max_depth) {
+        throw std::invalid_argument("Invalid batch or depth limits");
+    }
+    if (config.decrease_factor <= 0 || config.decrease_factor >= 1) {
+        throw std::invalid_argument("Decrease factor must be in (0, 1)");
+    }
+}
+
+void
+zarr::AdaptiveBatcher::record(size_t nchunks,
+                              size_t nbytes,
+                              std::chrono::nanoseconds elapsed,
+                              std::chrono::nanoseconds latency) {
+    ++window_writes_;
+    window_bytes_ += nbytes;
+    window_elapsed_ += elapsed;
+    window_latency_ = std::max(window_latency_, latency);
+    if (nchunks >= batch_size_.load(std::memory_order_relaxed)) {
+        window_filled_batch_ = true;
+    }
+
+    if (window_writes_ >= std::max<size_t>(config_.window, 1)) {
+        adjust_();
+    }
+}
+
+void
+zarr::AdaptiveBatcher::adjust_() {
+    const double seconds =
+      std::chrono::duration<double>(window_elapsed_).count();
+    const double throughput =
+      seconds > 0 ? static_cast<double>(window_bytes_) / seconds : 0;
+
+    size_t batch = batch_size_.load(std::memory_order_relaxed);
+    size_t depth = queue_depth_.load(std::memory_order_relaxed);
+
+    if (window_latency_ > config_.target_latency) {
+        batch = scale_down(batch, config_.decrease_factor, config_.min_batch);
+        depth = scale_down(depth, config_.decrease_factor, config_.min_depth);
+        decreases_.fetch_add(1, std::memory_order_relaxed);
+    } else if (throughput <
+               last_throughput_ * (1 - config_.throughput_tolerance)) {
+        batch = scale_down(batch, config_.decrease_factor, config_.min_batch);
+        decreases_.fetch_add(1, std::memory_order_relaxed);
+    } else {
+        if (window_filled_batch_) {
+            batch = std::min(batch + config_.batch_step, config_.max_batch);
+        }
+        depth = std::min(depth + config_.depth_step, config_.max_depth);
+        increases_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // a full batch must be able to queue up
+    depth = std::clamp(
+      std::max(depth, batch), config_.min_depth, config_.max_depth);
+
+    batch_size_.store(batch, std::memory_order_relaxed);
+    queue_depth_.store(depth, std::memory_order_relaxed);
+    last_throughput_ = throughput;
+
+    window_writes_ = 0;
+    window_bytes_ = 0;
+    window_elapsed_ = std::chrono::nanoseconds(0);
+    window_latency_ = std::chrono::nanoseconds(0);
+    window_filled_batch_ = false;
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+#include "device.probe.hh"
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+namespace zarr {
+/**
+ * @brief Tunes the number of chunks per vectored write and the number of
+ * chunks allowed in flight from observed write throughput and latency.
+ *
+ * Writes are observed in windows of a few calls. After each window, both
+ * limits are halved (multiplicative decrease) if any chunk waited longer
+ * than the latency target; the batch limit alone is halved if throughput
+ * fell noticeably from the previous window, i.e., larger batches stopped
+ * paying off; otherwise both grow by a fixed step (additive increase). The
+ * batch limit only grows when the window actually filled a batch.
+ *
+ * One thread records; any thread may read the current limits.
+ */
+class AdaptiveBatcher
+{
+  public:
+    struct Config
+    {
+        size_t min_batch = 1;
+        size_t max_batch = 1024; // IOV_MAX on Linux and macOS
+        size_t initial_batch = 8;
+        size_t batch_step = 4;
+
+        size_t min_depth = 1;
+        size_t max_depth = 4096;
+        size_t initial_depth = 64;
+        size_t depth_step = 8;
+
+        double decrease_factor = 0.5;
+        double throughput_tolerance = 0.1; // fractional drop that counts
+        std::chrono::microseconds target_latency{ 50000 };
+        size_t window = 4; // writes per adjustment
+
+        /// Whether an AsyncChunkWriter should seed this config from its
+        /// file's device with for_device() before use.
+        bool seed_from_device = true;
+
+        /// Defaults, starting from what @p device can take rather than
+        /// from fixed guesses, e.g. for VectorizedFileWriter::device(). The
+        /// result is not seeded again.
+        static Config for_device(const DeviceInfo& device);
+
+        /// As above, starting from @p base rather than the defaults.
+        static Config for_device(const DeviceInfo& device, Config base);
+    };
+
+    explicit AdaptiveBatcher(const Config& config);
+
+    /// Maximum number of chunks to take per batch.
+    size_t batch_size() const {
+        return batch_size_.load(std::memory_order_relaxed);
+    }
+
+    /// Maximum number of chunks submitted but not yet written.
+    size_t queue_depth() const {
+        return queue_depth_.load(std::memory_order_relaxed);
+    }
+
+    uint64_t increases() const {
+        return increases_.load(std::memory_order_relaxed);
+    }
+    uint64_t decreases() const {
+        return decreases_.load(std::memory_order_relaxed);
+    }
+
+    /// Observe one write of @p nchunks chunks (@p nbytes in total) that took
+    /// @p elapsed, whose oldest chunk was submitted @p latency before it
+    /// completed.
+    void record(size_t nchunks,
+                size_t nbytes,
+                std::chrono::nanoseconds elapsed,
+                std::chrono::nanoseconds latency);
+
+  private:
+    const Config config_;
+
+    std::atomic<size_t> batch_size_;
+    std::atomic<size_t> queue_depth_;
+    std::atomic<uint64_t> increases_;
+    std::atomic<uint64_t> decreases_;
+
+    // current window; recording thread only
+    size_t window_writes_;
+    size_t window_bytes_;
+    std::chrono::nanoseconds window_elapsed_;
+    std::chrono::nanoseconds window_latency_;
+    bool window_filled_batch_;
+    double last_throughput_;
+
+    void adjust_();
+};
+} // namespace zarr
@@ -0,0 +1,383 @@
+#include "async.chunk.writer.hh"
+#include "numa.topology.hh"
+
+#include <algorithm>
+#include <span>
+
+zarr::AsyncChunkWriter::AsyncChunkWriter(
+  VectorizedFileWriter& writer,
+  size_t queue_capacity,
+  size_t max_batch,
+  std::optional<AdaptiveBatcher::Config> adaptive)
+  : writer_(writer)
+  , queue_(queue_capacity)
+  , high_queue_(queue_capacity)
+  , max_batch_(std::max<size_t>(max_batch, 1))
+  , stopping_(false)
+  , wake_(0)
+  , submitted_(0)
+  , completed_(0)
+  , chunks_written_(0)
+  , bytes_written_(0)
+  , batches_(0)
+  , write_calls_(0)
+  , failed_writes_(0)
+  , chunks_cancelled_(0)
+  , chunks_timed_out_(0)
+  , depth_throttles_(0) {
+    if (adaptive) {
+        batcher_ = std::make_unique<AdaptiveBatcher>(
+          adaptive->seed_from_device
+            ? AdaptiveBatcher::Config::for_device(writer_.device(), *adaptive)
+            : *adaptive);
+    }
+    thread_ = std::thread([this] { run_(); });
+}
+
+zarr::AsyncChunkWriter::~AsyncChunkWriter() {
+    stop();
+}
+
+bool
+zarr::AsyncChunkWriter::submit(std::vector<uint8_t>&& chunk, size_t offset) {
+    return submit(std::move(chunk), offset, nullptr);
+}
+
+bool
+zarr::AsyncChunkWriter::submit(std::vector<uint8_t>&& chunk,
+                               size_t offset,
+                               Completion on_complete) {
+    return submit(
+      std::move(chunk), offset, WritePriority::Bulk, std::move(on_complete));
+}
+
+bool
+zarr::AsyncChunkWriter::submit(std::vector<uint8_t>&& chunk,
+                               size_t offset,
+                               WritePriority priority,
+                               Completion on_complete) {
+    WriteOptions options;
+    options.priority = priority;
+    options.on_complete = std::move(on_complete);
+    return submit(std::move(chunk), offset, std::move(options));
+}
+
+bool
+zarr::AsyncChunkWriter::submit(std::vector<uint8_t>&& chunk,
+                               size_t offset,
+                               WriteOptions options) {
+    ChunkWrite write;
+    write.data = std::move(chunk);
+    write.offset = offset;
+    write.on_complete = std::move(options.on_complete);
+    write.priority = options.priority;
+    write.token = options.token;
+    write.deadline = options.deadline;
+    if (!enqueue_(write)) {
+        chunk = std::move(write.data); // hand the buffer back
+        return false;
+    }
+    return true;
+}
+
+bool
+zarr::AsyncChunkWriter::submit(BufferPool::Buffer&& chunk, size_t offset) {
+    return submit(std::move(chunk), offset, WriteOptions{});
+}
+
+bool
+zarr::AsyncChunkWriter::submit(BufferPool::Buffer&& chunk,
+                               size_t offset,
+                               WriteOptions options) {
+    ChunkWrite write;
+    write.buffer = std::move(chunk);
+    write.offset = offset;
+    write.on_complete = std::move(options.on_complete);
+    write.priority = options.priority;
+    write.token = options.token;
+    write.deadline = options.deadline;
+    if (!enqueue_(write)) {
+        chunk = std::move(write.buffer); // hand the buffer back
+        return false;
+    }
+    return true;
+}
+
+// Queue @p write, leaving it intact if the writer is stopping.
+bool
+zarr::AsyncChunkWriter::enqueue_(ChunkWrite& write) {
+    const auto priority = write.priority;
+    if (stopping_.load(std::memory_order_acquire)) {
+        return false;
+    }
+
+    if (batcher_ && priority == WritePriority::Bulk) {
+        // sleep until a write completes rather than spin; whenever we wait,
+        // writes are in flight, so completed_ moves on even while stopping
+        bool throttled = false;
+        auto completed = completed_.load(std::memory_order_acquire);
+        while (submitted_.load(std::memory_order_acquire) - completed >=
+               batcher_->queue_depth()) {
+            if (stopping_.load(std::memory_order_acquire)) {
+                return false;
+            }
+            throttled = true;
+            completed_.wait(completed, std::memory_order_acquire);
+            completed = completed_.load(std::memory_order_acquire);
+        }
+        if (throttled) {
+            depth_throttles_.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    write.enqueued = Clock::now();
+    auto& queue = priority == WritePriority::High ? high_queue_ : queue_;
+    // read before pushing, so a batch completing in between is not missed
+    auto completed = completed_.load(std::memory_order_acquire);
+    while (!queue.try_push(std::move(write))) {
+        if (stopping_.load(std::memory_order_acquire)) {
+            return false;
+        }
+        // full; wait for the writer to finish a batch, which it or stop()
+        // always does since the queue holds writes
+        completed_.wait(completed, std::memory_order_acquire);
+        completed = completed_.load(std::memory_order_acquire);
+    }
+
+    submitted_.fetch_add(1, std::memory_order_release);
+    wake_.fetch_add(1, std::memory_order_release);
+    wake_.notify_one();
+    return true;
+}
+
+void
+zarr::AsyncChunkWriter::flush() {
+    const auto target = submitted_.load(std::memory_order_acquire);
+    auto completed = completed_.load(std::memory_order_acquire);
+    while (completed < target) {
+        completed_.wait(completed, std::memory_order_acquire);
+        completed = completed_.load(std::memory_order_acquire);
+    }
+}
+
+void
+zarr::AsyncChunkWriter::stop() {
+    if (!thread_.joinable()) {
+        return;
+    }
+
+    stopping_.store(true, std::memory_order_release);
+    wake_.fetch_add(1, std::memory_order_release);
+    wake_.notify_one();
+    thread_.join();
+
+    // pick up anything pushed while the writer thread was exiting; this
+    // thread is now the only consumer
+    write_high_priority_();
+
+    std::vector<ChunkWrite> batch;
+    ChunkWrite write;
+    while (queue_.try_pop(write)) {
+        batch.push_back(std::move(write));
+    }
+    if (!batch.empty()) {
+        write_batch_(batch);
+    }
+}
+
+void
+zarr::AsyncChunkWriter::cancel() {
+    // queued writes are then completed, unwritten, by the writer thread or
+    // by stop()'s drain
+    cancelled_.cancel();
+    stop();
+}
+
+zarr::AsyncChunkWriter::Stats
+zarr::AsyncChunkWriter::stats() const {
+    Stats stats;
+    stats.chunks_submitted = submitted_.load(std::memory_order_relaxed);
+    stats.chunks_written = chunks_written_.load(std::memory_order_relaxed);
+    stats.bytes_written = bytes_written_.load(std::memory_order_relaxed);
+    stats.batches = batches_.load(std::memory_order_relaxed);
+    stats.write_calls = write_calls_.load(std::memory_order_relaxed);
+    stats.failed_writes = failed_writes_.load(std::memory_order_relaxed);
+    stats.chunks_cancelled = chunks_cancelled_.load(std::memory_order_relaxed);
+    stats.chunks_timed_out = chunks_timed_out_.load(std::memory_order_relaxed);
+    stats.depth_throttles = depth_throttles_.load(std::memory_order_relaxed);
+    if (batcher_) {
+        stats.batch_limit = batcher_->batch_size();
+        stats.queue_depth = batcher_->queue_depth();
+        stats.batch_increases = batcher_->increases();
+        stats.batch_decreases = batcher_->decreases();
+    } else {
+        stats.batch_limit = max_batch_;
+    }
+    return stats;
+}
+
+bool
+zarr::AsyncChunkWriter::pin_to_numa_node(int node) {
+    return pin_thread_to_numa_node(thread_, node);
+}
+
+void
+zarr::AsyncChunkWriter::run_() {
+    std::vector<ChunkWrite> batch;
+    batch.reserve(max_batch_);
+
+    while (true) {
+        // read the wake counter before draining so that a submit racing
+        // with an empty drain still wakes us
+        const auto wake = wake_.load(std::memory_order_acquire);
+
+        const size_t max_batch = batcher_ ? batcher_->batch_size() : max_batch_;
+        // high-priority writes first, and never batched with bulk ones
+        ChunkWrite write;
+        while (batch.size() < max_batch && high_queue_.try_pop(write)) {
+            batch.push_back(std::move(write));
+        }
+        if (batch.empty()) {
+            while (batch.size() < max_batch && queue_.try_pop(write)) {
+                batch.push_back(std::move(write));
+            }
+        }
+
+        if (!batch.empty()) {
+            write_batch_(batch);
+            continue;
+        }
+
+        if (stopping_.load(std::memory_order_acquire) &&
+            completed_.load(std::memory_order_acquire) >=
+              submitted_.load(std::memory_order_acquire)) {
+            break;
+        }
+        wake_.wait(wake, std::memory_order_acquire);
+    }
+}
+
+void
+zarr::AsyncChunkWriter::write_batch_(std::vector<ChunkWrite>& batch) {
+    const auto now = Clock::now();
+    for (const auto& write : batch) {
+        const auto handoff = now - write.enqueued;
+        handoff_us_.record(static_cast<uint64_t>(
+          std::chrono::duration_cast<std::chrono::microseconds>(handoff)
+            .count()));
+    }
+    batch_sizes_.record(batch.size());
+    batches_.fetch_add(1, std::memory_order_relaxed);
+
+    std::sort(batch.begin(), batch.end(), [](const auto& a, const auto& b) {
+        return a.offset < b.offset;
+    });
+
+    const bool bulk = batch.front().priority == WritePriority::Bulk;
+
+    // one write_vectors call per run of contiguous chunks with the same
+    // token, bounded for bulk writes so high-priority ones are not stuck
+    // behind them for long
+    std::vector<std::span<const uint8_t>> buffers;
+    size_t batch_bytes = 0;
+    Clock::duration batch_elapsed{ 0 };
+    size_t first = 0;
+    while (first < batch.size()) {
+        size_t last = first + 1;
+        size_t end = batch[first].offset + batch[first].bytes().size();
+        while (last < batch.size() && batch[last].offset == end &&
+               batch[last].token == batch[first].token &&
+               (!bulk ||
+                end + batch[last].bytes().size() - batch[first].offset <=
+                  max_bulk_run_bytes)) {
+            end += batch[last].bytes().size();
+            ++last;
+        }
+
+        if (bulk) {
+            write_high_priority_();
+        }
+
+        WriteBounds bounds;
+        bounds.tokens = { &cancelled_, batch[first].token };
+        buffers.clear();
+        for (auto i = first; i < last; ++i) {
+            buffers.push_back(batch[i].bytes());
+            bounds.deadline = std::min(bounds.deadline, batch[i].deadline);
+        }
+
+        write_calls_.fetch_add(1, std::memory_order_relaxed);
+        const auto write_start = Clock::now();
+        const auto status =
+          writer_.write_vectors(buffers, batch[first].offset, bounds);
+        batch_elapsed += Clock::now() - write_start;
+        batch_bytes += end - batch[first].offset;
+
+        const bool ok = status == WriteStatus::Ok;
+        switch (status) {
+            case WriteStatus::Ok:
+                chunks_written_.fetch_add(last - first,
+                                          std::memory_order_relaxed);
+                bytes_written_.fetch_add(end - batch[first].offset,
+                                         std::memory_order_relaxed);
+                break;
+            case WriteStatus::Failed:
+                failed_writes_.fetch_add(last - first,
+                                         std::memory_order_relaxed);
+                break;
+            case WriteStatus::Cancelled:
+                chunks_cancelled_.fetch_add(last - first,
+                                            std::memory_order_relaxed);
+                break;
+            case WriteStatus::TimedOut:
+                chunks_timed_out_.fetch_add(last - first,
+                                            std::memory_order_relaxed);
+                break;
+        }
+
+        for (auto i = first; i < last; ++i) {
+            complete_(batch[i], ok);
+        }
+        first = last;
+    }
+
+    if (batcher_ && bulk) {
+        // latency as seen by the longest-waiting chunk
+        auto oldest = now;
+        for (const auto& write : batch) {
+            oldest = std::min(oldest, write.enqueued);
+        }
+        batcher_->record(
+          batch.size(), batch_bytes, batch_elapsed, Clock::now() - oldest);
+    }
+
+    completed_.fetch_add(batch.size(), std::memory_order_release);
+    completed_.notify_all();
+    batch.clear();
+}
+
+void
+zarr::AsyncChunkWriter::write_high_priority_() {
+    std::vector<ChunkWrite> batch;
+    ChunkWrite write;
+    while (high_queue_.try_pop(write)) {
+        batch.push_back(std::move(write));
+    }
+    if (!batch.empty()) {
+        write_batch_(batch);
+    }
+}
+
+void
+zarr::AsyncChunkWriter::complete_(ChunkWrite& write, bool ok) {
+    const auto latency = Clock::now() - write.enqueued;
+    completion_us_[static_cast<size_t>(write.priority)].record(
+      static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::microseconds>(latency)
+          .count()));
+
+    write.buffer = {}; // back to its pool
+    if (write.on_complete) {
+        write.on_complete(std::move(write.data), ok);
+    }
+}
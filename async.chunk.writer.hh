@@ -0,0 +1,223 @@
+#pragma once
+
+#include "adaptive.batcher.hh"
+#include "buffer.pool.hh"
+#include "cancellation.token.hh"
+#include "log2.histogram.hh"
+#include "mpsc.queue.hh"
+#include "vectorized.file.writer.hh"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <span>
+#include <thread>
+#include <vector>
+
+namespace zarr {
+enum class WritePriority
+{
+    High, // small, latency-sensitive writes, e.g. metadata and shard indices
+    Bulk, // chunk data
+};
+
+/**
+ * @brief Hands chunks from any number of producer threads to a dedicated
+ * writer thread through a lock-free queue.
+ *
+ * The writer thread drains everything queued (up to a batch limit), sorts it
+ * by offset and writes each run of contiguous chunks with a single
+ * write_vectors call. Producers never touch the writer's mutex; when the
+ * queue is full, submit() sleeps until the writer completes a batch.
+ *
+ * The writer takes ownership of each submitted buffer. Once its write has
+ * completed, a buffer lent by a BufferPool goes back to its pool, and any
+ * other buffer is handed to the chunk's completion callback if it has one,
+ * and otherwise freed. Either way producers can recycle buffers without
+ * copying chunks or waiting for the write.
+ *
+ * With adaptive batching, the batch limit and the number of chunks allowed
+ * in flight are tuned online by an AdaptiveBatcher, and submit() waits
+ * while the in-flight limit is reached.
+ *
+ * High-priority writes have a queue of their own, which the writer thread
+ * drains before bulk chunks and checks again before every bulk
+ * write_vectors call. Bulk runs are capped at max_bulk_run_bytes, so a
+ * high-priority write waits behind at most one bounded bulk write. High-
+ * priority writes are not held back by the adaptive in-flight limit.
+ *
+ * A write can carry a cancellation token and a deadline. Writes are issued
+ * in slices, with the token, the deadline and the writer's own cancel()
+ * checked between slices, so a cancelled or late write is abandoned within
+ * one slice and completed with ok = false. A run of contiguous chunks
+ * written together stops at the earliest of their deadlines, or as soon as
+ * either token is cancelled; chunks with different tokens are never
+ * written together.
+ */
+class AsyncChunkWriter
+{
+  public:
+    using Clock = std::chrono::steady_clock;
+
+    static constexpr size_t max_bulk_run_bytes = 64 << 20;
+
+    struct Stats
+    {
+        uint64_t chunks_submitted = 0;
+        uint64_t chunks_written = 0;
+        uint64_t bytes_written = 0;
+        uint64_t batches = 0;     // queue drains by the writer thread
+        uint64_t write_calls = 0; // write_vectors calls
+        uint64_t failed_writes = 0;
+        uint64_t chunks_cancelled = 0;
+        uint64_t chunks_timed_out = 0;
+
+        // current batching decisions
+        uint64_t batch_limit = 0;
+        uint64_t queue_depth = 0; // 0 if only bounded by the queue
+        uint64_t batch_increases = 0;
+        uint64_t batch_decreases = 0;
+        uint64_t depth_throttles = 0; // submits that waited on queue_depth
+    };
+
+    /// Receives a chunk's buffer once its write has completed; @p ok is
+    /// false if the write failed. Runs on the writer thread, or on the thread
+    /// calling stop(), so it should be quick and must not throw.
+    using Completion =
+      std::function<void(std::vector<uint8_t>&& chunk, bool ok)>;
+
+    struct WriteOptions
+    {
+        WritePriority priority = WritePriority::Bulk;
+        Completion on_complete;
+        const CancellationToken* token = nullptr; // must outlive the write
+        Clock::time_point deadline = Clock::time_point::max();
+    };
+
+    /// If @p adaptive is given, it replaces the fixed @p max_batch, and
+    /// unless it says otherwise, it is seeded from @p writer's device first.
+    AsyncChunkWriter(VectorizedFileWriter& writer,
+                     size_t queue_capacity = 1024,
+                     size_t max_batch = 1024,
+                     std::optional<AdaptiveBatcher::Config> adaptive = {});
+    ~AsyncChunkWriter();
+
+    AsyncChunkWriter(const AsyncChunkWriter&) = delete;
+    AsyncChunkWriter& operator=(const AsyncChunkWriter&) = delete;
+
+    /// Queue @p chunk for writing at @p offset. Returns false, leaving
+    /// @p chunk intact, once stop() has been called. Must not race with
+    /// stop() returning.
+    bool submit(std::vector<uint8_t>&& chunk, size_t offset);
+
+    /// As above, handing the buffer to @p on_complete once written.
+    bool submit(std::vector<uint8_t>&& chunk,
+                size_t offset,
+                Completion on_complete);
+
+    /// As above, in priority class @p priority.
+    bool submit(std::vector<uint8_t>&& chunk,
+                size_t offset,
+                WritePriority priority,
+                Completion on_complete = nullptr);
+
+    /// As above, with a cancellation token and deadline.
+    bool submit(std::vector<uint8_t>&& chunk,
+                size_t offset,
+                WriteOptions options);
+
+    /// Queue @p chunk, lent by a BufferPool, for writing at @p offset. Once
+    /// written, it goes back to its pool. Returns false, leaving @p chunk
+    /// intact, once stop() has been called.
+    bool submit(BufferPool::Buffer&& chunk, size_t offset);
+
+    /// As above, with @p options; @p options.on_complete receives an empty
+    /// vector, as the buffer goes back to its pool regardless.
+    bool submit(BufferPool::Buffer&& chunk,
+                size_t offset,
+                WriteOptions options);
+
+    /// Block until every chunk submitted so far has been written.
+    void flush();
+
+    /// Write out everything queued, then stop the writer thread.
+    void stop();
+
+    /// Abandon every queued write and stop the one in progress at its next
+    /// slice, completing them with ok = false, then stop the writer thread.
+    /// Unlike stop(), returns within about one slice's write time.
+    void cancel();
+
+    Stats stats() const;
+
+    /// Run the writer thread on the CPUs of NUMA node @p node, e.g. the node
+    /// holding its buffers or the storage device. Returns false if the
+    /// thread could not be pinned.
+    bool pin_to_numa_node(int node);
+
+    /// Time from submit() to the writer thread dequeuing a chunk, in us.
+    const Log2Histogram& handoff_latency_us() const { return handoff_us_; }
+
+    /// Number of chunks dequeued per batch.
+    const Log2Histogram& batch_sizes() const { return batch_sizes_; }
+
+    /// Time from submit() to a write in class @p priority completing, in us.
+    const Log2Histogram& completion_latency_us(WritePriority priority) const {
+        return completion_us_[static_cast<size_t>(priority)];
+    }
+
+  private:
+    struct ChunkWrite
+    {
+        std::vector<uint8_t> data;
+        BufferPool::Buffer buffer; // instead of data, if lent by a pool
+        size_t offset = 0;
+        Clock::time_point enqueued;
+        Completion on_complete;
+        WritePriority priority = WritePriority::Bulk;
+        const CancellationToken* token = nullptr;
+        Clock::time_point deadline = Clock::time_point::max();
+
+        std::span<const uint8_t> bytes() const {
+            return buffer.data() != nullptr ? buffer.span()
+                                            : std::span<const uint8_t>(data);
+        }
+    };
+
+    VectorizedFileWriter& writer_;
+    MpscQueue<ChunkWrite> queue_; // bulk
+    MpscQueue<ChunkWrite> high_queue_;
+    const size_t max_batch_;
+    std::unique_ptr<AdaptiveBatcher> batcher_;
+
+    std::atomic<bool> stopping_;
+    CancellationToken cancelled_; // set by cancel()
+    std::atomic<uint64_t> wake_;      // bumped on every submit and on stop
+    std::atomic<uint64_t> submitted_;
+    std::atomic<uint64_t> completed_; // written, failed or abandoned
+
+    std::atomic<uint64_t> chunks_written_;
+    std::atomic<uint64_t> bytes_written_;
+    std::atomic<uint64_t> batches_;
+    std::atomic<uint64_t> write_calls_;
+    std::atomic<uint64_t> failed_writes_;
+    std::atomic<uint64_t> chunks_cancelled_;
+    std::atomic<uint64_t> chunks_timed_out_;
+    std::atomic<uint64_t> depth_throttles_;
+    Log2Histogram handoff_us_;
+    Log2Histogram batch_sizes_;
+    std::array<Log2Histogram, 2> completion_us_; // by WritePriority
+
+    std::thread thread_;
+
+    bool enqueue_(ChunkWrite& write);
+    void run_();
+    void write_batch_(std::vector<ChunkWrite>& batch);
+    void write_high_priority_();
+    void complete_(ChunkWrite& write, bool ok);
+};
+} // namespace zarr
@@ -0,0 +1,111 @@
+#include "benchmarks.hh"
+#include "async.chunk.writer.hh"
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <optional>
+#include <sstream>
+#include <thread>
+
+namespace fs = std::filesystem;
+
+namespace {
+const size_t nproducers = 4;
+const size_t nchunks = 4096;
+
+void
+run(size_t bytes_per_chunk,
+    size_t max_batch, // 0 for adaptive
+    bool from_device, // adaptive, starting from the device's capabilities
+    const std::string& path,
+    std::ostream* results_csv) {
+    zarr::VectorizedFileWriter writer(path);
+
+    std::optional<zarr::AdaptiveBatcher::Config> adaptive;
+    if (max_batch == 0) {
+        // the async writer seeds the config from the device by default
+        adaptive = zarr::AdaptiveBatcher::Config{};
+        adaptive->seed_from_device = from_device;
+    }
+
+    zarr::BufferPool pool;
+    zarr::AsyncChunkWriter async_writer(
+      writer, 1024, max_batch == 0 ? 1024 : max_batch, adaptive);
+
+    auto start = std::chrono::high_resolution_clock::now();
+    std::vector<std::thread> producers;
+    for (size_t p = 0; p < nproducers; ++p) {
+        producers.emplace_back([&, p] {
+            for (size_t i = 0; i < nchunks / nproducers; ++i) {
+                // producers together fill the file contiguously
+                auto chunk = pool.acquire(bytes_per_chunk);
+                async_writer.submit(std::move(chunk),
+                                    (i * nproducers + p) * bytes_per_chunk);
+            }
+        });
+    }
+    for (auto& producer : producers) {
+        producer.join();
+    }
+    async_writer.flush();
+    auto end = std::chrono::high_resolution_clock::now();
+
+    if (results_csv == nullptr) {
+        return;
+    }
+
+    const auto stats = async_writer.stats();
+    const auto& handoff = async_writer.handoff_latency_us();
+    const double s = std::chrono::duration<double>(end - start).count();
+    const double mib = static_cast<double>(nchunks * bytes_per_chunk) /
+                       (1024.0 * 1024.0);
+
+    std::string batching = std::to_string(max_batch);
+    if (max_batch == 0) {
+        batching = from_device ? "adaptive-device" : "adaptive";
+    }
+
+    std::stringstream ss;
+    ss << bytes_per_chunk << "," << batching << ","
+       << mib / s << "," << handoff.percentile(0.5) << ","
+       << handoff.percentile(0.99) << "," << stats.write_calls << ","
+       << stats.batch_limit << "," << stats.queue_depth << ","
+       << stats.batch_increases << "," << stats.batch_decreases << ","
+       << stats.depth_throttles;
+
+    std::cout << ss.str() << std::endl;
+    *results_csv << ss.str() << std::endl;
+}
+} // namespace
+
+int
+bench::adaptive_batch() {
+    std::ofstream results_csv("adaptive_batch.csv");
+    const std::string header =
+      "bytes_per_chunk,max_batch,mib_per_s,handoff_p50_us,handoff_p99_us,"
+      "write_calls,batch_limit,queue_depth,batch_increases,batch_decreases,"
+      "depth_throttles";
+    std::cout << header << std::endl;
+    results_csv << header << std::endl;
+
+    const std::string path = "adaptive_batch.bin";
+
+    bench::warm_up([&] { run(64 * 1024, 16, false, path, nullptr); }, path);
+
+    for (const size_t bytes_per_chunk : { 4 * 1024, 64 * 1024, 512 * 1024 }) {
+        for (const size_t max_batch : { 1, 16, 256, 0 }) {
+            run(bytes_per_chunk, max_batch, false, path, &results_csv);
+            if (fs::exists(path)) {
+                fs::remove(path);
+            }
+        }
+        run(bytes_per_chunk, 0, true, path, &results_csv);
+        if (fs::exists(path)) {
+            fs::remove(path);
+        }
+    }
+
+    return 0;
+}
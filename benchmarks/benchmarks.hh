@@ -0,0 +1,94 @@
+#pragma once
+
+#include <filesystem>
+#include <string>
+#include <system_error>
+
+// Each benchmark writes its results to a CSV file in the working directory
+// and echoes them to stdout. Returns 0 on success.
+namespace bench {
+// Run one trial of a benchmark without reporting it, so that costs paid once
+// per process, such as starting threads, growing the heap and first creating
+// files, are not charged to the first configuration reported. Removes
+// @p path afterwards, if given.
+template<typename Trial>
+void
+warm_up(Trial trial, const std::string& path = {}) {
+    trial();
+    if (!path.empty()) {
+        std::error_code ec;
+        std::filesystem::remove(path, ec);
+    }
+}
+
+int
+shard_order();
+
+int
+shard_alignment();
+
+int
+dtype_convert();
+
+int
+delta_filter();
+
+int
+transpose();
+
+int
+mpsc_queue();
+
+int
+buffer_pool();
+
+int
+adaptive_batch();
+
+int
+numa_placement();
+
+int
+rate_limit();
+
+int
+priority_classes();
+
+int
+stripe_scaling();
+
+int
+zip_store();
+
+int
+cancellation();
+
+int
+open_close();
+
+int
+metadata_batch();
+
+int
+mixed_read_write();
+
+int
+write_order();
+
+#ifndef _WIN32
+int
+shm_ring();
+
+int
+object_store();
+
+int
+fault_injection();
+
+int
+memfd_staging();
+
+int
+multiprocess_shards();
+#endif
+} // namespace bench
@@ -0,0 +1,168 @@
+#include "benchmarks.hh"
+#include "async.chunk.writer.hh"
+#include "buffer.pool.hh"
+#include "mpsc.queue.hh"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <span>
+#include <sstream>
+
+namespace fs = std::filesystem;
+
+namespace {
+const size_t bytes_per_chunk = 4 * 1024 * 1024;
+const size_t nchunks = 256;
+const size_t queue_capacity = 16;
+
+enum class Recycling
+{
+    None,     // allocate every chunk, free it once written
+    Pool,     // buffers lent by a BufferPool go back to it once written
+    Callback, // completion callback hands buffers back to the producer
+    Prefaulted, // Pool, with the pool reserved and prefaulted up front
+    Locked,     // Prefaulted, with the reserved buffers locked in memory
+};
+
+const char*
+to_string(Recycling recycling) {
+    switch (recycling) {
+        case Recycling::None:
+            return "none";
+        case Recycling::Pool:
+            return "pool";
+        case Recycling::Callback:
+            return "callback";
+        case Recycling::Prefaulted:
+            return "prefaulted-pool";
+        case Recycling::Locked:
+            return "locked-pool";
+    }
+    return "unknown";
+}
+
+// Stand-in for the producer filling (e.g., compressing into) a chunk.
+void
+fill_chunk(std::span<uint8_t> chunk, size_t i) {
+    memset(chunk.data(), static_cast<int>(i & 0xff), chunk.size());
+}
+
+void
+run(Recycling recycling,
+    const std::string& path,
+    std::ostream* results_csv) {
+    zarr::VectorizedFileWriter writer(path);
+    zarr::BufferPool pool;
+    const bool pooled = recycling == Recycling::Pool ||
+                        recycling == Recycling::Prefaulted ||
+                        recycling == Recycling::Locked;
+    if (recycling == Recycling::Prefaulted || recycling == Recycling::Locked) {
+        // enough for a full queue, the batch being written and the chunk
+        // being filled
+        pool.reserve(2 * queue_capacity + 2,
+                     bytes_per_chunk,
+                     recycling == Recycling::Locked);
+    }
+
+    // written buffers come back through this queue in callback mode; the
+    // producer is its only consumer. Buffers that do not fit are freed.
+    zarr::MpscQueue<std::vector<uint8_t>> returned(2 * queue_capacity);
+    const auto on_complete = [&returned](std::vector<uint8_t>&& chunk, bool) {
+        returned.try_push(std::move(chunk));
+    };
+
+    zarr::AsyncChunkWriter async_writer(writer, queue_capacity);
+
+    size_t allocations = 0;
+    std::chrono::high_resolution_clock::duration max_fill{ 0 };
+    const auto faults_before = zarr::page_faults();
+    auto start = std::chrono::high_resolution_clock::now();
+    for (size_t i = 0; i < nchunks; ++i) {
+        const auto fill_start = std::chrono::high_resolution_clock::now();
+        if (pooled) {
+            auto chunk = pool.acquire(bytes_per_chunk);
+            fill_chunk(chunk.span(), i);
+            max_fill = std::max(
+              max_fill, std::chrono::high_resolution_clock::now() - fill_start);
+            async_writer.submit(std::move(chunk), i * bytes_per_chunk);
+            continue;
+        }
+
+        std::vector<uint8_t> chunk;
+        if (recycling == Recycling::Callback) {
+            returned.try_pop(chunk);
+        }
+        if (chunk.capacity() < bytes_per_chunk) {
+            ++allocations;
+        }
+        chunk.resize(bytes_per_chunk);
+
+        fill_chunk(chunk, i);
+        max_fill = std::max(
+          max_fill, std::chrono::high_resolution_clock::now() - fill_start);
+        if (recycling == Recycling::Callback) {
+            async_writer.submit(
+              std::move(chunk), i * bytes_per_chunk, on_complete);
+        } else {
+            async_writer.submit(std::move(chunk), i * bytes_per_chunk);
+        }
+    }
+    async_writer.flush();
+    auto end = std::chrono::high_resolution_clock::now();
+    const auto faults_after = zarr::page_faults();
+
+    if (pooled) {
+        const auto stats = pool.stats();
+        allocations = stats.acquired - stats.reused;
+    }
+
+    if (results_csv == nullptr) {
+        return;
+    }
+
+    const double s = std::chrono::duration<double>(end - start).count();
+    const double mib = static_cast<double>(nchunks * bytes_per_chunk) /
+                       (1024.0 * 1024.0);
+    std::stringstream ss;
+    ss << to_string(recycling) << "," << mib / s << "," << allocations << ","
+       << faults_after.minor - faults_before.minor << ","
+       << faults_after.major - faults_before.major << ","
+       << std::chrono::duration<double, std::micro>(max_fill).count() << ","
+       << static_cast<double>(pool.stats().locked_bytes) / (1024.0 * 1024.0)
+       << "," << async_writer.stats().failed_writes;
+
+    std::cout << ss.str() << std::endl;
+    *results_csv << ss.str() << std::endl;
+}
+} // namespace
+
+int
+bench::buffer_pool() {
+    std::ofstream results_csv("buffer_pool.csv");
+    const std::string header = "recycling,mib_per_s,allocations,minor_faults,"
+                               "major_faults,max_fill_us,locked_mib,"
+                               "failed_writes";
+    std::cout << header << std::endl;
+    results_csv << header << std::endl;
+
+    const std::string path = "buffer_pool.bin";
+
+    bench::warm_up([&] { run(Recycling::None, path, nullptr); }, path);
+
+    for (const auto recycling : { Recycling::None,
+                                  Recycling::Pool,
+                                  Recycling::Callback,
+                                  Recycling::Prefaulted,
+                                  Recycling::Locked }) {
+        run(recycling, path, &results_csv);
+        if (fs::exists(path)) {
+            fs::remove(path);
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,112 @@
+#include "async.chunk.writer.hh"
+#include "benchmarks.hh"
+#include "cancellation.token.hh"
+#include "rate.limiter.hh"
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <thread>
+
+namespace fs = std::filesystem;
+
+namespace {
+const size_t bytes_per_chunk = 16 * 1024 * 1024;
+const size_t nchunks = 64; // 1 GiB queued
+const double disk_bytes_per_second = 256.0 * 1024 * 1024;
+const auto abort_after = std::chrono::milliseconds(200);
+const auto timeout = std::chrono::milliseconds(1000);
+const std::string path = "cancellation.bin";
+
+using Clock = zarr::AsyncChunkWriter::Clock;
+
+// Queue every chunk of an acquisition at once, as a fast camera would, to a
+// writer throttled to the speed of a slow disk, then shut down.
+void
+run(const std::string& scenario, std::ostream* results_csv) {
+    zarr::RateLimiter disk(
+      zarr::RateLimiter::Limits{ disk_bytes_per_second, 0 });
+
+    Clock::duration shutdown{ 0 };
+    zarr::AsyncChunkWriter::Stats stats;
+    {
+        zarr::VectorizedFileWriter file(path);
+        file.set_rate_limiter(&disk);
+        zarr::AsyncChunkWriter writer(file, nchunks);
+
+        // in "token", odd chunks belong to a second acquisition that is
+        // not aborted
+        zarr::CancellationToken aborted, kept;
+        const auto start = Clock::now();
+        for (size_t i = 0; i < nchunks; ++i) {
+            zarr::AsyncChunkWriter::WriteOptions options;
+            if (scenario == "deadline") {
+                options.deadline = start + timeout;
+            } else if (scenario == "token") {
+                options.token = i % 2 == 0 ? &aborted : &kept;
+            }
+            writer.submit(std::vector<uint8_t>(bytes_per_chunk, 1),
+                          i * bytes_per_chunk,
+                          std::move(options));
+        }
+
+        if (scenario != "deadline") {
+            std::this_thread::sleep_for(abort_after);
+        }
+
+        const auto shutdown_start = Clock::now();
+        if (scenario == "stop") {
+            writer.stop();
+        } else if (scenario == "cancel") {
+            writer.cancel();
+        } else if (scenario == "token") {
+            aborted.cancel();
+            writer.flush();
+        } else {
+            writer.flush();
+        }
+        shutdown = Clock::now() - shutdown_start;
+
+        writer.stop();
+        stats = writer.stats();
+        file.set_rate_limiter(nullptr);
+    }
+
+    if (fs::exists(path)) {
+        fs::remove(path);
+    }
+
+    if (results_csv == nullptr) {
+        return;
+    }
+
+    std::stringstream ss;
+    ss << scenario << ","
+       << std::chrono::duration<double, std::milli>(shutdown).count() << ","
+       << stats.chunks_written << "," << stats.chunks_cancelled << ","
+       << stats.chunks_timed_out << "," << stats.failed_writes << ","
+       << static_cast<double>(stats.bytes_written) / (1024.0 * 1024.0);
+
+    std::cout << ss.str() << std::endl;
+    *results_csv << ss.str() << std::endl;
+}
+} // namespace
+
+int
+bench::cancellation() {
+    std::ofstream results_csv("cancellation.csv");
+    const std::string header = "scenario,shutdown_ms,chunks_written,"
+                               "chunks_cancelled,chunks_timed_out,"
+                               "failed_writes,mib_written";
+    std::cout << header << std::endl;
+    results_csv << header << std::endl;
+
+    bench::warm_up([&] { run("cancel", nullptr); });
+
+    for (const auto* scenario : { "stop", "cancel", "token", "deadline" }) {
+        run(scenario, &results_csv);
+    }
+    return 0;
+}
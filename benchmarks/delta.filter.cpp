@@ -0,0 +1,150 @@
+#include "benchmarks.hh"
+#include "delta.filter.hh"
+
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <sstream>
+
+namespace {
+const size_t frame_width = 256;
+const size_t frame_height = 256;
+const size_t nframes = 128;
+const int nruns = 5;
+
+// A slowly drifting, spatially smooth scene with a little sensor noise.
+template<typename T>
+std::vector<uint8_t>
+make_volume() {
+    std::mt19937 rng(0);
+    std::uniform_int_distribution<int> noise(0, 3);
+
+    const size_t n = frame_width * frame_height * nframes;
+    std::vector<uint8_t> volume(n * sizeof(T));
+    auto* px = reinterpret_cast<T*>(volume.data());
+    for (size_t t = 0; t < nframes; ++t) {
+        for (size_t y = 0; y < frame_height; ++y) {
+            for (size_t x = 0; x < frame_width; ++x) {
+                const double v = 1000.0 +
+                                 400.0 * std::sin(0.02 * x + 0.01 * t) +
+                                 300.0 * std::cos(0.03 * y) + noise(rng);
+                const double scale = sizeof(T) == 1 ? 1.0 / 16.0 : 1.0;
+                px[(t * frame_height + y) * frame_width + x] =
+                  static_cast<T>(v * scale);
+            }
+        }
+    }
+    return volume;
+}
+
+// Shannon entropy of the byte stream, as a proxy for compressibility.
+double
+entropy_bits_per_byte(const std::vector<uint8_t>& data) {
+    std::array<size_t, 256> histogram{};
+    for (const auto b : data) {
+        ++histogram[b];
+    }
+
+    double entropy = 0;
+    for (const auto count : histogram) {
+        if (count > 0) {
+            const double p = static_cast<double>(count) / data.size();
+            entropy -= p * std::log2(p);
+        }
+    }
+    return entropy;
+}
+
+// Best-of-n seconds per GB of @p stage applied to a copy of @p input.
+double
+seconds_per_gb(const zarr::ChunkStage& stage,
+               const std::vector<uint8_t>& input,
+               std::vector<uint8_t>& output) {
+    double best_s = 1e30;
+    for (auto run = 0; run < nruns; ++run) {
+        output = input;
+        auto start = std::chrono::high_resolution_clock::now();
+        stage(output);
+        auto end = std::chrono::high_resolution_clock::now();
+        best_s =
+          std::min(best_s, std::chrono::duration<double>(end - start).count());
+    }
+    return best_s / (static_cast<double>(input.size()) / 1e9);
+}
+
+template<typename T>
+bool
+run_filters(const std::string& dtype, std::ostream& results_csv) {
+    const auto volume = make_volume<T>();
+    const double entropy_before = entropy_bits_per_byte(volume);
+
+    struct Case
+    {
+        std::string filter;
+        std::string axis;
+        zarr::ChunkStage encode, decode;
+    };
+
+    const size_t frame = frame_width * frame_height;
+    const std::vector<Case> cases = {
+        { "delta",
+          "x",
+          zarr::delta_stage<T>(1),
+          zarr::delta_inverse_stage<T>(1) },
+        { "delta",
+          "y",
+          zarr::delta_stage<T>(frame_width),
+          zarr::delta_inverse_stage<T>(frame_width) },
+        { "delta",
+          "t",
+          zarr::delta_stage<T>(frame),
+          zarr::delta_inverse_stage<T>(frame) },
+        { "predictor",
+          "x",
+          zarr::predictor_stage<T>(1),
+          zarr::predictor_inverse_stage<T>(1) },
+        { "predictor",
+          "t",
+          zarr::predictor_stage<T>(frame),
+          zarr::predictor_inverse_stage<T>(frame) },
+    };
+
+    std::vector<uint8_t> encoded, decoded;
+    for (const auto& c : cases) {
+        const double encode_s = seconds_per_gb(c.encode, volume, encoded);
+        const double decode_s = seconds_per_gb(c.decode, encoded, decoded);
+        if (decoded != volume) {
+            std::cerr << c.filter << " along " << c.axis << " (" << dtype
+                      << ") did not round-trip" << std::endl;
+            return false;
+        }
+
+        std::stringstream ss;
+        ss << c.filter << "," << dtype << "," << c.axis << "," << encode_s
+           << "," << decode_s << "," << entropy_before << ","
+           << entropy_bits_per_byte(encoded);
+
+        std::cout << ss.str() << std::endl;
+        results_csv << ss.str() << std::endl;
+    }
+    return true;
+}
+} // namespace
+
+int
+bench::delta_filter() {
+    std::ofstream results_csv("delta_filter.csv");
+    const std::string header = "filter,dtype,axis,encode_s_per_gb,"
+                               "decode_s_per_gb,entropy_before,entropy_after";
+    std::cout << header << std::endl;
+    results_csv << header << std::endl;
+
+    if (!run_filters<uint8_t>("uint8", results_csv) ||
+        !run_filters<uint16_t>("uint16", results_csv)) {
+        return 1;
+    }
+    return 0;
+}
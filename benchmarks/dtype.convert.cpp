@@ -0,0 +1,241 @@
+#include "benchmarks.hh"
+#include "dtype.convert.hh"
+
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <sstream>
+
+namespace fs = std::filesystem;
+
+namespace {
+const size_t nelements = 16 * 1024 * 1024;
+const size_t nchunks = 32;
+const size_t elements_per_chunk = 1024 * 1024;
+const int nruns = 5;
+
+// Best-of-n throughput of @p kernel in GB/s of input.
+double
+throughput(size_t input_bytes, const std::function<void()>& kernel) {
+    double best_s = 1e30;
+    for (auto run = 0; run < nruns; ++run) {
+        auto start = std::chrono::high_resolution_clock::now();
+        kernel();
+        auto end = std::chrono::high_resolution_clock::now();
+        best_s =
+          std::min(best_s, std::chrono::duration<double>(end - start).count());
+    }
+    return static_cast<double>(input_bytes) / best_s / 1e9;
+}
+
+void
+report(std::ostream& results_csv,
+       const std::string& kernel,
+       double gbps,
+       size_t bytes_written,
+       double write_ms) {
+    std::stringstream ss;
+    ss << kernel << "," << gbps << "," << bytes_written << "," << write_ms;
+    std::cout << ss.str() << std::endl;
+    results_csv << ss.str() << std::endl;
+}
+
+bool
+check(bool ok, const std::string& what) {
+    if (!ok) {
+        std::cerr << what << " did not round-trip" << std::endl;
+    }
+    return ok;
+}
+
+// Chunks with an odd number of values round-trip through the 12-bit stages,
+// and sizes pack_12bit never produces are rejected rather than over-read.
+bool
+odd_lengths() {
+    for (const size_t n : { 1, 3, 1023 }) {
+        std::vector<uint8_t> chunk(n * sizeof(uint16_t));
+        auto* px = reinterpret_cast<uint16_t*>(chunk.data());
+        for (size_t i = 0; i < n; ++i) {
+            px[i] = static_cast<uint16_t>((i * 37) & 0xfff);
+        }
+        const auto original = chunk;
+
+        zarr::ChunkPipeline pipeline;
+        pipeline.add_stage("pack_12bit", zarr::pack_12bit_stage());
+        pipeline.add_stage("unpack_12bit", zarr::unpack_12bit_stage());
+        std::vector<std::vector<uint8_t>> chunks{ chunk };
+        pipeline.apply(chunks);
+        if (!check(chunks.front() == original, "odd-length 12-bit chunk")) {
+            return false;
+        }
+    }
+
+    std::vector<uint8_t> truncated(4);
+    try {
+        zarr::unpack_12bit_stage()(truncated);
+    } catch (const std::invalid_argument&) {
+        return true;
+    }
+    std::cerr << "Unpacking a 4-byte 12-bit chunk did not throw" << std::endl;
+    return false;
+}
+
+// Time converting and writing 12-bit camera frames with and without packing.
+bool
+write_path(std::ostream& results_csv) {
+    std::mt19937 rng(0);
+    std::uniform_int_distribution<uint16_t> value(0, 4095);
+
+    std::vector<std::vector<uint8_t>> frames(nchunks);
+    for (auto& frame : frames) {
+        frame.resize(elements_per_chunk * sizeof(uint16_t));
+        auto* px = reinterpret_cast<uint16_t*>(frame.data());
+        for (size_t i = 0; i < elements_per_chunk; ++i) {
+            px[i] = value(rng);
+        }
+    }
+
+    const std::string path = "dtype_convert.bin";
+    for (const bool pack : { false, true }) {
+        auto chunks = frames;
+        zarr::ChunkPipeline pipeline;
+        if (pack) {
+            pipeline.add_stage("pack_12bit", zarr::pack_12bit_stage());
+        }
+
+        auto start = std::chrono::high_resolution_clock::now();
+        bool ok;
+        {
+            zarr::VectorizedFileWriter writer(path);
+            ok = pipeline.write(writer, chunks, 0);
+        }
+        auto end = std::chrono::high_resolution_clock::now();
+        if (fs::exists(path)) {
+            fs::remove(path);
+        }
+        if (!ok) {
+            std::cerr << "Failed to write " << path << std::endl;
+            return false;
+        }
+
+        size_t bytes_written = 0;
+        for (const auto& chunk : chunks) {
+            bytes_written += chunk.size();
+        }
+
+        if (pack) {
+            zarr::ChunkPipeline inverse;
+            inverse.add_stage("unpack_12bit", zarr::unpack_12bit_stage());
+            inverse.apply(chunks);
+            if (!check(chunks == frames, "12-bit write path")) {
+                return false;
+            }
+        }
+
+        report(results_csv,
+               pack ? "write_pack_12bit" : "write_raw_u16",
+               0,
+               bytes_written,
+               std::chrono::duration<double, std::milli>(end - start).count());
+    }
+    return true;
+}
+} // namespace
+
+int
+bench::dtype_convert() {
+    std::ofstream results_csv("dtype_convert.csv");
+    const std::string header = "kernel,gb_per_s,bytes_written,write_ms";
+    std::cout << header << std::endl;
+    results_csv << header << std::endl;
+
+    std::mt19937 rng(0);
+    std::uniform_int_distribution<uint16_t> u12(0, 4095);
+    std::normal_distribution<float> normal(0.f, 100.f);
+
+    std::vector<uint16_t> u16(nelements), u16_out(nelements);
+    std::vector<uint8_t> u8(zarr::packed_12bit_size(nelements));
+    for (auto& v : u16) {
+        v = u12(rng);
+    }
+
+    report(results_csv,
+           "pack_12bit",
+           throughput(nelements * sizeof(uint16_t),
+                      [&] { zarr::pack_12bit(u16.data(), nelements, u8.data()); }),
+           0,
+           0);
+    report(results_csv,
+           "unpack_12bit",
+           throughput(zarr::packed_12bit_size(nelements),
+                      [&] {
+                          zarr::unpack_12bit(
+                            u8.data(), nelements, u16_out.data());
+                      }),
+           0,
+           0);
+    if (!check(u16 == u16_out, "12-bit packing")) {
+        return 1;
+    }
+
+    report(results_csv,
+           "scale_u16_to_u8",
+           throughput(nelements * sizeof(uint16_t),
+                      [&] {
+                          zarr::scale_u16_to_u8(
+                            u16.data(), nelements, u8.data(), 4);
+                      }),
+           0,
+           0);
+    report(results_csv,
+           "scale_u8_to_u16",
+           throughput(nelements,
+                      [&] {
+                          zarr::scale_u8_to_u16(
+                            u8.data(), nelements, u16_out.data(), 4);
+                      }),
+           0,
+           0);
+    for (size_t i = 0; i < nelements; ++i) {
+        if (!check(u16_out[i] == (u16[i] & 0xff0), "u16 -> u8 scaling")) {
+            return 1;
+        }
+    }
+
+    std::vector<float> f32(nelements), f32_out(nelements);
+    for (auto& v : f32) {
+        v = normal(rng);
+    }
+    report(results_csv,
+           "float_to_half",
+           throughput(nelements * sizeof(float),
+                      [&] {
+                          zarr::float_to_half(
+                            f32.data(), nelements, u16_out.data());
+                      }),
+           0,
+           0);
+    report(results_csv,
+           "half_to_float",
+           throughput(nelements * sizeof(uint16_t),
+                      [&] {
+                          zarr::half_to_float(
+                            u16_out.data(), nelements, f32_out.data());
+                      }),
+           0,
+           0);
+    for (size_t i = 0; i < nelements; ++i) {
+        // half has an 11-bit significand
+        if (!check(std::fabs(f32_out[i] - f32[i]) <=
+                     std::fabs(f32[i]) / 2048.f + 6e-8f,
+                   "float -> half")) {
+            return 1;
+        }
+    }
+
+    return odd_lengths() && write_path(results_csv) ? 0 : 1;
+}
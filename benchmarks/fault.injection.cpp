@@ -0,0 +1,199 @@
+#include "benchmarks.hh"
+#include "fault.injector.hh"
+#include "file.sink.hh"
+#include "vectorized.file.writer.hh"
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <sstream>
+
+namespace fs = std::filesystem;
+
+namespace {
+const size_t bytes_per_chunk = 1024 * 1024;
+const size_t nchunks = 64;
+const size_t chunks_per_write = 4;
+const size_t max_attempts = 5;
+const std::string path = "fault_injection.bin";
+
+struct Scenario
+{
+    std::string name;
+    zarr::FaultInjector::Config config;
+};
+
+std::vector<Scenario>
+make_scenarios() {
+    std::vector<Scenario> scenarios(8);
+    scenarios[0].name = "none";
+
+    scenarios[1].name = "short-writes";
+    scenarios[1].config.short_write_probability = 0.3;
+
+    scenarios[2].name = "eintr";
+    scenarios[2].config.eintr_probability = 0.2;
+
+    scenarios[3].name = "eagain";
+    scenarios[3].config.eagain_probability = 0.2;
+
+    scenarios[4].name = "latency";
+    scenarios[4].config.latency_probability = 0.05;
+    scenarios[4].config.latency = std::chrono::milliseconds(20);
+
+    scenarios[5].name = "enospc";
+    scenarios[5].config.enospc_probability = 0.05;
+
+    // the disk fills halfway through, and space is freed before the retry
+    scenarios[6].name = "disk-full";
+    scenarios[6].config.capacity_bytes = nchunks * bytes_per_chunk / 2;
+
+    scenarios[7].name = "mixed";
+    scenarios[7].config.short_write_probability = 0.1;
+    scenarios[7].config.eintr_probability = 0.05;
+    scenarios[7].config.eagain_probability = 0.05;
+    scenarios[7].config.latency_probability = 0.01;
+    scenarios[7].config.latency = std::chrono::milliseconds(20);
+    return scenarios;
+}
+
+// every byte depends on its position, so misplaced data is caught
+std::vector<std::vector<uint8_t>>
+make_chunks() {
+    std::vector<std::vector<uint8_t>> chunks(nchunks);
+    for (size_t i = 0; i < nchunks; ++i) {
+        chunks[i].resize(bytes_per_chunk);
+        for (size_t j = 0; j < bytes_per_chunk; ++j) {
+            chunks[i][j] = static_cast<uint8_t>((i * 131 + j) & 0xff);
+        }
+    }
+    return chunks;
+}
+
+// A failed write is retried, as a caller would, after freeing up space in
+// case the disk was full. Returns the number of failed attempts, or
+// max_attempts if a write never succeeded.
+size_t
+write_chunks(const std::string& backend,
+             const std::vector<std::vector<uint8_t>>& chunks,
+             zarr::FaultInjector& injector) {
+    std::unique_ptr<zarr::VectorizedFileWriter> writer;
+    std::unique_ptr<zarr::FileSink> sink;
+    if (backend == "vectorized") {
+        writer = std::make_unique<zarr::VectorizedFileWriter>(path);
+    } else {
+        sink = std::make_unique<zarr::FileSink>(path);
+    }
+
+    size_t failed_attempts = 0;
+    for (size_t i = 0; i < chunks.size(); i += chunks_per_write) {
+        for (size_t attempt = 0;; ++attempt) {
+            bool ok = true;
+            try {
+                if (writer) {
+                    const std::vector<std::span<const uint8_t>> buffers(
+                      chunks.begin() + i,
+                      chunks.begin() + i + chunks_per_write);
+                    ok = writer->write_vectors(buffers, i * bytes_per_chunk);
+                } else {
+                    for (size_t j = i; ok && j < i + chunks_per_write; ++j) {
+                        ok = sink->write(j * bytes_per_chunk, chunks[j]);
+                    }
+                }
+            } catch (const std::exception& exc) {
+                std::cerr << "Write failed: " << exc.what() << std::endl;
+                ok = false;
+            }
+
+            if (ok) {
+                break;
+            }
+            ++failed_attempts;
+            if (attempt + 1 == max_attempts) {
+                return max_attempts;
+            }
+            injector.set_capacity(0);
+        }
+    }
+    return failed_attempts;
+}
+
+bool
+verify(const std::vector<std::vector<uint8_t>>& chunks) {
+    std::ifstream in(path, std::ios::binary);
+    std::vector<uint8_t> data(bytes_per_chunk);
+    for (const auto& chunk : chunks) {
+        in.read(reinterpret_cast<char*>(data.data()),
+                static_cast<std::streamsize>(data.size()));
+        if (!in || data != chunk) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void
+run(const std::string& backend,
+    const Scenario& scenario,
+    const std::vector<std::vector<uint8_t>>& chunks,
+    std::ostream* results_csv) {
+    if (fs::exists(path)) {
+        fs::remove(path);
+    }
+
+    zarr::FaultInjector injector(scenario.config);
+    zarr::FaultInjector::install(&injector);
+
+    auto start = std::chrono::high_resolution_clock::now();
+    const auto failed_attempts = write_chunks(backend, chunks, injector);
+    auto end = std::chrono::high_resolution_clock::now();
+
+    zarr::FaultInjector::install(nullptr);
+    const bool verified = verify(chunks);
+
+    if (fs::exists(path)) {
+        fs::remove(path);
+    }
+
+    if (results_csv == nullptr) {
+        return;
+    }
+
+    const double mib =
+      static_cast<double>(nchunks * bytes_per_chunk) / (1024.0 * 1024.0);
+    const double s = std::chrono::duration<double>(end - start).count();
+    const auto stats = injector.stats();
+
+    std::stringstream ss;
+    ss << backend << "," << scenario.name << "," << mib / s << ","
+       << stats.calls << "," << stats.faults() << "," << failed_attempts
+       << "," << (verified ? "yes" : "no");
+
+    std::cout << ss.str() << std::endl;
+    *results_csv << ss.str() << std::endl;
+}
+} // namespace
+
+int
+bench::fault_injection() {
+    std::ofstream results_csv("fault_injection.csv");
+    const std::string header =
+      "backend,scenario,mib_per_s,calls,faults,failed_attempts,verified";
+    std::cout << header << std::endl;
+    results_csv << header << std::endl;
+
+    const auto chunks = make_chunks();
+    const auto scenarios = make_scenarios();
+
+    for (const auto* backend : { "vectorized", "file-sink" }) {
+        bench::warm_up(
+          [&] { run(backend, scenarios.front(), chunks, nullptr); });
+
+        for (const auto& scenario : scenarios) {
+            run(backend, scenario, chunks, &results_csv);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,190 @@
+#include "benchmarks.hh"
+#include "shard.staging.hh"
+#include "vectorized.file.writer.hh"
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace fs = std::filesystem;
+
+namespace {
+const size_t bytes_per_chunk = 4 * 1024 * 1024;
+const size_t chunks_per_shard = 16;
+const size_t shard_bytes = bytes_per_chunk * chunks_per_shard;
+const size_t nshards = 4;
+const std::string path = "memfd_staging.bin";
+
+using Clock = std::chrono::high_resolution_clock;
+
+uint8_t
+fill_value(size_t shard, size_t chunk) {
+    return static_cast<uint8_t>(shard * chunks_per_shard + chunk + 1);
+}
+
+// Stand-in for encoding a shard's chunks.
+std::vector<std::vector<uint8_t>>
+make_chunks(size_t shard) {
+    std::vector<std::vector<uint8_t>> chunks;
+    for (size_t i = 0; i < chunks_per_shard; ++i) {
+        chunks.emplace_back(bytes_per_chunk, fill_value(shard, i));
+    }
+    return chunks;
+}
+
+std::vector<std::span<const uint8_t>>
+as_buffers(const std::vector<std::vector<uint8_t>>& chunks) {
+    return { chunks.begin(), chunks.end() };
+}
+
+void
+stage_shard(zarr::ShardStaging& staging, size_t shard) {
+    const auto chunks = make_chunks(shard);
+    if (!staging.write_vectors(as_buffers(chunks), 0)) {
+        throw std::runtime_error("Failed to stage shard");
+    }
+    staging.seal();
+}
+
+// Check the first byte of every chunk landed where it should.
+bool
+verify() {
+    std::ifstream file(path, std::ios::binary);
+    for (size_t s = 0; s < nshards; ++s) {
+        for (size_t i = 0; i < chunks_per_shard; ++i) {
+            const auto offset = s * shard_bytes + i * bytes_per_chunk;
+            char c = 0;
+            file.seekg(static_cast<std::streamoff>(offset));
+            if (!file.get(c) || static_cast<uint8_t>(c) != fill_value(s, i)) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+const char*
+method_name(zarr::ShardStaging::CopyMethod method) {
+    switch (method) {
+        case zarr::ShardStaging::CopyMethod::CopyFileRange:
+            return "copy_file_range";
+        case zarr::ShardStaging::CopyMethod::Sendfile:
+            return "sendfile";
+        case zarr::ShardStaging::CopyMethod::ReadWrite:
+            return "read-write";
+        default:
+            return "none";
+    }
+}
+
+void
+run(const std::string& strategy, std::ostream* results_csv) {
+    if (fs::exists(path)) {
+        fs::remove(path);
+    }
+
+    Clock::duration prepare{ 0 };
+    Clock::duration commit{ 0 };
+    auto method = zarr::ShardStaging::CopyMethod::None;
+
+    if (strategy == "pwritev") {
+        // baseline: the process that encodes the shard also writes it
+        zarr::VectorizedFileWriter writer(path);
+        for (size_t s = 0; s < nshards; ++s) {
+            const auto chunks = make_chunks(s);
+            const auto start = Clock::now();
+            writer.write_vectors(as_buffers(chunks), s * shard_bytes);
+            commit += Clock::now() - start;
+        }
+    } else {
+        std::vector<std::unique_ptr<zarr::ShardStaging>> shards;
+        for (size_t s = 0; s < nshards; ++s) {
+            shards.push_back(std::make_unique<zarr::ShardStaging>());
+        }
+
+        const auto start = Clock::now();
+        if (strategy == "staged-fork") {
+            // a separate process prepares the shards in the inherited
+            // staging areas and seals them
+            const pid_t pid = fork();
+            if (pid == 0) {
+                try {
+                    for (size_t s = 0; s < nshards; ++s) {
+                        stage_shard(*shards[s], s);
+                    }
+                } catch (...) {
+                    _exit(1);
+                }
+                _exit(0);
+            }
+            int status = 0;
+            waitpid(pid, &status, 0);
+            if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+                throw std::runtime_error("Staging process failed");
+            }
+        } else {
+            for (size_t s = 0; s < nshards; ++s) {
+                stage_shard(*shards[s], s);
+            }
+        }
+        prepare = Clock::now() - start;
+
+        const auto commit_start = Clock::now();
+        for (size_t s = 0; s < nshards; ++s) {
+            if (!shards[s]->commit(path, s * shard_bytes)) {
+                throw std::runtime_error("Failed to commit shard");
+            }
+            method = shards[s]->copy_method();
+        }
+        commit = Clock::now() - commit_start;
+    }
+
+    const bool ok = verify();
+    if (fs::exists(path)) {
+        fs::remove(path);
+    }
+    if (!ok) {
+        throw std::runtime_error(strategy + ": shard contents do not match");
+    }
+
+    if (results_csv == nullptr) {
+        return;
+    }
+
+    const auto ms = [](Clock::duration d) {
+        return std::chrono::duration<double, std::milli>(d).count();
+    };
+    const double mib =
+      static_cast<double>(nshards * shard_bytes) / (1024.0 * 1024.0);
+
+    std::stringstream ss;
+    ss << strategy << "," << method_name(method) << "," << ms(prepare) << ","
+       << ms(commit) << "," << 1000.0 * mib / ms(commit);
+
+    std::cout << ss.str() << std::endl;
+    *results_csv << ss.str() << std::endl;
+}
+} // namespace
+
+int
+bench::memfd_staging() {
+    std::ofstream results_csv("memfd_staging.csv");
+    const std::string header =
+      "strategy,copy_method,prepare_ms,commit_ms,commit_mib_per_s";
+    std::cout << header << std::endl;
+    results_csv << header << std::endl;
+
+    bench::warm_up([&] { run("pwritev", nullptr); });
+
+    for (const auto* strategy : { "pwritev", "staged", "staged-fork" }) {
+        run(strategy, &results_csv);
+    }
+    return 0;
+}
@@ -0,0 +1,118 @@
+#include "benchmarks.hh"
+#include "metadata.writer.hh"
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+namespace fs = std::filesystem;
+
+namespace {
+const size_t ngroups = 8;
+const size_t arrays_per_group = 16;
+const size_t narrays = ngroups * arrays_per_group;
+const std::string root = "metadata_batch.zarr";
+
+using Clock = std::chrono::high_resolution_clock;
+
+std::string
+array_metadata(size_t group, size_t array) {
+    std::stringstream ss;
+    ss << R"({"zarr_format":3,"node_type":"array","shape":[4096,2048,2048],)"
+       << R"("data_type":"uint16","chunk_grid":{"name":"regular",)"
+       << R"("configuration":{"chunk_shape":[256,256,256]}},)"
+       << R"("chunk_key_encoding":{"name":"default"},"fill_value":0,)"
+       << R"("codecs":[{"name":"bytes","configuration":)"
+       << R"({"endian":"little"}}],"attributes":{"group":)" << group
+       << R"(,"array":)" << array << "}}";
+    return ss.str();
+}
+
+std::string
+group_metadata() {
+    return R"({"zarr_format":3,"node_type":"group","attributes":{}})";
+}
+
+// Create a hierarchy of ngroups groups of arrays_per_group arrays each, as
+// an acquisition does when it starts, and time until its metadata is
+// durable.
+void
+run(const std::string& strategy, std::ostream* results_csv) {
+    if (fs::exists(root)) {
+        fs::remove_all(root);
+    }
+
+    const bool batched = strategy != "per-file";
+    const bool sync = strategy != "batched-nosync";
+    const bool consolidate = strategy == "batched-consolidated";
+    const size_t nthreads = strategy == "batched-1-thread" ? 1 : 8;
+    zarr::MetadataWriter writer(root, batched ? nthreads : 1, sync);
+
+    // a per-file writer creates, writes and syncs each file as it goes
+    const auto add = [&](const std::string& key, std::string document) {
+        writer.add(key, std::move(document));
+        return batched || writer.flush();
+    };
+
+    const auto start = Clock::now();
+    bool ok = add("zarr.json", group_metadata());
+    for (size_t g = 0; g < ngroups; ++g) {
+        const auto group = "group" + std::to_string(g);
+        ok = add(group + "/zarr.json", group_metadata()) && ok;
+        for (size_t a = 0; a < arrays_per_group; ++a) {
+            ok = add(group + "/array" + std::to_string(a) + "/zarr.json",
+                     array_metadata(g, a)) &&
+                 ok;
+        }
+    }
+    ok = writer.flush(consolidate) && ok;
+    const auto elapsed = Clock::now() - start;
+
+    if (!ok) {
+        std::cerr << strategy << ": failed to write metadata" << std::endl;
+    }
+
+    const auto stats = writer.stats();
+    if (fs::exists(root)) {
+        fs::remove_all(root);
+    }
+
+    if (results_csv == nullptr) {
+        return;
+    }
+
+    const double ms =
+      std::chrono::duration<double, std::milli>(elapsed).count();
+
+    std::stringstream ss;
+    ss << strategy << "," << stats.files_written << "," << ms << ","
+       << 1000.0 * ms / static_cast<double>(narrays) << ","
+       << stats.file_syncs << "," << stats.directory_syncs << ","
+       << stats.bytes_written;
+
+    std::cout << ss.str() << std::endl;
+    *results_csv << ss.str() << std::endl;
+}
+} // namespace
+
+int
+bench::metadata_batch() {
+    std::ofstream results_csv("metadata_batch.csv");
+    const std::string header = "strategy,files,total_ms,us_per_array,"
+                               "file_syncs,directory_syncs,bytes";
+    std::cout << header << std::endl;
+    results_csv << header << std::endl;
+
+    bench::warm_up([&] { run("batched", nullptr); });
+
+    for (const auto* strategy : { "per-file",
+                                  "batched-1-thread",
+                                  "batched",
+                                  "batched-consolidated",
+                                  "batched-nosync" }) {
+        run(strategy, &results_csv);
+    }
+    return 0;
+}
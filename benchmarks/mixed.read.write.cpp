@@ -0,0 +1,273 @@
+#include "benchmarks.hh"
+#include "log2.histogram.hh"
+#include "shard.builder.hh"
+#include "shard.reader.hh"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <thread>
+
+namespace fs = std::filesystem;
+
+namespace {
+const std::vector<uint32_t> chunks_per_shard{ 8, 8 };
+const size_t bytes_per_chunk = 64 * 1024;
+const size_t max_shards = 256;
+const size_t recent_shards = 4; // readers touch the latest few shards
+const size_t random_reads_per_open = 16;
+const auto duration = std::chrono::seconds(2);
+const std::string directory = "mixed_read_write";
+
+using Clock = std::chrono::high_resolution_clock;
+
+struct Scenario
+{
+    std::string name;
+    size_t random_readers;
+    size_t sequential_readers;
+};
+
+// What one side of the test did.
+struct Side
+{
+    zarr::Log2Histogram latency_us;
+    std::atomic<uint64_t> bytes{ 0 };
+    std::atomic<uint64_t> errors{ 0 };
+    double seconds = 0; // if active for less than the whole test
+};
+
+std::string
+shard_path(size_t shard) {
+    return (fs::path(directory) / (std::to_string(shard) + ".shard"))
+      .string();
+}
+
+uint8_t
+fill_value(size_t shard, size_t chunk) {
+    return static_cast<uint8_t>(shard * 7 + chunk);
+}
+
+uint64_t
+elapsed_us(Clock::time_point start) {
+    return static_cast<uint64_t>(
+      std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() -
+                                                            start)
+        .count());
+}
+
+// Acquisition: write shard after shard, publishing each once written.
+void
+write_shards(const zarr::ShardLayout& layout,
+             const std::atomic<bool>& stop,
+             std::atomic<size_t>& published,
+             Side& side) {
+    std::vector<std::vector<uint8_t>> chunks(layout.size());
+    zarr::ShardBuilder builder(layout);
+
+    const auto writing_start = Clock::now();
+    for (size_t shard = 0; shard < max_shards && !stop; ++shard) {
+        for (size_t i = 0; i < chunks.size(); ++i) {
+            chunks[i].assign(bytes_per_chunk, fill_value(shard, i));
+        }
+
+        const auto start = Clock::now();
+        bool ok;
+        {
+            zarr::VectorizedFileWriter writer(shard_path(shard));
+            ok = builder.write(writer, chunks);
+        }
+        side.latency_us.record(elapsed_us(start));
+
+        if (!ok) {
+            side.errors.fetch_add(1, std::memory_order_relaxed);
+        }
+        side.bytes.fetch_add(builder.shard_size(), std::memory_order_relaxed);
+        published.store(shard + 1, std::memory_order_release);
+    }
+    side.seconds =
+      std::chrono::duration<double>(Clock::now() - writing_start).count();
+}
+
+// QC: open one of the latest shards and read from it, until stopped.
+// Random readers time each of a few random chunk reads; sequential readers
+// time reading the whole shard.
+void
+read_shards(const zarr::ShardLayout& layout,
+            bool sequential,
+            unsigned seed,
+            const std::atomic<bool>& stop,
+            const std::atomic<size_t>& published,
+            Side& side) {
+    std::mt19937 rng(seed);
+    std::vector<size_t> all_chunks(layout.size());
+    for (size_t i = 0; i < all_chunks.size(); ++i) {
+        all_chunks[i] = i;
+    }
+
+    while (!stop) {
+        const auto n = published.load(std::memory_order_acquire);
+        if (n == 0) {
+            std::this_thread::yield();
+            continue;
+        }
+        const auto first = n > recent_shards ? n - recent_shards : 0;
+        const size_t shard =
+          std::uniform_int_distribution<size_t>(first, n - 1)(rng);
+
+        try {
+            zarr::ShardReader reader(shard_path(shard), layout);
+            if (sequential) {
+                const auto start = Clock::now();
+                const auto chunks = reader.read_chunks(all_chunks);
+                side.latency_us.record(elapsed_us(start));
+                for (size_t i = 0; i < chunks.size(); ++i) {
+                    if (chunks[i].empty() ||
+                        chunks[i].front() != fill_value(shard, i)) {
+                        side.errors.fetch_add(1, std::memory_order_relaxed);
+                    }
+                    side.bytes.fetch_add(chunks[i].size(),
+                                         std::memory_order_relaxed);
+                }
+                continue;
+            }
+
+            std::uniform_int_distribution<size_t> pick(0, layout.size() - 1);
+            for (size_t r = 0; r < random_reads_per_open; ++r) {
+                const auto i = pick(rng);
+                const auto start = Clock::now();
+                const auto chunk = reader.read_chunk(i);
+                side.latency_us.record(elapsed_us(start));
+                if (chunk.empty() || chunk.front() != fill_value(shard, i)) {
+                    side.errors.fetch_add(1, std::memory_order_relaxed);
+                }
+                side.bytes.fetch_add(chunk.size(), std::memory_order_relaxed);
+            }
+        } catch (const std::exception&) {
+            side.errors.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+}
+
+void
+report(const std::string& scenario,
+       const std::string& side_name,
+       size_t nthreads,
+       const Side& side,
+       double s,
+       std::ostream& results_csv) {
+    if (side.seconds > 0) {
+        s = std::min(s, side.seconds);
+    }
+
+    std::stringstream ss;
+    ss << scenario << "," << side_name << "," << nthreads << ","
+       << static_cast<double>(side.bytes) / (1024.0 * 1024.0) / s << ","
+       << side.latency_us.count() << "," << side.latency_us.percentile(0.5)
+       << "," << side.latency_us.percentile(0.99) << ","
+       << side.latency_us.max() << "," << side.errors;
+
+    std::cout << ss.str() << std::endl;
+    results_csv << ss.str() << std::endl;
+}
+
+void
+run(const Scenario& scenario, std::ostream* results_csv) {
+    if (fs::exists(directory)) {
+        fs::remove_all(directory);
+    }
+    fs::create_directories(directory);
+
+    zarr::ShardLayout layout(chunks_per_shard, zarr::ChunkOrder::C);
+    std::atomic<bool> stop{ false };
+    std::atomic<size_t> published{ 0 };
+    Side writer, random_readers, sequential_readers;
+
+    const auto start = Clock::now();
+    std::vector<std::thread> threads;
+    threads.emplace_back(
+      [&] { write_shards(layout, stop, published, writer); });
+    for (size_t i = 0; i < scenario.random_readers; ++i) {
+        threads.emplace_back([&, i] {
+            read_shards(layout,
+                        false,
+                        static_cast<unsigned>(i),
+                        stop,
+                        published,
+                        random_readers);
+        });
+    }
+    for (size_t i = 0; i < scenario.sequential_readers; ++i) {
+        threads.emplace_back([&, i] {
+            read_shards(layout,
+                        true,
+                        static_cast<unsigned>(100 + i),
+                        stop,
+                        published,
+                        sequential_readers);
+        });
+    }
+
+    std::this_thread::sleep_for(duration);
+    stop = true;
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    const double s = std::chrono::duration<double>(Clock::now() - start)
+                       .count();
+
+    if (fs::exists(directory)) {
+        fs::remove_all(directory);
+    }
+
+    if (results_csv == nullptr) {
+        return;
+    }
+
+    report(scenario.name, "writer", 1, writer, s, *results_csv);
+    if (scenario.random_readers > 0) {
+        report(scenario.name,
+               "random-reader",
+               scenario.random_readers,
+               random_readers,
+               s,
+               *results_csv);
+    }
+    if (scenario.sequential_readers > 0) {
+        report(scenario.name,
+               "sequential-reader",
+               scenario.sequential_readers,
+               sequential_readers,
+               s,
+               *results_csv);
+    }
+}
+} // namespace
+
+int
+bench::mixed_read_write() {
+    std::ofstream results_csv("mixed_read_write.csv");
+    const std::string header = "scenario,side,threads,mib_per_s,operations,"
+                               "p50_us,p99_us,max_us,errors";
+    std::cout << header << std::endl;
+    results_csv << header << std::endl;
+
+    const std::vector<Scenario> scenarios{
+        { "write-only", 0, 0 },
+        { "random-readers", 2, 0 },
+        { "sequential-readers", 0, 2 },
+        { "mixed", 2, 2 },
+    };
+
+    bench::warm_up([&] { run(scenarios.front(), nullptr); });
+
+    for (const auto& scenario : scenarios) {
+        run(scenario, &results_csv);
+    }
+    return 0;
+}
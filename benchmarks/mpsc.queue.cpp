@@ -0,0 +1,138 @@
+#include "benchmarks.hh"
+#include "async.chunk.writer.hh"
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <thread>
+
+namespace fs = std::filesystem;
+
+namespace {
+const size_t bytes_per_chunk = 64 * 1024;
+const size_t nchunks = 2048;
+
+// Chunk i of producer p lands in slot i * nproducers + p, so together the
+// producers fill the file contiguously, as they would a shard.
+size_t
+slot_offset(size_t producer, size_t i, size_t nproducers) {
+    return (i * nproducers + producer) * bytes_per_chunk;
+}
+
+std::vector<std::vector<std::vector<uint8_t>>>
+make_chunks(size_t nproducers) {
+    std::vector<std::vector<std::vector<uint8_t>>> chunks(nproducers);
+    for (auto& producer_chunks : chunks) {
+        producer_chunks.assign(nchunks / nproducers,
+                               std::vector<uint8_t>(bytes_per_chunk, 1));
+    }
+    return chunks;
+}
+
+// Baseline: every producer writes its own chunks, serialized by the
+// writer's mutex.
+double
+run_mutex(size_t nproducers, const std::string& path) {
+    auto chunks = make_chunks(nproducers);
+    zarr::VectorizedFileWriter writer(path);
+
+    auto start = std::chrono::high_resolution_clock::now();
+    std::vector<std::thread> producers;
+    for (size_t p = 0; p < nproducers; ++p) {
+        producers.emplace_back([&, p] {
+            for (size_t i = 0; i < chunks[p].size(); ++i) {
+                const std::vector<std::span<const uint8_t>> buffers{
+                    chunks[p][i]
+                };
+                writer.write_vectors(buffers, slot_offset(p, i, nproducers));
+            }
+        });
+    }
+    for (auto& producer : producers) {
+        producer.join();
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+
+    return std::chrono::duration<double>(end - start).count();
+}
+
+double
+run_queue(size_t nproducers,
+          const std::string& path,
+          std::ostream* results_csv,
+          double mutex_s) {
+    auto chunks = make_chunks(nproducers);
+    zarr::VectorizedFileWriter writer(path);
+    zarr::AsyncChunkWriter async_writer(writer, 256);
+
+    auto start = std::chrono::high_resolution_clock::now();
+    std::vector<std::thread> producers;
+    for (size_t p = 0; p < nproducers; ++p) {
+        producers.emplace_back([&, p] {
+            for (size_t i = 0; i < chunks[p].size(); ++i) {
+                async_writer.submit(std::move(chunks[p][i]),
+                                    slot_offset(p, i, nproducers));
+            }
+        });
+    }
+    for (auto& producer : producers) {
+        producer.join();
+    }
+    async_writer.flush();
+    auto end = std::chrono::high_resolution_clock::now();
+    const double queue_s = std::chrono::duration<double>(end - start).count();
+
+    if (results_csv == nullptr) {
+        return queue_s;
+    }
+
+    const auto stats = async_writer.stats();
+    const auto& handoff = async_writer.handoff_latency_us();
+    const auto& batches = async_writer.batch_sizes();
+
+    const double mib = static_cast<double>(nchunks * bytes_per_chunk) /
+                       (1024.0 * 1024.0);
+    std::stringstream ss;
+    ss << nproducers << "," << mib / mutex_s << "," << mib / queue_s << ","
+       << handoff.percentile(0.5) << "," << handoff.percentile(0.99) << ","
+       << handoff.max() << "," << batches.mean() << ","
+       << batches.percentile(0.5) << "," << batches.percentile(0.99) << ","
+       << batches.max() << "," << stats.write_calls << ","
+       << stats.failed_writes;
+
+    std::cout << ss.str() << std::endl;
+    *results_csv << ss.str() << std::endl;
+    return queue_s;
+}
+} // namespace
+
+int
+bench::mpsc_queue() {
+    std::ofstream results_csv("mpsc_queue.csv");
+    const std::string header =
+      "producers,mutex_mib_per_s,queue_mib_per_s,handoff_p50_us,"
+      "handoff_p99_us,handoff_max_us,batch_mean,batch_p50,batch_p99,"
+      "batch_max,write_calls,failed_writes";
+    std::cout << header << std::endl;
+    results_csv << header << std::endl;
+
+    const std::string path = "mpsc_queue.bin";
+
+    bench::warm_up([&] { run_queue(1, path, nullptr, 0); }, path);
+
+    for (const size_t nproducers : { 1, 2, 4, 8 }) {
+        const double mutex_s = run_mutex(nproducers, path);
+        if (fs::exists(path)) {
+            fs::remove(path);
+        }
+
+        run_queue(nproducers, path, &results_csv, mutex_s);
+        if (fs::exists(path)) {
+            fs::remove(path);
+        }
+    }
+
+    return 0;
+}
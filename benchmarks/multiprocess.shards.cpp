@@ -0,0 +1,176 @@
+#include "benchmarks.hh"
+#include "shard.coordinator.hh"
+#include "vectorized.file.writer.hh"
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace fs = std::filesystem;
+
+namespace {
+const size_t bytes_per_chunk = 1024 * 1024;
+const size_t chunks_per_shard = 4;
+const size_t shard_bytes = bytes_per_chunk * chunks_per_shard;
+const size_t nshards = 64; // fits in an exit status
+const std::string directory = "multiprocess_shards.zarr";
+
+std::string
+shard_path(size_t shard) {
+    return (fs::path(directory) / "c" / std::to_string(shard)).string();
+}
+
+// A writer process for run @p run: claim shards until every shard is
+// complete, writing each claimed one. Returns the number of shards written.
+// With @p crash_after_claim, die holding the first shard claimed instead.
+int
+write_shards(uint64_t run, bool crash_after_claim) {
+    zarr::ShardCoordinator coordinator(directory, nshards, run);
+    std::vector<std::vector<uint8_t>> chunks(chunks_per_shard);
+
+    int written = 0;
+    while (coordinator.remaining() > 0) {
+        const auto shard = coordinator.claim();
+        if (!shard) {
+            // the rest are being written; wait in case a writer dies
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            continue;
+        }
+
+        for (auto& chunk : chunks) {
+            chunk.assign(bytes_per_chunk, static_cast<uint8_t>(*shard));
+        }
+        zarr::FileOpenOptions options;
+        options.truncate = true;
+        zarr::VectorizedFileWriter writer(shard_path(*shard), options);
+
+        if (crash_after_claim) {
+            // leave the shard part-written
+            writer.write_vectors(
+              std::vector<std::span<const uint8_t>>{ chunks.front() }, 0);
+            _exit(0);
+        }
+
+        if (!writer.write_vectors(chunks, 0)) {
+            coordinator.release(*shard);
+            continue;
+        }
+        coordinator.complete(*shard);
+        ++written;
+    }
+    return written;
+}
+
+// Every shard complete in run @p run, whole and holding its own data.
+bool
+verify(uint64_t run) {
+    zarr::ShardCoordinator coordinator(directory, nshards, run);
+    for (size_t i = 0; i < nshards; ++i) {
+        const auto path = shard_path(i);
+        if (!coordinator.completed(i) || !fs::exists(path) ||
+            fs::file_size(path) != shard_bytes) {
+            return false;
+        }
+        std::ifstream file(path, std::ios::binary);
+        std::vector<char> data(shard_bytes);
+        file.read(data.data(), static_cast<std::streamsize>(data.size()));
+        if (std::any_of(data.begin(), data.end(), [i](char c) {
+                return static_cast<uint8_t>(c) != static_cast<uint8_t>(i);
+            })) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void
+run(size_t nprocesses, bool crash, std::ostream* results_csv) {
+    // each run rewrites the array, reusing the previous run's lease file,
+    // which the new run id resets
+    static uint64_t run_id = 0;
+    const uint64_t run = ++run_id;
+    fs::remove_all(fs::path(directory) / "c");
+    fs::create_directories(fs::path(directory) / "c");
+
+    const auto start = std::chrono::high_resolution_clock::now();
+    std::vector<pid_t> pids;
+    for (size_t p = 0; p < nprocesses; ++p) {
+        const pid_t pid = fork();
+        if (pid == 0) {
+            int written = 0;
+            try {
+                written = write_shards(run, crash && p == 0);
+            } catch (...) {
+                _exit(255);
+            }
+            _exit(written);
+        }
+        pids.push_back(pid);
+    }
+
+    std::vector<size_t> per_process;
+    for (const auto pid : pids) {
+        int status = 0;
+        waitpid(pid, &status, 0);
+        if (!WIFEXITED(status) || WEXITSTATUS(status) == 255) {
+            throw std::runtime_error("Writer process failed");
+        }
+        per_process.push_back(static_cast<size_t>(WEXITSTATUS(status)));
+    }
+    const auto end = std::chrono::high_resolution_clock::now();
+
+    const bool ok = verify(run);
+
+    if (results_csv == nullptr) {
+        return;
+    }
+
+    size_t written = 0;
+    for (const auto n : per_process) {
+        written += n;
+    }
+    const double s = std::chrono::duration<double>(end - start).count();
+    const double mib =
+      static_cast<double>(nshards * shard_bytes) / (1024.0 * 1024.0);
+
+    std::stringstream ss;
+    ss << nprocesses << "," << (crash ? "crash" : "clean") << "," << mib / s
+       << "," << written << ","
+       << *std::min_element(per_process.begin(), per_process.end()) << ","
+       << *std::max_element(per_process.begin(), per_process.end()) << ","
+       << (ok ? "yes" : "no");
+
+    std::cout << ss.str() << std::endl;
+    *results_csv << ss.str() << std::endl;
+}
+} // namespace
+
+int
+bench::multiprocess_shards() {
+    std::ofstream results_csv("multiprocess_shards.csv");
+    const std::string header = "processes,scenario,mib_per_s,shards_written,"
+                               "min_per_process,max_per_process,verified";
+    std::cout << header << std::endl;
+    results_csv << header << std::endl;
+
+    // start from no lease file, so run ids from an earlier test cannot match
+    fs::remove_all(directory);
+
+    bench::warm_up([&] { run(1, false, nullptr); });
+
+    for (const size_t nprocesses : { 1, 2, 4, 8 }) {
+        run(nprocesses, false, &results_csv);
+    }
+    run(4, true, &results_csv);
+
+    fs::remove_all(directory);
+    return 0;
+}
@@ -0,0 +1,110 @@
+#include "benchmarks.hh"
+#include "async.chunk.writer.hh"
+#include "buffer.pool.hh"
+#include "numa.topology.hh"
+
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <thread>
+
+namespace fs = std::filesystem;
+
+namespace {
+const size_t bytes_per_chunk = 1024 * 1024;
+const size_t nchunks = 1024;
+const size_t nbuffers = 64;
+
+// Fill chunks from buffers placed on @p buffer_node and write them, with the
+// producer and writer threads pinned to @p thread_node, or unpinned if it is
+// negative. Returns MiB/s, or a negative value if pinning failed.
+double
+run(zarr::NumaBufferPool& pools,
+    int buffer_node,
+    int thread_node,
+    const std::string& path) {
+    auto& pool = pools.pool(buffer_node);
+
+    zarr::VectorizedFileWriter writer(path);
+    zarr::AsyncChunkWriter async_writer(writer);
+
+    bool pinned = true;
+    auto start = std::chrono::high_resolution_clock::now();
+    std::thread producer([&] {
+        if (thread_node >= 0) {
+            pinned = zarr::pin_current_thread_to_numa_node(thread_node) &&
+                     async_writer.pin_to_numa_node(thread_node);
+        }
+
+        for (size_t i = 0; i < nchunks; ++i) {
+            // wait for a written buffer rather than allocate off-node
+            while (pool.idle() == 0) {
+                std::this_thread::yield();
+            }
+            auto chunk = pool.acquire(bytes_per_chunk);
+            memset(chunk.data(), static_cast<int>(i & 0xff), chunk.size());
+            async_writer.submit(std::move(chunk), i * bytes_per_chunk);
+        }
+    });
+    producer.join();
+    async_writer.flush();
+    auto end = std::chrono::high_resolution_clock::now();
+
+    if (!pinned) {
+        return -1;
+    }
+
+    const double mib = static_cast<double>(nchunks * bytes_per_chunk) /
+                       (1024.0 * 1024.0);
+    return mib / std::chrono::duration<double>(end - start).count();
+}
+} // namespace
+
+int
+bench::numa_placement() {
+    std::ofstream results_csv("numa_placement.csv");
+    const std::string header = "buffer_node,thread_node,device_node,mib_per_s";
+    std::cout << header << std::endl;
+    results_csv << header << std::endl;
+
+    const std::string path = "numa_placement.bin";
+    const int device_node = zarr::numa_node_of_path(fs::current_path());
+
+    zarr::NumaBufferPool pools(nbuffers);
+    for (const int node : pools.nodes()) {
+        pools.reserve(node, nbuffers, bytes_per_chunk);
+    }
+
+    bench::warm_up([&] { run(pools, pools.nodes().front(), -1, path); }, path);
+
+    for (const int buffer_node : pools.nodes()) {
+        std::vector<int> thread_nodes = pools.nodes();
+        thread_nodes.push_back(-1); // unpinned
+
+        for (const int thread_node : thread_nodes) {
+            const double mib_per_s =
+              run(pools, buffer_node, thread_node, path);
+            if (fs::exists(path)) {
+                fs::remove(path);
+            }
+            if (mib_per_s < 0) {
+                std::cerr << "Failed to pin threads to node " << thread_node
+                          << std::endl;
+                continue;
+            }
+
+            std::stringstream ss;
+            ss << buffer_node << ","
+               << (thread_node < 0 ? "any" : std::to_string(thread_node))
+               << "," << device_node << "," << mib_per_s;
+
+            std::cout << ss.str() << std::endl;
+            results_csv << ss.str() << std::endl;
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,335 @@
+#include "benchmarks.hh"
+#include "object.store.sink.hh"
+
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace {
+const size_t bytes_per_chunk = 1024 * 1024;
+const size_t chunks_per_write = 8;
+const size_t nchunks = 128;
+const auto request_latency = std::chrono::milliseconds(2);
+
+uint8_t
+chunk_byte(size_t i) {
+    return static_cast<uint8_t>((i * 31 + 7) & 0xff);
+}
+
+std::string
+fnv1a(const std::vector<uint8_t>& data) {
+    uint64_t hash = 14695981039346656037ull;
+    for (const auto byte : data) {
+        hash = (hash ^ byte) * 1099511628211ull;
+    }
+    std::stringstream ss;
+    ss << "\"" << std::hex << hash << "\"";
+    return ss.str();
+}
+
+/**
+ * @brief In-process stand-in for an S3-compatible store: the multipart
+ * upload subset of the API over HTTP/1.1 on a loopback port, with parts held
+ * in memory. Every request is delayed by request_latency, standing in for
+ * the round trip to a remote store.
+ */
+class StandInStore
+{
+  public:
+    StandInStore()
+      : next_upload_(0) {
+        listen_fd_ = socket(AF_INET, SOCK_STREAM, 0);
+        sockaddr_in address{};
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        address.sin_port = 0; // any free port
+        socklen_t length = sizeof(address);
+        if (listen_fd_ < 0 ||
+            bind(listen_fd_,
+                 reinterpret_cast<sockaddr*>(&address),
+                 sizeof(address)) < 0 ||
+            listen(listen_fd_, 16) < 0 ||
+            getsockname(listen_fd_,
+                        reinterpret_cast<sockaddr*>(&address),
+                        &length) < 0) {
+            throw std::runtime_error("Failed to start the stand-in store");
+        }
+        port_ = ntohs(address.sin_port);
+        acceptor_ = std::thread([this] { accept_(); });
+    }
+
+    ~StandInStore() {
+        shutdown(listen_fd_, SHUT_RDWR);
+        acceptor_.join();
+        close(listen_fd_);
+
+        {
+            std::scoped_lock lock(mutex_);
+            for (const auto fd : connections_) {
+                shutdown(fd, SHUT_RDWR);
+            }
+        }
+        for (auto& thread : threads_) {
+            thread.join();
+        }
+    }
+
+    uint16_t port() const { return port_; }
+
+    /// Take the completed object at @p path out of the store.
+    std::vector<uint8_t> take(const std::string& path) {
+        std::scoped_lock lock(mutex_);
+        auto object = std::move(objects_[path]);
+        objects_.erase(path);
+        return object;
+    }
+
+  private:
+    int listen_fd_;
+    uint16_t port_;
+    std::thread acceptor_;
+
+    std::mutex mutex_;
+    std::vector<int> connections_;
+    std::vector<std::thread> threads_;
+    size_t next_upload_;
+    std::map<std::string, std::map<int, std::vector<uint8_t>>> uploads_;
+    std::map<std::string, std::vector<uint8_t>> objects_;
+
+    void accept_() {
+        while (true) {
+            const int fd = accept(listen_fd_, nullptr, nullptr);
+            if (fd < 0) {
+                return; // shut down
+            }
+            std::scoped_lock lock(mutex_);
+            connections_.push_back(fd);
+            threads_.emplace_back([this, fd] { serve_(fd); });
+        }
+    }
+
+    // one thread per keep-alive connection
+    void serve_(int fd) {
+        std::string received;
+        char buffer[64 * 1024];
+        while (true) {
+            size_t header_end;
+            while ((header_end = received.find("\r\n\r\n")) ==
+                   std::string::npos) {
+                const auto n = recv(fd, buffer, sizeof(buffer), 0);
+                if (n <= 0) {
+                    close(fd);
+                    return;
+                }
+                received.append(buffer, static_cast<size_t>(n));
+            }
+
+            std::stringstream header(received.substr(0, header_end));
+            received.erase(0, header_end + 4);
+
+            std::string method, target, line;
+            header >> method >> target;
+            size_t content_length = 0;
+            while (std::getline(header, line)) {
+                for (auto& c : line) {
+                    c = static_cast<char>(tolower(c));
+                }
+                if (line.rfind("content-length:", 0) == 0) {
+                    content_length = std::stoull(line.substr(15));
+                }
+            }
+
+            while (received.size() < content_length) {
+                const auto n = recv(fd, buffer, sizeof(buffer), 0);
+                if (n <= 0) {
+                    close(fd);
+                    return;
+                }
+                received.append(buffer, static_cast<size_t>(n));
+            }
+            std::vector<uint8_t> body(received.begin(),
+                                      received.begin() + content_length);
+            received.erase(0, content_length);
+
+            std::this_thread::sleep_for(request_latency);
+            const auto response = handle_(method, target, std::move(body));
+            for (size_t sent = 0; sent < response.size();) {
+                const auto n = send(fd,
+                                    response.data() + sent,
+                                    response.size() - sent,
+                                    MSG_NOSIGNAL);
+                if (n <= 0) {
+                    close(fd);
+                    return;
+                }
+                sent += static_cast<size_t>(n);
+            }
+        }
+    }
+
+    std::string handle_(const std::string& method,
+                        const std::string& target,
+                        std::vector<uint8_t>&& body) {
+        const auto question = target.find('?');
+        const auto path = target.substr(0, question);
+        std::map<std::string, std::string> query;
+        if (question != std::string::npos) {
+            std::stringstream ss(target.substr(question + 1));
+            std::string pair;
+            while (std::getline(ss, pair, '&')) {
+                const auto equals = pair.find('=');
+                query[pair.substr(0, equals)] =
+                  equals == std::string::npos ? "" : pair.substr(equals + 1);
+            }
+        }
+
+        std::scoped_lock lock(mutex_);
+        if (method == "POST" && query.contains("uploads")) {
+            const auto id = "upload" + std::to_string(next_upload_++);
+            uploads_[id];
+            return respond_(200,
+                            "",
+                            "<InitiateMultipartUploadResult><UploadId>" + id +
+                              "</UploadId></InitiateMultipartUploadResult>");
+        }
+
+        auto upload = uploads_.find(query["uploadId"]);
+        if (upload == uploads_.end()) {
+            return respond_(404, "", "<Error>NoSuchUpload</Error>");
+        }
+
+        if (method == "PUT") {
+            const auto etag = fnv1a(body);
+            upload->second[std::stoi(query["partNumber"])] = std::move(body);
+            return respond_(200, etag, "");
+        }
+        if (method == "POST") {
+            // parts are listed in order; assemble them
+            const std::string xml(body.begin(), body.end());
+            std::vector<uint8_t> object;
+            for (size_t pos = 0;
+                 (pos = xml.find("<PartNumber>", pos)) != std::string::npos;
+                 ++pos) {
+                const auto number = std::stoi(xml.substr(pos + 12));
+                const auto& part = upload->second[number];
+                object.insert(object.end(), part.begin(), part.end());
+            }
+            objects_[path] = std::move(object);
+            uploads_.erase(upload);
+            return respond_(200, "", "<CompleteMultipartUploadResult/>");
+        }
+        if (method == "DELETE") {
+            uploads_.erase(upload);
+            return respond_(204, "", "");
+        }
+        return respond_(400, "", "<Error>BadRequest</Error>");
+    }
+
+    static std::string respond_(int status,
+                                const std::string& etag,
+                                const std::string& body) {
+        std::stringstream ss;
+        ss << "HTTP/1.1 " << status << " Stand-in\r\n";
+        if (!etag.empty()) {
+            ss << "ETag: " << etag << "\r\n";
+        }
+        ss << "Content-Length: " << body.size() << "\r\n\r\n" << body;
+        return ss.str();
+    }
+};
+
+// Returns whether the uploaded object came back intact.
+bool
+run(StandInStore& store,
+    size_t part_size,
+    size_t concurrency,
+    std::ostream* results_csv) {
+    zarr::ObjectStoreSink::Config config;
+    config.port = store.port();
+    config.bucket = "bench";
+    config.key = "object_store/shard.bin";
+    config.part_size = part_size;
+    config.max_concurrent_parts = concurrency;
+
+    std::vector<std::vector<uint8_t>> chunks(chunks_per_write);
+
+    auto start = std::chrono::high_resolution_clock::now();
+    zarr::ObjectStoreSink sink(config);
+    bool ok = true;
+    for (size_t i = 0; i < nchunks; i += chunks_per_write) {
+        for (size_t j = 0; j < chunks_per_write; ++j) {
+            chunks[j].assign(bytes_per_chunk, chunk_byte(i + j));
+        }
+        ok = sink.write_vectors(chunks, i * bytes_per_chunk) && ok;
+    }
+    ok = sink.finalize() && ok;
+    auto end = std::chrono::high_resolution_clock::now();
+
+    // the stand-in assembled the object from the parts; check it
+    const auto object = store.take("/bench/object_store/shard.bin");
+    bool verified = ok && object.size() == nchunks * bytes_per_chunk;
+    for (size_t i = 0; verified && i < nchunks; ++i) {
+        for (size_t j = 0; j < bytes_per_chunk; j += 4096) {
+            if (object[i * bytes_per_chunk + j] != chunk_byte(i)) {
+                verified = false;
+                break;
+            }
+        }
+    }
+
+    if (results_csv == nullptr) {
+        return verified;
+    }
+
+    const double mib =
+      static_cast<double>(nchunks * bytes_per_chunk) / (1024.0 * 1024.0);
+    const double s = std::chrono::duration<double>(end - start).count();
+    const auto stats = sink.stats();
+
+    std::stringstream ss;
+    ss << part_size / (1024 * 1024) << "," << concurrency << "," << mib / s
+       << "," << stats.parts_uploaded << "," << stats.requests << ","
+       << stats.failed_requests << "," << (verified ? "yes" : "no");
+
+    std::cout << ss.str() << std::endl;
+    *results_csv << ss.str() << std::endl;
+    return verified;
+}
+} // namespace
+
+int
+bench::object_store() {
+    std::ofstream results_csv("object_store.csv");
+    const std::string header = "part_mib,concurrency,mib_per_s,parts,"
+                               "requests,failed_requests,verified";
+    std::cout << header << std::endl;
+    results_csv << header << std::endl;
+
+    StandInStore store;
+
+    bool verified = true;
+    bench::warm_up(
+      [&] { verified = run(store, 8 * bytes_per_chunk, 4, nullptr); });
+
+    // one chunk per part, as a naive per-chunk PUT would, then larger parts
+    for (const size_t part_chunks : { 1, 8, 32 }) {
+        for (const size_t concurrency : { 1, 4 }) {
+            verified = run(store,
+                           part_chunks * bytes_per_chunk,
+                           concurrency,
+                           &results_csv) &&
+                       verified;
+        }
+    }
+    return verified ? 0 : 1;
+}
@@ -0,0 +1,170 @@
+#include "benchmarks.hh"
+#include "vectorized.file.writer.hh"
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <sstream>
+
+namespace fs = std::filesystem;
+
+namespace {
+const size_t bytes_per_chunk = 256 * 1024;
+const size_t chunks_per_shard = 4;
+const size_t shard_bytes = bytes_per_chunk * chunks_per_shard;
+const size_t nshards = 512;
+const std::string path = "open_close.bin";
+
+using Clock = std::chrono::high_resolution_clock;
+
+struct Timings
+{
+    Clock::duration total{ 0 };
+    Clock::duration metadata{ 0 }; // opening, closing, truncating
+};
+
+// Write nshards shards to the same file, as a steady-state writer would
+// write shard after shard.
+Timings
+write_shards(const std::string& strategy,
+             const std::vector<std::span<const uint8_t>>& chunks) {
+    Timings timings;
+    const auto start = Clock::now();
+
+    if (strategy == "create-per-shard") {
+        // what the single-shard benchmark does: unlink, create, close
+        for (size_t i = 0; i < nshards; ++i) {
+            auto t = Clock::now();
+            if (fs::exists(path)) {
+                fs::remove(path);
+            }
+            auto writer = std::make_unique<zarr::VectorizedFileWriter>(path);
+            timings.metadata += Clock::now() - t;
+
+            writer->write_vectors(chunks, 0);
+
+            t = Clock::now();
+            writer.reset();
+            timings.metadata += Clock::now() - t;
+        }
+    } else if (strategy == "reopen-truncate") {
+        zarr::FileOpenOptions options;
+        options.truncate = true;
+        options.no_atime = true;
+        zarr::VectorizedFileWriter writer(path, options);
+        for (size_t i = 0; i < nshards; ++i) {
+            const auto t = Clock::now();
+            writer.reopen(path, options);
+            timings.metadata += Clock::now() - t;
+
+            writer.write_vectors(chunks, 0);
+        }
+    } else if (strategy == "truncate-reuse") {
+        zarr::VectorizedFileWriter writer(path);
+        for (size_t i = 0; i < nshards; ++i) {
+            const auto t = Clock::now();
+            writer.truncate(0);
+            timings.metadata += Clock::now() - t;
+
+            writer.write_vectors(chunks, 0);
+        }
+    } else {
+        // overwrite a preallocated file in place: no metadata operations
+        // per shard at all
+        zarr::FileOpenOptions options;
+        options.direct = strategy == "preallocated-direct";
+        zarr::VectorizedFileWriter writer(path, options);
+
+        const auto t = Clock::now();
+        writer.preallocate(shard_bytes);
+        timings.metadata += Clock::now() - t;
+
+        for (size_t i = 0; i < nshards; ++i) {
+            writer.write_vectors(chunks, 0);
+        }
+    }
+
+    timings.total = Clock::now() - start;
+    return timings;
+}
+
+void
+run(const std::string& strategy,
+    const std::vector<std::span<const uint8_t>>& chunks,
+    std::ostream* results_csv) {
+    if (fs::exists(path)) {
+        fs::remove(path);
+    }
+
+    Timings timings;
+    try {
+        timings = write_shards(strategy, chunks);
+    } catch (const std::exception& exc) {
+        // e.g. O_DIRECT on a file system without it
+        std::cerr << strategy << " failed: " << exc.what() << std::endl;
+        return;
+    }
+
+    if (fs::exists(path)) {
+        fs::remove(path);
+    }
+
+    if (results_csv == nullptr) {
+        return;
+    }
+
+    const auto us = [](Clock::duration d) {
+        return std::chrono::duration<double, std::micro>(d).count() /
+               static_cast<double>(nshards);
+    };
+    const double mib =
+      static_cast<double>(nshards * shard_bytes) / (1024.0 * 1024.0);
+    const double s = std::chrono::duration<double>(timings.total).count();
+
+    std::stringstream ss;
+    ss << strategy << "," << us(timings.total) << ","
+       << us(timings.metadata) << "," << mib / s;
+
+    std::cout << ss.str() << std::endl;
+    *results_csv << ss.str() << std::endl;
+}
+} // namespace
+
+int
+bench::open_close() {
+    std::ofstream results_csv("open_close.csv");
+    const std::string header =
+      "strategy,us_per_shard,metadata_us_per_shard,mib_per_s";
+    std::cout << header << std::endl;
+    results_csv << header << std::endl;
+
+    // one aligned buffer, so that every strategy can use it with O_DIRECT
+    const auto alignment = zarr::probe_device(path).direct_io_alignment();
+    std::vector<uint8_t> buffer(shard_bytes + alignment);
+    void* aligned = buffer.data();
+    size_t space = buffer.size();
+    auto* data =
+      static_cast<uint8_t*>(std::align(alignment, shard_bytes, aligned, space));
+
+    std::vector<std::span<const uint8_t>> chunks;
+    for (size_t i = 0; i < chunks_per_shard; ++i) {
+        std::fill_n(data + i * bytes_per_chunk,
+                    bytes_per_chunk,
+                    static_cast<uint8_t>(i));
+        chunks.emplace_back(data + i * bytes_per_chunk, bytes_per_chunk);
+    }
+
+    bench::warm_up([&] { run("create-per-shard", chunks, nullptr); });
+
+    for (const auto* strategy : { "create-per-shard",
+                                  "reopen-truncate",
+                                  "truncate-reuse",
+                                  "preallocated",
+                                  "preallocated-direct" }) {
+        run(strategy, chunks, &results_csv);
+    }
+    return 0;
+}
@@ -0,0 +1,103 @@
+#include "benchmarks.hh"
+#include "async.chunk.writer.hh"
+
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <thread>
+
+namespace fs = std::filesystem;
+
+namespace {
+const size_t bytes_per_chunk = 8 * 1024 * 1024;
+const size_t nchunks = 64;
+const size_t bytes_per_metadata = 4096;
+const auto metadata_interval = std::chrono::milliseconds(2);
+
+// A bulk producer queues every chunk at once while another thread writes a
+// small metadata document every few milliseconds, in @p metadata_priority.
+void
+run(zarr::WritePriority metadata_priority,
+    const std::string& path,
+    std::ostream* results_csv) {
+    zarr::VectorizedFileWriter writer(path);
+    zarr::AsyncChunkWriter async_writer(writer);
+
+    std::atomic<bool> bulk_done = false;
+    auto start = std::chrono::high_resolution_clock::now();
+    std::thread metadata([&] {
+        const size_t metadata_offset = nchunks * bytes_per_chunk;
+        for (size_t i = 0; !bulk_done.load(); ++i) {
+            async_writer.submit(std::vector<uint8_t>(bytes_per_metadata, 2),
+                                metadata_offset + (i % 16) * bytes_per_metadata,
+                                metadata_priority);
+            std::this_thread::sleep_for(metadata_interval);
+        }
+    });
+
+    for (size_t i = 0; i < nchunks; ++i) {
+        async_writer.submit(std::vector<uint8_t>(bytes_per_chunk, 1),
+                            i * bytes_per_chunk);
+    }
+    async_writer.flush();
+    bulk_done = true;
+    metadata.join();
+    async_writer.flush();
+    auto end = std::chrono::high_resolution_clock::now();
+
+    if (results_csv == nullptr) {
+        return;
+    }
+
+    const double mib = static_cast<double>(nchunks * bytes_per_chunk) /
+                       (1024.0 * 1024.0);
+    const double mib_per_s =
+      mib / std::chrono::duration<double>(end - start).count();
+
+    for (const auto priority :
+         { zarr::WritePriority::High, zarr::WritePriority::Bulk }) {
+        const auto& latency = async_writer.completion_latency_us(priority);
+        if (latency.count() == 0) {
+            continue;
+        }
+
+        std::stringstream ss;
+        ss << (metadata_priority == zarr::WritePriority::High ? "high"
+                                                              : "bulk")
+           << "," << (priority == zarr::WritePriority::High ? "high" : "bulk")
+           << "," << latency.count() << "," << latency.percentile(0.5) << ","
+           << latency.percentile(0.99) << "," << latency.max() << ","
+           << mib_per_s;
+
+        std::cout << ss.str() << std::endl;
+        *results_csv << ss.str() << std::endl;
+    }
+}
+} // namespace
+
+int
+bench::priority_classes() {
+    std::ofstream results_csv("priority_classes.csv");
+    const std::string header = "metadata_class,class,writes,latency_p50_us,"
+                               "latency_p99_us,latency_max_us,bulk_mib_per_s";
+    std::cout << header << std::endl;
+    results_csv << header << std::endl;
+
+    const std::string path = "priority_classes.bin";
+
+    bench::warm_up(
+      [&] { run(zarr::WritePriority::High, path, nullptr); }, path);
+
+    for (const auto metadata_priority :
+         { zarr::WritePriority::Bulk, zarr::WritePriority::High }) {
+        run(metadata_priority, path, &results_csv);
+        if (fs::exists(path)) {
+            fs::remove(path);
+        }
+    }
+
+    return 0;
+}
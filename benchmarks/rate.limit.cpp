@@ -0,0 +1,124 @@
+#include "benchmarks.hh"
+#include "vectorized.file.writer.hh"
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <thread>
+
+namespace fs = std::filesystem;
+
+namespace {
+const size_t bytes_per_chunk = 1024 * 1024;
+const size_t chunks_per_write = 8;
+const size_t nwrites = 16; // 128 MiB per writer
+const double mib = 1024.0 * 1024.0;
+
+struct Scenario
+{
+    std::string name;
+    size_t nwriters;
+    zarr::RateLimiter::Limits per_writer;
+    zarr::RateLimiter::Limits global;
+};
+
+zarr::RateLimiter::Limits
+bandwidth(double mib_per_s) {
+    zarr::RateLimiter::Limits limits;
+    limits.bytes_per_second = mib_per_s * mib;
+    return limits;
+}
+
+// Each writer issues bursts of chunks_per_write chunks with a single
+// write_vectors call, as fast as it can.
+void
+run(const Scenario& scenario, std::ostream& results_csv) {
+    zarr::RateLimiter::global().set_limits(scenario.global);
+    zarr::RateLimiter::global().reset_metrics();
+
+    std::vector<std::unique_ptr<zarr::RateLimiter>> limiters;
+    std::vector<std::thread> writers;
+    const std::vector<std::vector<uint8_t>> chunks(
+      chunks_per_write, std::vector<uint8_t>(bytes_per_chunk, 1));
+
+    auto start = std::chrono::high_resolution_clock::now();
+    for (size_t w = 0; w < scenario.nwriters; ++w) {
+        limiters.push_back(
+          std::make_unique<zarr::RateLimiter>(scenario.per_writer));
+        writers.emplace_back([&, w, limiter = limiters.back().get()] {
+            const auto path = "rate_limit." + std::to_string(w) + ".bin";
+            {
+                zarr::VectorizedFileWriter writer(path);
+                writer.set_rate_limiter(limiter);
+                for (size_t i = 0; i < nwrites; ++i) {
+                    writer.write_vectors(
+                      chunks, i * chunks_per_write * bytes_per_chunk);
+                }
+            }
+            if (fs::exists(path)) {
+                fs::remove(path);
+            }
+        });
+    }
+    for (auto& writer : writers) {
+        writer.join();
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+
+    const double total_mib = static_cast<double>(
+      scenario.nwriters * nwrites * chunks_per_write * bytes_per_chunk) / mib;
+    const double s = std::chrono::duration<double>(end - start).count();
+
+    // delays imposed by the tighter of the two limits
+    const auto& global = zarr::RateLimiter::global();
+    const auto* delays = &limiters.front()->throttle_delay_us();
+    uint64_t total_delay_us = 0;
+    for (const auto& limiter : limiters) {
+        total_delay_us += limiter->total_delay_us();
+    }
+    if (global.total_delay_us() > total_delay_us) {
+        delays = &global.throttle_delay_us();
+        total_delay_us = global.total_delay_us();
+    }
+
+    std::stringstream ss;
+    ss << scenario.name << "," << scenario.nwriters << ","
+       << total_mib / s << "," << delays->count() << ","
+       << delays->percentile(0.5) << "," << delays->percentile(0.99) << ","
+       << delays->max() << "," << total_delay_us / 1000;
+
+    std::cout << ss.str() << std::endl;
+    results_csv << ss.str() << std::endl;
+}
+} // namespace
+
+int
+bench::rate_limit() {
+    std::ofstream results_csv("rate_limit.csv");
+    const std::string header = "scenario,writers,mib_per_s,slices,"
+                               "delay_p50_us,delay_p99_us,delay_max_us,"
+                               "total_delay_ms";
+    std::cout << header << std::endl;
+    results_csv << header << std::endl;
+
+    auto iops_limited = bandwidth(512);
+    iops_limited.ops_per_second = 25;
+
+    const std::vector<Scenario> scenarios = {
+        { "unlimited", 1, {}, {} },
+        { "writer-128mib", 1, bandwidth(128), {} },
+        { "writer-512mib-25iops", 1, iops_limited, {} },
+        { "2x-writer-64mib", 2, bandwidth(64), {} },
+        { "2x-writer-128mib-global-128mib", 2, bandwidth(128), bandwidth(128) },
+    };
+    for (const auto& scenario : scenarios) {
+        run(scenario, results_csv);
+    }
+
+    // leave the process-wide limiter as we found it
+    zarr::RateLimiter::global().set_limits({});
+    return 0;
+}
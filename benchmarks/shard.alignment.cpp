@@ -0,0 +1,136 @@
+#include "benchmarks.hh"
+#include "shard.builder.hh"
+#include "shard.reader.hh"
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <sstream>
+
+namespace fs = std::filesystem;
+
+namespace {
+const std::vector<uint32_t> chunks_per_shard{ 8, 8, 8 };
+const size_t min_bytes_per_chunk = 4 * 1024;
+const size_t max_bytes_per_chunk = 64 * 1024;
+const size_t dio_alignment = 4096;
+
+// Compressed chunks vary in size, so offsets are generally unaligned.
+std::vector<std::vector<uint8_t>>
+make_chunks(size_t nchunks) {
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<size_t> size(min_bytes_per_chunk,
+                                               max_bytes_per_chunk);
+
+    std::vector<std::vector<uint8_t>> chunks(nchunks);
+    for (size_t i = 0; i < nchunks; ++i) {
+        chunks[i].assign(size(rng), static_cast<uint8_t>(i));
+    }
+    return chunks;
+}
+
+// Read every chunk individually, in random order, and time it.
+bool
+read_each_chunk(zarr::ShardReader& reader,
+                size_t nchunks,
+                double& us_per_chunk) {
+    std::vector<size_t> order(nchunks);
+    for (size_t i = 0; i < nchunks; ++i) {
+        order[i] = i;
+    }
+    std::shuffle(order.begin(), order.end(), std::mt19937(7));
+
+    auto start = std::chrono::high_resolution_clock::now();
+    for (const auto i : order) {
+        const auto chunk = reader.read_chunk(i);
+        if (chunk.empty() || chunk.front() != static_cast<uint8_t>(i) ||
+            chunk.back() != static_cast<uint8_t>(i)) {
+            std::cerr << "Chunk " << i << " read back incorrectly"
+                      << std::endl;
+            return false;
+        }
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+
+    us_per_chunk =
+      static_cast<double>(
+        std::chrono::duration_cast<std::chrono::microseconds>(end - start)
+          .count()) /
+      nchunks;
+    return true;
+}
+} // namespace
+
+int
+bench::shard_alignment() {
+    std::ofstream results_csv("shard_alignment.csv");
+    const std::string header = "alignment,shard_bytes,padding_bytes,write_ms,"
+                               "read_mode,us_per_chunk,read_amplification";
+    std::cout << header << std::endl;
+    results_csv << header << std::endl;
+
+    zarr::ShardLayout layout(chunks_per_shard, zarr::ChunkOrder::C);
+    const auto chunks = make_chunks(layout.size());
+
+    size_t payload = 0;
+    for (const auto& chunk : chunks) {
+        payload += chunk.size();
+    }
+
+    const std::string path = "shard_alignment.bin";
+    for (const size_t alignment : { size_t(1), size_t(512), dio_alignment }) {
+        zarr::ShardBuilder builder(layout, alignment);
+
+        auto start = std::chrono::high_resolution_clock::now();
+        {
+            zarr::VectorizedFileWriter writer(path);
+            if (!builder.write(writer, chunks)) {
+                std::cerr << "Failed to write shard" << std::endl;
+                return 1;
+            }
+        }
+        auto end = std::chrono::high_resolution_clock::now();
+        const auto write_ms =
+          std::chrono::duration_cast<std::chrono::milliseconds>(end - start)
+            .count();
+
+        for (const bool direct_io : { false, true }) {
+            double us_per_chunk = 0;
+            double amplification = 0;
+            try {
+                zarr::ShardReader reader(
+                  path, layout, direct_io, dio_alignment, alignment);
+                const auto bytes_before = reader.bytes_read();
+                if (!read_each_chunk(reader, layout.size(), us_per_chunk)) {
+                    return 1;
+                }
+                amplification =
+                  static_cast<double>(reader.bytes_read() - bytes_before) /
+                  payload;
+            } catch (const std::exception& exc) {
+                // e.g. the file system does not support O_DIRECT
+                std::cerr << "Skipping " << (direct_io ? "direct" : "buffered")
+                          << " reads: " << exc.what() << std::endl;
+                continue;
+            }
+
+            std::stringstream ss;
+            ss << alignment << "," << builder.shard_size() << ","
+               << builder.padding_size() << "," << write_ms << ","
+               << (direct_io ? "direct" : "buffered") << "," << us_per_chunk
+               << "," << amplification;
+
+            std::cout << ss.str() << std::endl;
+            results_csv << ss.str() << std::endl;
+        }
+
+        if (fs::exists(path)) {
+            fs::remove(path);
+        }
+    }
+
+    return 0;
+}
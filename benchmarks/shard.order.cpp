@@ -0,0 +1,128 @@
+#include "benchmarks.hh"
+#include "shard.builder.hh"
+#include "shard.reader.hh"
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <sstream>
+
+namespace fs = std::filesystem;
+
+namespace {
+const std::vector<uint32_t> chunks_per_shard{ 16, 16, 16 };
+const size_t bytes_per_chunk = 8 * 1024;
+const size_t rois_per_size = 256;
+
+std::vector<std::vector<uint8_t>>
+make_chunks(size_t nchunks) {
+    std::vector<std::vector<uint8_t>> chunks(nchunks);
+    for (size_t i = 0; i < nchunks; ++i) {
+        chunks[i].assign(bytes_per_chunk, static_cast<uint8_t>(i));
+    }
+    return chunks;
+}
+
+bool
+read_rois(zarr::ShardReader& reader,
+          const zarr::ShardLayout& layout,
+          std::ostream& results_csv) {
+    for (const uint32_t edge : { 2U, 4U, 8U }) {
+        for (const bool aligned : { false, true }) {
+            std::mt19937 rng(1234); // same ROIs for every order
+            std::uniform_int_distribution<uint32_t> origin(
+              0, chunks_per_shard[0] - edge);
+
+            const auto reads_before = reader.reads_issued();
+            size_t nread = 0;
+            auto start = std::chrono::high_resolution_clock::now();
+            for (size_t roi = 0; roi < rois_per_size; ++roi) {
+                std::vector<uint32_t> begin(3), end(3);
+                for (auto d = 0; d < 3; ++d) {
+                    begin[d] = origin(rng);
+                    if (aligned) { // snap the ROI to a multiple of its edge
+                        begin[d] -= begin[d] % edge;
+                    }
+                    end[d] = begin[d] + edge;
+                }
+
+                const auto indices = layout.chunks_in_region(begin, end);
+                const auto data = reader.read_chunks(indices);
+                for (size_t i = 0; i < indices.size(); ++i) {
+                    if (data[i].size() != bytes_per_chunk ||
+                        data[i][0] != static_cast<uint8_t>(indices[i])) {
+                        std::cerr << "Chunk " << indices[i]
+                                  << " read back incorrectly" << std::endl;
+                        return false;
+                    }
+                }
+                nread += indices.size();
+            }
+            auto end = std::chrono::high_resolution_clock::now();
+            const auto elapsed =
+              std::chrono::duration_cast<std::chrono::microseconds>(end - start)
+                .count();
+
+            std::stringstream ss;
+            ss << zarr::to_string(layout.order()) << "," << edge << ","
+               << aligned << "," << nread / rois_per_size << ","
+               << static_cast<double>(reader.reads_issued() - reads_before) /
+                    rois_per_size
+               << "," << static_cast<double>(elapsed) / rois_per_size;
+
+            std::cout << ss.str() << std::endl;
+            results_csv << ss.str() << std::endl;
+        }
+    }
+
+    return true;
+}
+} // namespace
+
+int
+bench::shard_order() {
+    std::ofstream results_csv("shard_order.csv");
+    const std::string header = "order,roi_edge,roi_aligned,chunks_per_roi,"
+                               "reads_per_roi,time_us_per_roi";
+    std::cout << header << std::endl;
+    results_csv << header << std::endl;
+
+    size_t nchunks = 1;
+    for (const auto& n : chunks_per_shard) {
+        nchunks *= n;
+    }
+    const auto chunks = make_chunks(nchunks);
+
+    for (const auto order : { zarr::ChunkOrder::C,
+                              zarr::ChunkOrder::Morton,
+                              zarr::ChunkOrder::Hilbert }) {
+        const auto path = "shard_" + zarr::to_string(order) + ".bin";
+        zarr::ShardLayout layout(chunks_per_shard, order);
+
+        {
+            zarr::VectorizedFileWriter writer(path);
+            zarr::ShardBuilder builder(layout);
+            if (!builder.write(writer, chunks)) {
+                std::cerr << "Failed to write shard " << path << std::endl;
+                return 1;
+            }
+        }
+
+        bool ok;
+        {
+            zarr::ShardReader reader(path, layout);
+            ok = read_rois(reader, layout, results_csv);
+        }
+
+        if (fs::exists(path)) {
+            fs::remove(path);
+        }
+        if (!ok) {
+            return 1;
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,193 @@
+#include "benchmarks.hh"
+#include "shm.ring.hh"
+
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace fs = std::filesystem;
+
+namespace {
+const size_t bytes_per_frame = 2048 * 2048 * 2; // 8 MiB uint16 frame
+const size_t nframes = 256;
+const auto timeout = std::chrono::seconds(5);
+
+// Stand-in for the camera driver filling a frame buffer.
+void
+fill_frame(uint8_t* data, size_t i) {
+    memset(data, static_cast<int>(i & 0xff), bytes_per_frame);
+}
+
+void
+wait_for_child(pid_t pid) {
+    int status = 0;
+    waitpid(pid, &status, 0);
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        throw std::runtime_error("Producer process failed");
+    }
+}
+
+// Baseline: the producer process sends every frame through a socket and the
+// writer copies it into its own buffer before writing.
+double
+run_socket(const std::string& path) {
+    int fds[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) < 0) {
+        throw std::runtime_error("Failed to create socket pair");
+    }
+
+    const pid_t pid = fork();
+    if (pid == 0) {
+        close(fds[0]);
+        std::vector<uint8_t> frame(bytes_per_frame);
+        for (size_t i = 0; i < nframes; ++i) {
+            fill_frame(frame.data(), i);
+            for (size_t sent = 0; sent < frame.size();) {
+                const auto n =
+                  write(fds[1], frame.data() + sent, frame.size() - sent);
+                if (n <= 0) {
+                    _exit(1);
+                }
+                sent += static_cast<size_t>(n);
+            }
+        }
+        close(fds[1]);
+        _exit(0);
+    }
+    close(fds[1]);
+
+    zarr::VectorizedFileWriter writer(path);
+    std::vector<uint8_t> frame(bytes_per_frame);
+    const std::vector<std::span<const uint8_t>> buffers{ frame };
+
+    auto start = std::chrono::high_resolution_clock::now();
+    for (size_t i = 0; i < nframes; ++i) {
+        for (size_t received = 0; received < frame.size();) {
+            const auto n = read(
+              fds[0], frame.data() + received, frame.size() - received);
+            if (n <= 0) {
+                close(fds[0]);
+                throw std::runtime_error("Producer closed the socket early");
+            }
+            received += static_cast<size_t>(n);
+        }
+        writer.write_vectors(buffers, i * bytes_per_frame);
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+
+    close(fds[0]);
+    wait_for_child(pid);
+    return std::chrono::duration<double>(end - start).count();
+}
+
+zarr::ShmRing
+make_ring(size_t nslots) {
+#ifdef __linux__
+    return zarr::ShmRing::create_memfd(nslots, bytes_per_frame);
+#else
+    const std::string name = "/zarr-shm-ring-" + std::to_string(getpid());
+    auto ring = zarr::ShmRing::create(name, nslots, bytes_per_frame);
+    zarr::ShmRing::unlink(name); // the mapping and the fd keep it alive
+    return ring;
+#endif
+}
+
+void
+run_ring(size_t nslots,
+         const std::string& path,
+         std::ostream& results_csv,
+         double socket_s) {
+    auto ring = make_ring(nslots);
+
+    const pid_t pid = fork();
+    if (pid == 0) {
+        // attach through the inherited descriptor, as a driver process would
+        auto producer = zarr::ShmRing::from_fd(ring.fd());
+        for (size_t i = 0; i < nframes; ++i) {
+            const auto lease = producer.acquire(timeout);
+            if (!lease) {
+                _exit(1);
+            }
+            fill_frame(lease->data, i);
+            producer.commit(*lease, bytes_per_frame, i * bytes_per_frame);
+        }
+        producer.close_producer();
+        _exit(0);
+    }
+
+    zarr::VectorizedFileWriter writer(path);
+    size_t frames_written = 0;
+    size_t drains = 0;
+    size_t sequence_gaps = 0;
+    uint64_t expected_sequence = 0;
+
+    auto start = std::chrono::high_resolution_clock::now();
+    while (!ring.drained()) {
+        const auto ready = ring.peek(nslots, std::chrono::milliseconds(10));
+        if (ready.empty()) {
+            continue;
+        }
+        for (const auto& frame : ready) {
+            sequence_gaps += frame.sequence != expected_sequence;
+            expected_sequence = frame.sequence + 1;
+        }
+        frames_written += ring.write_ready(
+          writer, ready.size(), std::chrono::microseconds(0));
+        ++drains;
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    const double ring_s = std::chrono::duration<double>(end - start).count();
+
+    wait_for_child(pid);
+
+    const double mib = static_cast<double>(nframes * bytes_per_frame) /
+                       (1024.0 * 1024.0);
+    std::stringstream ss;
+    ss << nslots << "," << mib / socket_s << "," << mib / ring_s << ","
+       << frames_written << "," << drains << ","
+       << ring.producer_waits() << "," << sequence_gaps;
+
+    std::cout << ss.str() << std::endl;
+    results_csv << ss.str() << std::endl;
+}
+} // namespace
+
+int
+bench::shm_ring() {
+    std::ofstream results_csv("shm_ring.csv");
+    const std::string header = "slots,socket_mib_per_s,ring_mib_per_s,"
+                               "frames_written,drains,producer_waits,"
+                               "sequence_gaps";
+    std::cout << header << std::endl;
+    results_csv << header << std::endl;
+
+    const std::string path = "shm_ring.bin";
+
+    try {
+        for (const size_t nslots : { 2, 4, 8, 16 }) {
+            const double socket_s = run_socket(path);
+            if (fs::exists(path)) {
+                fs::remove(path);
+            }
+
+            run_ring(nslots, path, results_csv, socket_s);
+            if (fs::exists(path)) {
+                fs::remove(path);
+            }
+        }
+    } catch (const std::exception& exc) {
+        std::cerr << "Error: " << exc.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,122 @@
+#include "benchmarks.hh"
+#include "striped.shard.writer.hh"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+namespace fs = std::filesystem;
+
+namespace {
+const size_t bytes_per_chunk = 1024 * 1024;
+const size_t chunks_per_shard = 16;
+const size_t nshards = 64;
+const std::string default_root = "stripe_scaling";
+
+// One directory per device, comma-separated, from
+// VECTORIZED_TEST_STRIPE_DIRS; otherwise 4 directories in the working
+// directory, which exercise the queues but share one device.
+std::vector<std::string>
+target_directories() {
+    std::vector<std::string> directories;
+    if (const char* env = std::getenv("VECTORIZED_TEST_STRIPE_DIRS")) {
+        std::stringstream ss(env);
+        std::string directory;
+        while (std::getline(ss, directory, ',')) {
+            if (!directory.empty()) {
+                directories.push_back(directory);
+            }
+        }
+    }
+
+    if (directories.empty()) {
+        for (auto i = 0; i < 4; ++i) {
+            directories.push_back(
+              (fs::path(default_root) / ("target" + std::to_string(i)))
+                .string());
+        }
+    }
+    return directories;
+}
+
+void
+run(const std::vector<std::string>& directories,
+    std::ostream* results_csv) {
+    std::vector<std::string> paths;
+
+    zarr::StripedShardWriter writer(directories);
+    auto start = std::chrono::high_resolution_clock::now();
+    for (size_t i = 0; i < nshards; ++i) {
+        std::vector<std::vector<uint8_t>> chunks(
+          chunks_per_shard, std::vector<uint8_t>(bytes_per_chunk, 1));
+        paths.push_back(writer.write_shard(
+          "stripe_scaling." + std::to_string(i) + ".bin", std::move(chunks)));
+    }
+    writer.flush();
+    auto end = std::chrono::high_resolution_clock::now();
+
+    for (const auto& path : paths) {
+        if (fs::exists(path)) {
+            fs::remove(path);
+        }
+    }
+
+    if (results_csv == nullptr) {
+        return;
+    }
+
+    const double mib =
+      static_cast<double>(nshards * chunks_per_shard * bytes_per_chunk) /
+      (1024.0 * 1024.0);
+    const double s = std::chrono::duration<double>(end - start).count();
+
+    // shards and busy time per target, separated by '/'
+    std::stringstream shards;
+    std::stringstream busy;
+    uint64_t failed_writes = 0;
+    for (const auto& target : writer.stats()) {
+        shards << (shards.tellp() > 0 ? "/" : "") << target.shards_written;
+        busy << (busy.tellp() > 0 ? "/" : "") << target.busy_seconds;
+        failed_writes += target.failed_writes;
+    }
+
+    std::stringstream ss;
+    ss << directories.size() << "," << mib / s << "," << shards.str() << ","
+       << busy.str() << "," << failed_writes;
+
+    std::cout << ss.str() << std::endl;
+    *results_csv << ss.str() << std::endl;
+}
+} // namespace
+
+int
+bench::stripe_scaling() {
+    std::ofstream results_csv("stripe_scaling.csv");
+    const std::string header =
+      "targets,mib_per_s,shards_per_target,busy_s_per_target,failed_writes";
+    std::cout << header << std::endl;
+    results_csv << header << std::endl;
+
+    const auto directories = target_directories();
+
+    bench::warm_up([&] { run({ directories.front() }, nullptr); });
+
+    // 1, 2, 4, ... targets, ending with all of them
+    for (size_t ntargets = 1;;
+         ntargets = std::min(2 * ntargets, directories.size())) {
+        run({ directories.begin(), directories.begin() + ntargets },
+            &results_csv);
+        if (ntargets == directories.size()) {
+            break;
+        }
+    }
+
+    if (fs::exists(default_root)) {
+        fs::remove_all(default_root);
+    }
+    return 0;
+}
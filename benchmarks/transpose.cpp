@@ -0,0 +1,198 @@
+#include "benchmarks.hh"
+#include "transpose.hh"
+
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <numeric>
+#include <sstream>
+
+namespace fs = std::filesystem;
+
+namespace {
+const int nruns = 5;
+const size_t nchunks = 16;
+
+// Reference implementation: walk the input in order, scatter the output.
+void
+naive_c_to_f_order(const uint8_t* in,
+                   const std::vector<size_t>& shape,
+                   size_t bytes_per_element,
+                   uint8_t* out) {
+    const size_t n = std::accumulate(
+      shape.begin(), shape.end(), size_t(1), std::multiplies<>());
+
+    std::vector<size_t> coords(shape.size(), 0);
+    for (size_t i = 0; i < n; ++i) {
+        // F-order offset of the current C-order coordinate
+        size_t j = 0;
+        for (auto d = shape.size(); d-- > 0;) {
+            j = j * shape[d] + coords[d];
+        }
+        memcpy(out + j * bytes_per_element,
+               in + i * bytes_per_element,
+               bytes_per_element);
+
+        for (auto d = shape.size(); d-- > 0;) {
+            if (++coords[d] < shape[d]) {
+                break;
+            }
+            coords[d] = 0;
+        }
+    }
+}
+
+double
+gb_per_s(size_t nbytes, const std::function<void()>& kernel) {
+    double best_s = 1e30;
+    for (auto run = 0; run < nruns; ++run) {
+        auto start = std::chrono::high_resolution_clock::now();
+        kernel();
+        auto end = std::chrono::high_resolution_clock::now();
+        best_s =
+          std::min(best_s, std::chrono::duration<double>(end - start).count());
+    }
+    return static_cast<double>(nbytes) / best_s / 1e9;
+}
+
+std::string
+shape_string(const std::vector<size_t>& shape) {
+    std::stringstream ss;
+    for (size_t d = 0; d < shape.size(); ++d) {
+        ss << (d ? "x" : "") << shape[d];
+    }
+    return ss.str();
+}
+
+void
+report(std::ostream& results_csv,
+       const std::string& kernel,
+       const std::vector<size_t>& shape,
+       size_t bytes_per_element,
+       double gbps,
+       double write_ms) {
+    std::stringstream ss;
+    ss << kernel << "," << shape_string(shape) << "," << bytes_per_element
+       << "," << gbps << "," << write_ms;
+    std::cout << ss.str() << std::endl;
+    results_csv << ss.str() << std::endl;
+}
+
+bool
+run_kernels(std::ostream& results_csv,
+            const std::vector<size_t>& shape,
+            size_t bytes_per_element) {
+    const size_t nbytes =
+      std::accumulate(
+        shape.begin(), shape.end(), size_t(1), std::multiplies<>()) *
+      bytes_per_element;
+
+    std::vector<uint8_t> in(nbytes), expected(nbytes), out(nbytes);
+    for (size_t i = 0; i < nbytes; ++i) {
+        in[i] = static_cast<uint8_t>(i * 7 + i / 251);
+    }
+
+    report(results_csv,
+           "naive",
+           shape,
+           bytes_per_element,
+           gb_per_s(nbytes, [&] {
+               naive_c_to_f_order(
+                 in.data(), shape, bytes_per_element, expected.data());
+           }),
+           0);
+    report(results_csv,
+           "blocked",
+           shape,
+           bytes_per_element,
+           gb_per_s(nbytes, [&] {
+               zarr::c_to_f_order(
+                 in.data(), shape, bytes_per_element, out.data());
+           }),
+           0);
+    if (out != expected) {
+        std::cerr << "Blocked transpose of " << shape_string(shape)
+                  << " does not match the reference" << std::endl;
+        return false;
+    }
+
+    zarr::f_to_c_order(out.data(), shape, bytes_per_element, expected.data());
+    if (expected != in) {
+        std::cerr << "F to C order of " << shape_string(shape)
+                  << " did not round-trip" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// Time writing 128^3 uint16 chunks with and without an F-order stage.
+bool
+write_path(std::ostream& results_csv) {
+    const std::vector<size_t> shape{ 128, 128, 128 };
+    const size_t bytes_per_element = 2;
+    const std::vector<std::vector<uint8_t>> frames(
+      nchunks, std::vector<uint8_t>(128 * 128 * 128 * bytes_per_element, 1));
+
+    const std::string path = "transpose.bin";
+    for (const bool f_order : { false, true }) {
+        zarr::ChunkPipeline pipeline;
+        if (f_order) {
+            pipeline.add_stage(
+              "c_to_f_order",
+              zarr::c_to_f_order_stage(shape, bytes_per_element));
+        }
+
+        // best of n, since the first write also pays for page cache growth
+        double best_ms = 1e30;
+        for (auto run = 0; run < nruns; ++run) {
+            auto chunks = frames;
+            auto start = std::chrono::high_resolution_clock::now();
+            bool ok;
+            {
+                zarr::VectorizedFileWriter writer(path);
+                ok = pipeline.write(writer, chunks, 0);
+            }
+            auto end = std::chrono::high_resolution_clock::now();
+            if (fs::exists(path)) {
+                fs::remove(path);
+            }
+            if (!ok) {
+                std::cerr << "Failed to write " << path << std::endl;
+                return false;
+            }
+            best_ms = std::min(
+              best_ms,
+              std::chrono::duration<double, std::milli>(end - start).count());
+        }
+
+        report(results_csv,
+               f_order ? "write_f_order" : "write_c_order",
+               shape,
+               bytes_per_element,
+               0,
+               best_ms);
+    }
+    return true;
+}
+} // namespace
+
+int
+bench::transpose() {
+    std::ofstream results_csv("transpose.csv");
+    const std::string header = "kernel,shape,bytes_per_element,gb_per_s,write_ms";
+    std::cout << header << std::endl;
+    results_csv << header << std::endl;
+
+    for (const size_t bytes_per_element : { 1, 2, 4 }) {
+        if (!run_kernels(results_csv, { 4096, 4096 }, bytes_per_element) ||
+            !run_kernels(results_csv, { 128, 128, 128 }, bytes_per_element) ||
+            !run_kernels(results_csv, { 64, 256, 96 }, bytes_per_element)) {
+            return 1;
+        }
+    }
+
+    return write_path(results_csv) ? 0 : 1;
+}
@@ -0,0 +1,239 @@
+#include "benchmarks.hh"
+#include "vectorized.file.writer.hh"
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <sstream>
+
+namespace fs = std::filesystem;
+
+namespace {
+const size_t bytes_per_chunk = 1024 * 1024;
+const size_t chunks_per_shard = 64;
+const size_t nshards = 4; // shards being filled at once
+const size_t window = 16; // arrivals per batch in batched-scatter
+
+struct Arrival
+{
+    size_t shard;
+    size_t chunk;
+};
+
+std::string
+shard_path(size_t shard) {
+    return "write_order_" + std::to_string(shard) + ".bin";
+}
+
+uint8_t
+fill_value(size_t shard, size_t chunk) {
+    return static_cast<uint8_t>(shard * chunks_per_shard + chunk);
+}
+
+// The order in which finished chunks reach the writer. "sequential" is what
+// a single producer gives; "shuffled" is parallel producers finishing one
+// shard's chunks out of order; "interleaved" is producers working on
+// several shards at once.
+std::vector<Arrival>
+arrival_order(const std::string& order) {
+    std::vector<Arrival> arrivals;
+    for (size_t s = 0; s < nshards; ++s) {
+        std::vector<Arrival> shard;
+        for (size_t i = 0; i < chunks_per_shard; ++i) {
+            shard.push_back({ s, i });
+        }
+        if (order != "sequential") {
+            std::shuffle(shard.begin(), shard.end(), std::mt19937(s));
+        }
+        arrivals.insert(arrivals.end(), shard.begin(), shard.end());
+    }
+    if (order == "interleaved") {
+        std::shuffle(arrivals.begin(), arrivals.end(), std::mt19937(42));
+    }
+    return arrivals;
+}
+
+struct Result
+{
+    size_t write_calls = 0;
+    size_t peak_buffered = 0; // chunks held back, waiting to be written
+};
+
+// Sort @p pending by shard and offset and write each contiguous run with
+// one call.
+void
+write_runs(std::vector<Arrival>& pending,
+           const std::vector<std::unique_ptr<zarr::VectorizedFileWriter>>&
+             writers,
+           const std::vector<std::vector<uint8_t>>& chunks,
+           Result& result) {
+    std::sort(pending.begin(), pending.end(), [](const auto& a, const auto& b) {
+        return a.shard != b.shard ? a.shard < b.shard : a.chunk < b.chunk;
+    });
+
+    std::vector<std::span<const uint8_t>> buffers;
+    size_t first = 0;
+    while (first < pending.size()) {
+        size_t last = first + 1;
+        while (last < pending.size() &&
+               pending[last].shard == pending[first].shard &&
+               pending[last].chunk == pending[last - 1].chunk + 1) {
+            ++last;
+        }
+
+        buffers.clear();
+        for (auto i = first; i < last; ++i) {
+            buffers.emplace_back(
+              chunks[pending[i].shard * chunks_per_shard + pending[i].chunk]);
+        }
+        writers[pending[first].shard]->write_vectors(
+          buffers, pending[first].chunk * bytes_per_chunk);
+        ++result.write_calls;
+        first = last;
+    }
+    pending.clear();
+}
+
+Result
+write_chunks(const std::string& strategy,
+             const std::vector<Arrival>& arrivals,
+             const std::vector<std::vector<uint8_t>>& chunks) {
+    std::vector<std::unique_ptr<zarr::VectorizedFileWriter>> writers;
+    for (size_t s = 0; s < nshards; ++s) {
+        writers.push_back(
+          std::make_unique<zarr::VectorizedFileWriter>(shard_path(s)));
+    }
+
+    Result result;
+    std::vector<Arrival> pending;
+    std::vector<size_t> arrived(nshards, 0);
+    for (const auto& arrival : arrivals) {
+        if (strategy == "pwrite-per-chunk") {
+            // write each chunk at its offset as soon as it arrives
+            writers[arrival.shard]->write_vectors(
+              std::vector<std::span<const uint8_t>>{
+                chunks[arrival.shard * chunks_per_shard + arrival.chunk] },
+              arrival.chunk * bytes_per_chunk);
+            ++result.write_calls;
+            continue;
+        }
+
+        pending.push_back(arrival);
+        result.peak_buffered = std::max(result.peak_buffered, pending.size());
+
+        if (strategy == "batched-scatter") {
+            // a window of arrivals at a time, coalesced where contiguous
+            if (pending.size() == window) {
+                write_runs(pending, writers, chunks, result);
+            }
+        } else if (++arrived[arrival.shard] == chunks_per_shard) {
+            // consolidate-after-reorder: hold a shard's chunks until it is
+            // complete, then write it in order with one call
+            std::vector<Arrival> shard;
+            std::erase_if(pending, [&](const Arrival& a) {
+                if (a.shard == arrival.shard) {
+                    shard.push_back(a);
+                    return true;
+                }
+                return false;
+            });
+            write_runs(shard, writers, chunks, result);
+        }
+    }
+    if (!pending.empty()) {
+        write_runs(pending, writers, chunks, result);
+    }
+    return result;
+}
+
+// Check the first byte of every chunk landed where it should.
+bool
+verify() {
+    for (size_t s = 0; s < nshards; ++s) {
+        std::ifstream file(shard_path(s), std::ios::binary);
+        for (size_t i = 0; i < chunks_per_shard; ++i) {
+            char c = 0;
+            file.seekg(static_cast<std::streamoff>(i * bytes_per_chunk));
+            if (!file.get(c) || static_cast<uint8_t>(c) != fill_value(s, i)) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+void
+run(const std::string& order,
+    const std::string& strategy,
+    const std::vector<std::vector<uint8_t>>& chunks,
+    std::ostream* results_csv) {
+    for (size_t s = 0; s < nshards; ++s) {
+        if (fs::exists(shard_path(s))) {
+            fs::remove(shard_path(s));
+        }
+    }
+
+    const auto arrivals = arrival_order(order);
+    const auto start = std::chrono::high_resolution_clock::now();
+    const auto result = write_chunks(strategy, arrivals, chunks);
+    const auto end = std::chrono::high_resolution_clock::now();
+
+    const bool ok = verify();
+    for (size_t s = 0; s < nshards; ++s) {
+        if (fs::exists(shard_path(s))) {
+            fs::remove(shard_path(s));
+        }
+    }
+
+    if (results_csv == nullptr) {
+        return;
+    }
+
+    const double s = std::chrono::duration<double>(end - start).count();
+    const double mib = static_cast<double>(nshards * chunks_per_shard *
+                                           bytes_per_chunk) /
+                       (1024.0 * 1024.0);
+
+    std::stringstream ss;
+    ss << order << "," << strategy << "," << mib / s << ","
+       << result.write_calls << ","
+       << static_cast<double>(result.peak_buffered * bytes_per_chunk) /
+            (1024.0 * 1024.0)
+       << "," << (ok ? "yes" : "no");
+
+    std::cout << ss.str() << std::endl;
+    *results_csv << ss.str() << std::endl;
+}
+} // namespace
+
+int
+bench::write_order() {
+    std::ofstream results_csv("write_order.csv");
+    const std::string header =
+      "arrival_order,strategy,mib_per_s,write_calls,peak_buffered_mib,verified";
+    std::cout << header << std::endl;
+    results_csv << header << std::endl;
+
+    std::vector<std::vector<uint8_t>> chunks;
+    for (size_t s = 0; s < nshards; ++s) {
+        for (size_t i = 0; i < chunks_per_shard; ++i) {
+            chunks.emplace_back(bytes_per_chunk, fill_value(s, i));
+        }
+    }
+
+    bench::warm_up(
+      [&] { run("sequential", "pwrite-per-chunk", chunks, nullptr); });
+
+    for (const auto* order : { "sequential", "shuffled", "interleaved" }) {
+        for (const auto* strategy : { "pwrite-per-chunk",
+                                      "batched-scatter",
+                                      "consolidate-after-reorder" }) {
+            run(order, strategy, chunks, &results_csv);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,134 @@
+#include "benchmarks.hh"
+#include "vectorized.file.writer.hh"
+#include "zip.store.writer.hh"
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+namespace fs = std::filesystem;
+
+namespace {
+using Buffers = std::vector<std::span<const uint8_t>>;
+
+const size_t bytes_per_chunk = 512 * 1024;
+const size_t chunks_per_side = 16; // 256 chunks, 128 MiB
+const size_t runs = 3;
+const std::string directory_store = "zip_store";
+const std::string zip_path = "zip_store.zip";
+const std::string metadata = R"({"zarr_format":3,"node_type":"array"})";
+
+std::vector<std::vector<uint8_t>>
+make_chunks() {
+    std::vector<std::vector<uint8_t>> chunks(chunks_per_side *
+                                             chunks_per_side);
+    for (size_t i = 0; i < chunks.size(); ++i) {
+        chunks[i].assign(bytes_per_chunk, static_cast<uint8_t>(i));
+    }
+    return chunks;
+}
+
+std::string
+chunk_key(size_t i) {
+    return "array/c/" + std::to_string(i / chunks_per_side) + "/" +
+           std::to_string(i % chunks_per_side);
+}
+
+// What we do today: write a directory store, then pack it into a zip.
+void
+write_second_pass(const std::vector<std::vector<uint8_t>>& chunks) {
+    for (size_t i = 0; i < chunks.size(); ++i) {
+        const auto path = fs::path(directory_store) / chunk_key(i);
+        fs::create_directories(path.parent_path());
+        zarr::VectorizedFileWriter writer(path.string());
+        writer.write_vectors(Buffers{ chunks[i] }, 0);
+    }
+    {
+        std::ofstream(fs::path(directory_store) / "array" / "zarr.json")
+          << metadata;
+    }
+
+    zarr::ZipStoreWriter zip(zip_path);
+    for (const auto& file :
+         fs::recursive_directory_iterator(directory_store)) {
+        if (!file.is_regular_file()) {
+            continue;
+        }
+        std::vector<uint8_t> data(file.file_size());
+        std::ifstream in(file.path(), std::ios::binary);
+        in.read(reinterpret_cast<char*>(data.data()),
+                static_cast<std::streamsize>(data.size()));
+        zip.add(fs::relative(file.path(), directory_store).generic_string(),
+                Buffers{ data });
+    }
+    zip.close();
+
+    fs::remove_all(directory_store);
+}
+
+void
+write_direct(const std::vector<std::vector<uint8_t>>& chunks) {
+    zarr::ZipStoreWriter zip(zip_path);
+    zip.add("array/zarr.json",
+            Buffers{ { reinterpret_cast<const uint8_t*>(metadata.data()),
+                       metadata.size() } });
+    for (size_t i = 0; i < chunks.size(); ++i) {
+        zip.add(chunk_key(i), Buffers{ chunks[i] });
+    }
+    zip.close();
+}
+
+void
+run(const std::string& method,
+    const std::vector<std::vector<uint8_t>>& chunks,
+    std::ostream* results_csv) {
+    auto start = std::chrono::high_resolution_clock::now();
+    if (method == "second-pass") {
+        write_second_pass(chunks);
+    } else {
+        write_direct(chunks);
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+
+    const auto zip_bytes = fs::file_size(zip_path);
+    if (fs::exists(zip_path)) {
+        fs::remove(zip_path);
+    }
+
+    if (results_csv == nullptr) {
+        return;
+    }
+
+    const double mib = static_cast<double>(chunks.size() * bytes_per_chunk) /
+                       (1024.0 * 1024.0);
+    const double s = std::chrono::duration<double>(end - start).count();
+
+    std::stringstream ss;
+    ss << method << "," << mib / s << "," << chunks.size() + 1 << ","
+       << zip_bytes;
+
+    std::cout << ss.str() << std::endl;
+    *results_csv << ss.str() << std::endl;
+}
+} // namespace
+
+int
+bench::zip_store() {
+    std::ofstream results_csv("zip_store.csv");
+    const std::string header = "method,mib_per_s,entries,zip_bytes";
+    std::cout << header << std::endl;
+    results_csv << header << std::endl;
+
+    const auto chunks = make_chunks();
+
+    bench::warm_up([&] { run("direct", chunks, nullptr); });
+
+    for (size_t i = 0; i < runs; ++i) {
+        for (const auto* method : { "second-pass", "direct" }) {
+            run(method, chunks, &results_csv);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,361 @@
+#include "buffer.pool.hh"
+#include "numa.topology.hh"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <unistd.h>
+#endif
+
+namespace {
+size_t
+page_size() {
+#ifdef _WIN32
+    SYSTEM_INFO si;
+    GetSystemInfo(&si);
+    return si.dwPageSize;
+#else
+    return static_cast<size_t>(sysconf(_SC_PAGESIZE));
+#endif
+}
+
+size_t
+round_to_pages(size_t nbytes) {
+    static const size_t page = page_size();
+    return std::max<size_t>((nbytes + page - 1) / page * page, page);
+}
+
+uint8_t*
+allocate_pages(size_t nbytes) {
+#ifdef _WIN32
+    return static_cast<uint8_t*>(_aligned_malloc(nbytes, page_size()));
+#else
+    void* p = nullptr;
+    if (posix_memalign(&p, page_size(), nbytes) != 0) {
+        return nullptr;
+    }
+    return static_cast<uint8_t*>(p);
+#endif
+}
+
+void
+free_pages(uint8_t* data) {
+#ifdef _WIN32
+    _aligned_free(data);
+#else
+    free(data);
+#endif
+}
+
+bool
+lock_memory(const uint8_t* data, size_t nbytes) {
+#ifdef _WIN32
+    return VirtualLock(const_cast<uint8_t*>(data), nbytes);
+#else
+    return mlock(data, nbytes) == 0;
+#endif
+}
+
+void
+unlock_memory(const uint8_t* data, size_t nbytes) {
+#ifdef _WIN32
+    VirtualUnlock(const_cast<uint8_t*>(data), nbytes);
+#else
+    munlock(data, nbytes);
+#endif
+}
+
+// How much more this process may lock, as far as we can tell; the kernel
+// has the final say.
+uint64_t
+lockable_bytes() {
+#ifdef _WIN32
+    // bounded by the working set size instead, which VirtualLock enforces
+    return UINT64_MAX;
+#else
+    struct rlimit limit;
+    if (getrlimit(RLIMIT_MEMLOCK, &limit) < 0 ||
+        limit.rlim_cur == RLIM_INFINITY) {
+        return UINT64_MAX;
+    }
+    return limit.rlim_cur;
+#endif
+}
+} // namespace
+
+zarr::PageFaults
+zarr::page_faults() {
+    PageFaults faults;
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+    if (GetProcessMemoryInfo(
+          GetCurrentProcess(), &counters, sizeof(counters))) {
+        faults.minor = counters.PageFaultCount;
+    }
+#else
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) == 0) {
+        faults.minor = static_cast<uint64_t>(usage.ru_minflt);
+        faults.major = static_cast<uint64_t>(usage.ru_majflt);
+    }
+#endif
+    return faults;
+}
+
+zarr::BufferPool::Buffer::Buffer(BufferPool* pool, Block block, size_t size)
+  : pool_(pool)
+  , block_(block)
+  , size_(size) {
+}
+
+zarr::BufferPool::Buffer::Buffer(Buffer&& other) noexcept
+  : pool_(other.pool_)
+  , block_(other.block_)
+  , size_(other.size_) {
+    other.pool_ = nullptr;
+    other.block_ = {};
+    other.size_ = 0;
+}
+
+zarr::BufferPool::Buffer&
+zarr::BufferPool::Buffer::operator=(Buffer&& other) noexcept {
+    if (this != &other) {
+        if (pool_ != nullptr) {
+            pool_->return_(block_);
+        }
+        pool_ = other.pool_;
+        block_ = other.block_;
+        size_ = other.size_;
+        other.pool_ = nullptr;
+        other.block_ = {};
+        other.size_ = 0;
+    }
+    return *this;
+}
+
+zarr::BufferPool::Buffer::~Buffer() {
+    if (pool_ != nullptr) {
+        pool_->return_(block_);
+    }
+}
+
+zarr::BufferPool::BufferPool(size_t max_buffers)
+  : max_buffers_(max_buffers)
+  , locked_bytes_(0)
+  , acquired_(0)
+  , reused_(0)
+  , released_(0)
+  , dropped_(0)
+  , lock_failures_(0) {
+}
+
+zarr::BufferPool::~BufferPool() {
+    for (auto& block : free_) {
+        free_block_(block);
+    }
+}
+
+size_t
+zarr::BufferPool::reserve(size_t count, size_t nbytes, bool lock) {
+    size_t nlocked = 0;
+    for (size_t i = 0; i < count; ++i) {
+        {
+            std::scoped_lock guard(mutex_);
+            if (free_.size() >= max_buffers_) {
+                break;
+            }
+        }
+
+        Block block;
+        block.capacity = round_to_pages(nbytes);
+        block.data = allocate_pages(block.capacity);
+        if (block.data == nullptr) {
+            throw std::bad_alloc();
+        }
+        // zero-filling faults in every page here rather than while writing
+        std::fill_n(block.data, block.capacity, uint8_t{ 0 });
+
+        if (lock) {
+            if (lock_(block)) {
+                ++nlocked;
+            } else {
+                lock_failures_.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+
+        {
+            std::scoped_lock guard(mutex_);
+            if (free_.size() < max_buffers_) {
+                free_.push_back(block);
+                continue;
+            }
+        }
+
+        // filled up meanwhile; keep only what fits
+        if (block.locked) {
+            --nlocked;
+        }
+        free_block_(block);
+        break;
+    }
+    return nlocked;
+}
+
+zarr::BufferPool::Buffer
+zarr::BufferPool::acquire(size_t nbytes) {
+    acquired_.fetch_add(1, std::memory_order_relaxed);
+
+    {
+        std::scoped_lock lock(mutex_);
+        // the most recently released fit, as it is the likeliest to be warm
+        for (auto it = free_.rbegin(); it != free_.rend(); ++it) {
+            if (it->capacity >= nbytes) {
+                const Block block = *it;
+                free_.erase(std::next(it).base());
+                reused_.fetch_add(1, std::memory_order_relaxed);
+                return Buffer(this, block, nbytes);
+            }
+        }
+    }
+
+    Block block;
+    block.capacity = round_to_pages(nbytes);
+    block.data = allocate_pages(block.capacity);
+    if (block.data == nullptr) {
+        throw std::bad_alloc();
+    }
+    return Buffer(this, block, nbytes);
+}
+
+void
+zarr::BufferPool::release(Buffer&& buffer) {
+    Buffer released(std::move(buffer)); // goes back to its pool here
+}
+
+size_t
+zarr::BufferPool::idle() const {
+    std::scoped_lock lock(mutex_);
+    return free_.size();
+}
+
+zarr::BufferPool::Stats
+zarr::BufferPool::stats() const {
+    Stats stats;
+    stats.acquired = acquired_.load(std::memory_order_relaxed);
+    stats.reused = reused_.load(std::memory_order_relaxed);
+    stats.released = released_.load(std::memory_order_relaxed);
+    stats.dropped = dropped_.load(std::memory_order_relaxed);
+    stats.lock_failures = lock_failures_.load(std::memory_order_relaxed);
+    {
+        std::scoped_lock lock(mutex_);
+        stats.locked_bytes = locked_bytes_;
+    }
+    return stats;
+}
+
+void
+zarr::BufferPool::return_(Block block) {
+    released_.fetch_add(1, std::memory_order_relaxed);
+    {
+        std::scoped_lock lock(mutex_);
+        if (free_.size() < max_buffers_) {
+            free_.push_back(block);
+            return;
+        }
+        // keep reserved, locked storage over buffers allocated on demand
+        if (block.locked) {
+            const auto unlocked = std::find_if(
+              free_.begin(), free_.end(), [](const Block& idle) {
+                  return !idle.locked;
+              });
+            if (unlocked != free_.end()) {
+                std::swap(block, *unlocked);
+            }
+        }
+    }
+
+    // free outside the lock, but for the locked-bytes count
+    dropped_.fetch_add(1, std::memory_order_relaxed);
+    free_block_(block);
+}
+
+// Lock @p block if that stays within RLIMIT_MEMLOCK. The bytes are claimed
+// under the mutex first, so that concurrent calls cannot both fit.
+bool
+zarr::BufferPool::lock_(Block& block) {
+    {
+        std::scoped_lock lock(mutex_);
+        if (locked_bytes_ + block.capacity > lockable_bytes()) {
+            return false;
+        }
+        locked_bytes_ += block.capacity;
+    }
+
+    if (!lock_memory(block.data, block.capacity)) {
+        std::scoped_lock lock(mutex_);
+        locked_bytes_ -= block.capacity;
+        return false;
+    }
+    block.locked = true;
+    return true;
+}
+
+// Unlock and free @p block. Must not be called with mutex_ held.
+void
+zarr::BufferPool::free_block_(Block& block) {
+    if (block.locked) {
+        unlock_memory(block.data, block.capacity);
+        std::scoped_lock lock(mutex_);
+        locked_bytes_ -= block.capacity;
+    }
+    free_pages(block.data);
+    block = {};
+}
+
+zarr::NumaBufferPool::NumaBufferPool(size_t max_buffers_per_node) {
+    for (const auto& node : numa_nodes()) {
+        node_ids_.push_back(node.id);
+        pools_.push_back(std::make_unique<BufferPool>(max_buffers_per_node));
+    }
+}
+
+std::vector<int>
+zarr::NumaBufferPool::nodes() const {
+    return node_ids_;
+}
+
+zarr::BufferPool&
+zarr::NumaBufferPool::pool(int node) {
+    for (size_t i = 0; i < node_ids_.size(); ++i) {
+        if (node_ids_[i] == node) {
+            return *pools_[i];
+        }
+    }
+    throw std::out_of_range("No NUMA node " + std::to_string(node));
+}
+
+bool
+zarr::NumaBufferPool::reserve(int node, size_t count, size_t nbytes) {
+    auto& node_pool = pool(node);
+
+    bool pinned = false;
+    std::thread allocator([&] {
+        pinned = pin_current_thread_to_numa_node(node);
+        // reserving zero-fills, so every page is first touched here
+        node_pool.reserve(count, nbytes);
+    });
+    allocator.join();
+
+    return pinned;
+}
@@ -0,0 +1,159 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <vector>
+
+namespace zarr {
+struct PageFaults
+{
+    uint64_t minor = 0; // resolved without I/O, e.g. first touch
+    uint64_t major = 0; // needed I/O, e.g. a page swapped out
+};
+
+/// Page faults taken by this process so far. Windows does not tell minor
+/// from major faults, so all of them are counted as minor.
+PageFaults
+page_faults();
+
+/**
+ * @brief Thread-safe free list of chunk buffers.
+ *
+ * acquire() lends out an idle buffer large enough when one is available, so
+ * chunk-sized buffers are reused rather than reallocated, and a buffer goes
+ * back to the pool once its owner is done with it, e.g. when an
+ * asynchronous write completes. The pool owns every buffer's storage, which
+ * is page-aligned and never moves or grows while lent out.
+ *
+ * reserve() fills the pool up front with prefaulted buffers, optionally
+ * locked into memory. Locked buffers stay locked for as long as the pool
+ * keeps them, lent out or not, so filling and writing them never waits on a
+ * page coming back from swap.
+ */
+class BufferPool
+{
+    struct Block
+    {
+        uint8_t* data = nullptr;
+        size_t capacity = 0; // a whole number of pages
+        bool locked = false;
+    };
+
+  public:
+    struct Stats
+    {
+        uint64_t acquired = 0;
+        uint64_t reused = 0;   // acquired from the free list
+        uint64_t released = 0;
+        uint64_t dropped = 0;  // released into a full pool and freed
+        uint64_t locked_bytes = 0;
+        uint64_t lock_failures = 0; // reserved buffers left unlocked
+    };
+
+    /// A buffer lent out by a pool, which must outlive it. It goes back to
+    /// the pool when destroyed or assigned over.
+    class Buffer
+    {
+      public:
+        Buffer() = default;
+        Buffer(Buffer&& other) noexcept;
+        Buffer& operator=(Buffer&& other) noexcept;
+        ~Buffer();
+
+        uint8_t* data() { return block_.data; }
+        const uint8_t* data() const { return block_.data; }
+        size_t size() const { return size_; }
+        bool empty() const { return size_ == 0; }
+
+        /// Whether the buffer is locked into memory.
+        bool locked() const { return block_.locked; }
+
+        std::span<uint8_t> span() { return { block_.data, size_ }; }
+        std::span<const uint8_t> span() const { return { block_.data, size_ }; }
+
+      private:
+        friend class BufferPool;
+
+        BufferPool* pool_ = nullptr;
+        Block block_;
+        size_t size_ = 0;
+
+        Buffer(BufferPool* pool, Block block, size_t size);
+    };
+
+    /// Keep at most @p max_buffers idle buffers.
+    explicit BufferPool(size_t max_buffers = 1024);
+
+    BufferPool(const BufferPool&) = delete;
+    BufferPool& operator=(const BufferPool&) = delete;
+    ~BufferPool();
+
+    /// Add @p count zero-filled buffers of @p nbytes to the pool, as far as
+    /// it has room. With @p lock, lock them into memory too, as far as
+    /// RLIMIT_MEMLOCK allows; buffers beyond the limit are left unlocked.
+    /// Returns the number of buffers added and locked.
+    size_t reserve(size_t count, size_t nbytes, bool lock = false);
+
+    /// A buffer of @p nbytes, reusing an idle one that is large enough if
+    /// possible. Its contents are unspecified.
+    Buffer acquire(size_t nbytes);
+
+    /// Take @p buffer back, e.g. before it goes out of scope. Buffers from
+    /// another pool go back to their own.
+    void release(Buffer&& buffer);
+
+    size_t idle() const;
+    Stats stats() const;
+
+  private:
+    const size_t max_buffers_;
+
+    mutable std::mutex mutex_;
+    std::vector<Block> free_;
+    uint64_t locked_bytes_;
+
+    std::atomic<uint64_t> acquired_;
+    std::atomic<uint64_t> reused_;
+    std::atomic<uint64_t> released_;
+    std::atomic<uint64_t> dropped_;
+    std::atomic<uint64_t> lock_failures_;
+
+    void return_(Block block);
+    bool lock_(Block& block);
+    void free_block_(Block& block);
+};
+
+/**
+ * @brief One BufferPool per NUMA node.
+ *
+ * reserve() allocates buffers from a thread pinned to the node and touches
+ * them there, so the kernel places their pages on that node. Keep them
+ * there by releasing buffers to the pool they came from, and pin the
+ * threads that fill and write them (e.g., with
+ * AsyncChunkWriter::pin_to_numa_node) to the same node.
+ */
+class NumaBufferPool
+{
+  public:
+    explicit NumaBufferPool(size_t max_buffers_per_node = 1024);
+
+    /// Ids of the nodes with a pool.
+    std::vector<int> nodes() const;
+
+    /// The pool for @p node. Throws std::out_of_range for unknown nodes.
+    BufferPool& pool(int node);
+
+    /// Add @p count buffers of @p nbytes placed on @p node to its pool.
+    /// Returns false if the allocating thread could not be pinned, in
+    /// which case the buffers are placed wherever it ran.
+    bool reserve(int node, size_t count, size_t nbytes);
+
+  private:
+    std::vector<int> node_ids_;
+    std::vector<std::unique_ptr<BufferPool>> pools_;
+};
+} // namespace zarr
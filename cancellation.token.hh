@@ -0,0 +1,76 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+
+namespace zarr {
+/**
+ * @brief Asks the writes it is attached to to stop. Queued writes are
+ * dropped and a write in progress stops at its next slice; either way the
+ * write is reported as cancelled rather than waited for.
+ *
+ * Cancellation cannot be undone. A token must outlive the writes it is
+ * attached to.
+ */
+class CancellationToken
+{
+  public:
+    CancellationToken()
+      : cancelled_(false) {
+    }
+
+    CancellationToken(const CancellationToken&) = delete;
+    CancellationToken& operator=(const CancellationToken&) = delete;
+
+    void cancel() { cancelled_.store(true, std::memory_order_release); }
+    bool cancelled() const {
+        return cancelled_.load(std::memory_order_acquire);
+    }
+
+  private:
+    std::atomic<bool> cancelled_;
+};
+
+enum class WriteStatus
+{
+    Ok,
+    Failed,
+    Cancelled,
+    TimedOut,
+};
+
+/**
+ * @brief Limits on a single write, checked before each slice of at most
+ * slice_bytes, so that a cancelled or late write stops within one slice.
+ * A write that stops early leaves a prefix of its data written.
+ */
+struct WriteBounds
+{
+    using Clock = std::chrono::steady_clock;
+
+    // e.g. the caller's token and the writer's own; null if unused
+    std::array<const CancellationToken*, 2> tokens{};
+    Clock::time_point deadline = Clock::time_point::max();
+    size_t slice_bytes = 8 << 20;
+
+    bool bounded() const {
+        return tokens[0] != nullptr || tokens[1] != nullptr ||
+               deadline != Clock::time_point::max();
+    }
+
+    /// Ok if the write may go on.
+    WriteStatus check() const {
+        for (const auto* token : tokens) {
+            if (token != nullptr && token->cancelled()) {
+                return WriteStatus::Cancelled;
+            }
+        }
+        if (deadline != Clock::time_point::max() && Clock::now() >= deadline) {
+            return WriteStatus::TimedOut;
+        }
+        return WriteStatus::Ok;
+    }
+};
+} // namespace zarr
@@ -0,0 +1,55 @@
+#include "chunk.pipeline.hh"
+
+#include <exception>
+
+zarr::ChunkPipeline&
+zarr::ChunkPipeline::add_stage(const std::string& name, ChunkStage stage) {
+    stages_.emplace_back(name, std::move(stage));
+    return *this;
+}
+
+std::vector<std::string>
+zarr::ChunkPipeline::stage_names() const {
+    std::vector<std::string> names;
+    for (const auto& [name, stage] : stages_) {
+        names.push_back(name);
+    }
+    return names;
+}
+
+void
+zarr::ChunkPipeline::apply(std::vector<std::vector<uint8_t>>& chunks) const {
+    const auto nchunks = static_cast<long long>(chunks.size());
+    for (const auto& [name, stage] : stages_) {
+        // exceptions must not escape the parallel region
+        std::exception_ptr error;
+#pragma omp parallel for
+        for (long long i = 0; i < nchunks; ++i) {
+            try {
+                stage(chunks[i]);
+            } catch (...) {
+#pragma omp critical
+                if (!error) {
+                    error = std::current_exception();
+                }
+            }
+        }
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+}
+
+bool
+zarr::ChunkPipeline::write(VectorizedFileWriter& writer,
+                           std::vector<std::vector<uint8_t>>& chunks,
+                           size_t offset) const {
+    apply(chunks);
+    return writer.write_vectors(chunks, offset);
+}
+
+std::vector<uint8_t>&
+zarr::stage_scratch() {
+    thread_local std::vector<uint8_t> scratch;
+    return scratch;
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include "vectorized.file.writer.hh"
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace zarr {
+/// Transforms one chunk buffer in place. May change the buffer's size.
+using ChunkStage = std::function<void(std::vector<uint8_t>& chunk)>;
+
+/**
+ * @brief An ordered list of per-chunk stages run ahead of a vectored write.
+ *
+ * Chunks are independent, so each stage runs over all chunks in parallel
+ * before the next stage starts.
+ */
+class ChunkPipeline
+{
+  public:
+    ChunkPipeline& add_stage(const std::string& name, ChunkStage stage);
+
+    bool empty() const { return stages_.empty(); }
+    std::vector<std::string> stage_names() const;
+
+    void apply(std::vector<std::vector<uint8_t>>& chunks) const;
+
+    /// Apply all stages to @p chunks, then write them out at @p offset.
+    bool write(VectorizedFileWriter& writer,
+               std::vector<std::vector<uint8_t>>& chunks,
+               size_t offset) const;
+
+  private:
+    std::vector<std::pair<std::string, ChunkStage>> stages_;
+};
+
+/// Scratch buffer for stages that cannot work in place. One per thread, and
+/// swapped with the chunk after conversion so neither is reallocated once
+/// both have grown to the chunk size.
+std::vector<uint8_t>&
+stage_scratch();
+} // namespace zarr
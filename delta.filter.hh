@@ -0,0 +1,195 @@
+#pragma once
+
+#include "chunk.pipeline.hh"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <type_traits>
+
+namespace zarr {
+/*
+ * Delta and linear-predictor filters over integer chunk buffers.
+ *
+ * Both filters replace each element by its residual against the element(s)
+ * @p stride elements earlier: stride 1 predicts from the previous pixel along
+ * the fastest dimension, a stride of one frame predicts from the same pixel
+ * in the previous frame. Arithmetic wraps, so the inverses are exact. The
+ * forward filters are out of place so that every element is independent and
+ * the loops vectorize; the inverses run in place, vectorized across each
+ * stride-long row.
+ */
+
+/// out[i] = in[i] - in[i - stride]
+template<typename T>
+void
+delta_encode(const T* in, size_t n, size_t stride, T* out) {
+    static_assert(std::is_integral_v<T>, "Delta filter needs integral types");
+    using U = std::make_unsigned_t<T>;
+    const auto* x = reinterpret_cast<const U*>(in);
+    auto* y = reinterpret_cast<U*>(out);
+
+    const size_t head = std::min(stride, n);
+    memcpy(y, x, head * sizeof(U));
+
+#pragma omp simd
+    for (size_t i = head; i < n; ++i) {
+        y[i] = static_cast<U>(x[i] - x[i - stride]);
+    }
+}
+
+/// Inverse of delta_encode, in place.
+template<typename T>
+void
+delta_decode(T* data, size_t n, size_t stride) {
+    static_assert(std::is_integral_v<T>, "Delta filter needs integral types");
+    using U = std::make_unsigned_t<T>;
+    auto* x = reinterpret_cast<U*>(data);
+
+    if (stride == 1) { // prefix sum; inherently serial
+        U acc = 0;
+        for (size_t i = 0; i < n; ++i) {
+            acc = static_cast<U>(acc + x[i]);
+            x[i] = acc;
+        }
+        return;
+    }
+
+    for (size_t row = stride; row < n; row += stride) {
+        const size_t len = std::min(stride, n - row);
+        U* cur = x + row;
+        const U* prev = cur - stride;
+#pragma omp simd
+        for (size_t j = 0; j < len; ++j) {
+            cur[j] = static_cast<U>(cur[j] + prev[j]);
+        }
+    }
+}
+
+/// out[i] = in[i] - (2 in[i - stride] - in[i - 2 stride]), i.e., the residual
+/// against a linear extrapolation; falls back to delta for the second row.
+template<typename T>
+void
+predictor_encode(const T* in, size_t n, size_t stride, T* out) {
+    static_assert(std::is_integral_v<T>, "Predictor needs integral types");
+    using U = std::make_unsigned_t<T>;
+    const auto* x = reinterpret_cast<const U*>(in);
+    auto* y = reinterpret_cast<U*>(out);
+
+    const size_t head = std::min(stride, n);
+    const size_t second = std::min(2 * stride, n);
+    memcpy(y, x, head * sizeof(U));
+
+#pragma omp simd
+    for (size_t i = head; i < second; ++i) {
+        y[i] = static_cast<U>(x[i] - x[i - stride]);
+    }
+
+#pragma omp simd
+    for (size_t i = second; i < n; ++i) {
+        y[i] = static_cast<U>(x[i] - 2 * x[i - stride] + x[i - 2 * stride]);
+    }
+}
+
+/// Inverse of predictor_encode, in place.
+template<typename T>
+void
+predictor_decode(T* data, size_t n, size_t stride) {
+    static_assert(std::is_integral_v<T>, "Predictor needs integral types");
+    using U = std::make_unsigned_t<T>;
+    auto* x = reinterpret_cast<U*>(data);
+
+    const size_t second = std::min(2 * stride, n);
+#pragma omp simd
+    for (size_t i = stride; i < second; ++i) {
+        x[i] = static_cast<U>(x[i] + x[i - stride]);
+    }
+
+    if (stride == 1) { // second-order recurrence; inherently serial
+        for (size_t i = second; i < n; ++i) {
+            x[i] = static_cast<U>(x[i] + 2 * x[i - 1] - x[i - 2]);
+        }
+        return;
+    }
+
+    for (size_t row = second; row < n; row += stride) {
+        const size_t len = std::min(stride, n - row);
+        U* cur = x + row;
+        const U* prev = cur - stride;
+        const U* prev2 = prev - stride;
+#pragma omp simd
+        for (size_t j = 0; j < len; ++j) {
+            cur[j] = static_cast<U>(cur[j] + 2 * prev[j] - prev2[j]);
+        }
+    }
+}
+
+namespace detail {
+template<typename T>
+size_t
+element_count(const std::vector<uint8_t>& chunk) {
+    if (chunk.size() % sizeof(T) != 0) {
+        throw std::invalid_argument(
+          "Chunk size is not a multiple of the element size");
+    }
+    return chunk.size() / sizeof(T);
+}
+
+template<typename T, typename Encode>
+ChunkStage
+make_encode_stage(size_t stride, Encode encode) {
+    if (stride == 0) {
+        throw std::invalid_argument("Filter stride must be nonzero");
+    }
+    return [stride, encode](std::vector<uint8_t>& chunk) {
+        const size_t n = element_count<T>(chunk);
+        auto& out = stage_scratch();
+        out.resize(chunk.size());
+        encode(reinterpret_cast<const T*>(chunk.data()),
+               n,
+               stride,
+               reinterpret_cast<T*>(out.data()));
+        chunk.swap(out);
+    };
+}
+
+template<typename T, typename Decode>
+ChunkStage
+make_decode_stage(size_t stride, Decode decode) {
+    if (stride == 0) {
+        throw std::invalid_argument("Filter stride must be nonzero");
+    }
+    return [stride, decode](std::vector<uint8_t>& chunk) {
+        decode(reinterpret_cast<T*>(chunk.data()),
+               element_count<T>(chunk),
+               stride);
+    };
+}
+} // namespace detail
+
+// Chunk stages for a ChunkPipeline; @p stride is in elements.
+template<typename T>
+ChunkStage
+delta_stage(size_t stride) {
+    return detail::make_encode_stage<T>(stride, delta_encode<T>);
+}
+
+template<typename T>
+ChunkStage
+delta_inverse_stage(size_t stride) {
+    return detail::make_decode_stage<T>(stride, delta_decode<T>);
+}
+
+template<typename T>
+ChunkStage
+predictor_stage(size_t stride) {
+    return detail::make_encode_stage<T>(stride, predictor_encode<T>);
+}
+
+template<typename T>
+ChunkStage
+predictor_inverse_stage(size_t stride) {
+    return detail::make_decode_stage<T>(stride, predictor_decode<T>);
+}
+} // namespace zarr
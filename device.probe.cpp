@@ -0,0 +1,195 @@
+#include "device.probe.hh"
+
+#include <algorithm>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <mutex>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/stat.h>
+#endif
+
+#ifdef __linux__
+#include <sys/sysmacros.h>
+#endif
+
+namespace fs = std::filesystem;
+
+namespace {
+#ifdef _WIN32
+using DeviceId = std::string; // volume root
+#else
+using DeviceId = uint64_t; // st_dev
+#endif
+
+std::mutex cache_mutex;
+std::map<DeviceId, zarr::DeviceInfo> cache;
+
+// The path itself if it exists, else its nearest existing ancestor.
+std::string
+existing_path(const std::string& path) {
+    std::error_code ec;
+    fs::path p = fs::absolute(path, ec);
+    if (ec) {
+        return path;
+    }
+    while (!fs::exists(p, ec) && p.has_relative_path()) {
+        p = p.parent_path();
+    }
+    return p.string();
+}
+
+#ifdef __linux__
+template<typename T>
+bool
+read_value(const fs::path& path, T& value) {
+    std::ifstream file(path);
+    return static_cast<bool>(file >> value);
+}
+
+void
+probe_queue(dev_t device, zarr::DeviceInfo& info) {
+    std::error_code ec;
+    auto block = fs::canonical("/sys/dev/block/" +
+                                 std::to_string(major(device)) + ":" +
+                                 std::to_string(minor(device)),
+                               ec);
+    if (ec) {
+        return; // not a block device, e.g. tmpfs or NFS
+    }
+
+    // a partition has no queue of its own; its disk's is one level up
+    while (!fs::exists(block / "queue", ec) && block.has_relative_path()) {
+        block = block.parent_path();
+    }
+    const auto queue = block / "queue";
+
+    size_t value = 0;
+    if (read_value(queue / "logical_block_size", value) && value > 0) {
+        info.logical_block_size = value;
+    }
+    if (read_value(queue / "physical_block_size", value) && value > 0) {
+        info.physical_block_size = value;
+    }
+    int rotational = 0;
+    if (read_value(queue / "rotational", rotational)) {
+        info.rotational = rotational != 0;
+    }
+    if (read_value(queue / "nr_requests", value)) {
+        info.queue_depth = value;
+    }
+    if (read_value(queue / "max_sectors_kb", value)) {
+        info.max_io_bytes = value * 1024;
+    }
+}
+#endif
+
+#ifndef _WIN32
+// Capabilities of the device @p st is on, cached by device. On a miss,
+// statx looks at @p pathname relative to @p dirfd, with @p flags.
+zarr::DeviceInfo
+probe_stat(const struct stat& st,
+           [[maybe_unused]] int dirfd,
+           [[maybe_unused]] const char* pathname,
+           [[maybe_unused]] int flags) {
+    const DeviceId id = static_cast<DeviceId>(st.st_dev);
+    {
+        std::scoped_lock lock(cache_mutex);
+        if (const auto it = cache.find(id); it != cache.end()) {
+            return it->second;
+        }
+    }
+
+    zarr::DeviceInfo info;
+    info.physical_block_size =
+      std::max(info.physical_block_size, static_cast<size_t>(st.st_blksize));
+#ifdef __linux__
+    probe_queue(st.st_dev, info);
+#ifdef STATX_DIOALIGN
+    struct statx stx;
+    if (statx(dirfd, pathname, flags, STATX_DIOALIGN, &stx) == 0 &&
+        (stx.stx_mask & STATX_DIOALIGN) != 0) {
+        info.dio_memory_alignment = stx.stx_dio_mem_align;
+        info.dio_offset_alignment = stx.stx_dio_offset_align;
+    }
+#endif
+#endif
+
+    std::scoped_lock lock(cache_mutex);
+    return cache.emplace(id, info).first->second;
+}
+#endif
+} // namespace
+
+size_t
+zarr::DeviceInfo::direct_io_alignment() const {
+    if (dio_memory_alignment == 0 && dio_offset_alignment == 0) {
+        return logical_block_size;
+    }
+    return std::max(dio_memory_alignment, dio_offset_alignment);
+}
+
+zarr::DeviceInfo
+zarr::probe_device(const std::string& path) {
+    const auto target = existing_path(path);
+    DeviceInfo info;
+
+#ifdef _WIN32
+    char volume_path[MAX_PATH];
+    if (!GetVolumePathNameA(target.c_str(), volume_path, MAX_PATH)) {
+        return info;
+    }
+    const DeviceId id = volume_path;
+    {
+        std::scoped_lock lock(cache_mutex);
+        if (const auto it = cache.find(id); it != cache.end()) {
+            return it->second;
+        }
+    }
+
+    DWORD sectors_per_cluster;
+    DWORD bytes_per_sector;
+    DWORD number_of_free_clusters;
+    DWORD total_number_of_clusters;
+    if (GetDiskFreeSpaceA(volume_path,
+                          &sectors_per_cluster,
+                          &bytes_per_sector,
+                          &number_of_free_clusters,
+                          &total_number_of_clusters)) {
+        // unbuffered I/O must be aligned to the sector size
+        info.logical_block_size = bytes_per_sector;
+        info.physical_block_size = bytes_per_sector;
+        info.dio_memory_alignment = bytes_per_sector;
+        info.dio_offset_alignment = bytes_per_sector;
+    }
+
+    std::scoped_lock lock(cache_mutex);
+    return cache.emplace(id, info).first->second;
+#else
+    struct stat st;
+    if (stat(target.c_str(), &st) < 0) {
+        return info;
+    }
+    return probe_stat(st, AT_FDCWD, target.c_str(), 0);
+#endif
+}
+
+#ifndef _WIN32
+zarr::DeviceInfo
+zarr::probe_device(int fd) {
+    struct stat st;
+    if (fstat(fd, &st) < 0) {
+        return {};
+    }
+#ifdef AT_EMPTY_PATH
+    return probe_stat(st, fd, "", AT_EMPTY_PATH);
+#else
+    return probe_stat(st, fd, "", 0); // no statx here, so unused
+#endif
+}
+#endif
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+namespace zarr {
+struct DeviceInfo
+{
+    size_t logical_block_size = 512;
+    size_t physical_block_size = 512;
+
+    // what the file system requires of direct I/O buffers and offsets
+    // (statx STATX_DIOALIGN, Linux 6.1+); 0 if unknown or unsupported
+    size_t dio_memory_alignment = 0;
+    size_t dio_offset_alignment = 0;
+
+    bool rotational = false;
+    size_t queue_depth = 0;  // requests the device queue holds; 0 if unknown
+    size_t max_io_bytes = 0; // largest single request; 0 if unknown
+
+    /// Alignment that satisfies every direct I/O requirement on the device:
+    /// the file system's if known, otherwise the logical block size.
+    size_t direct_io_alignment() const;
+};
+
+/// Capabilities of the storage holding @p path, or of its directory if
+/// @p path does not exist yet. Probed once per device and then cached:
+/// on Linux, from statx and the block device's queue in sysfs (that of
+/// the whole disk, for a partition); on Windows, from the volume's sector
+/// size. What cannot be probed keeps its default.
+DeviceInfo
+probe_device(const std::string& path);
+
+#ifndef _WIN32
+/// As above, for the storage holding the open file @p fd. A cached device
+/// costs one fstat, with no path lookup.
+DeviceInfo
+probe_device(int fd);
+#endif
+} // namespace zarr
@@ -0,0 +1,254 @@
+#include "dtype.convert.hh"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#if defined(__F16C__) && defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+namespace {
+uint16_t
+float_to_half_scalar(float f) {
+    uint32_t x;
+    memcpy(&x, &f, sizeof(x));
+
+    const uint32_t sign = (x >> 16) & 0x8000;
+    uint32_t mant = x & 0x7fffff;
+    const int32_t exp = static_cast<int32_t>((x >> 23) & 0xff);
+
+    if (exp == 0xff) { // inf or nan; keep nans quiet
+        return static_cast<uint16_t>(sign | 0x7c00 |
+                                     (mant ? 0x200 | (mant >> 13) : 0));
+    }
+
+    const int32_t e = exp - 127 + 15;
+    if (e >= 0x1f) { // overflow
+        return static_cast<uint16_t>(sign | 0x7c00);
+    }
+
+    if (e <= 0) { // subnormal or zero
+        if (e < -10) {
+            return static_cast<uint16_t>(sign);
+        }
+        mant |= 0x800000;
+        const uint32_t shift = 14 - e;
+        uint32_t half_mant = mant >> shift;
+        const uint32_t rem = mant & ((1U << shift) - 1);
+        const uint32_t halfway = 1U << (shift - 1);
+        if (rem > halfway || (rem == halfway && (half_mant & 1))) {
+            ++half_mant;
+        }
+        return static_cast<uint16_t>(sign | half_mant);
+    }
+
+    uint32_t half = sign | (static_cast<uint32_t>(e) << 10) | (mant >> 13);
+    const uint32_t rem = mant & 0x1fff;
+    if (rem > 0x1000 || (rem == 0x1000 && (half & 1))) {
+        ++half; // may carry into the exponent, which is still correct
+    }
+    return static_cast<uint16_t>(half);
+}
+
+float
+half_to_float_scalar(uint16_t h) {
+    const uint32_t sign = static_cast<uint32_t>(h & 0x8000) << 16;
+    int32_t exp = (h >> 10) & 0x1f;
+    uint32_t mant = h & 0x3ff;
+
+    uint32_t x;
+    if (exp == 0) {
+        if (mant == 0) {
+            x = sign;
+        } else { // normalize the subnormal
+            exp = 1;
+            while (!(mant & 0x400)) {
+                mant <<= 1;
+                --exp;
+            }
+            mant &= 0x3ff;
+            x = sign | (static_cast<uint32_t>(exp + 112) << 23) | (mant << 13);
+        }
+    } else if (exp == 0x1f) {
+        x = sign | 0x7f800000 | (mant << 13);
+    } else {
+        x = sign | (static_cast<uint32_t>(exp + 112) << 23) | (mant << 13);
+    }
+
+    float f;
+    memcpy(&f, &x, sizeof(f));
+    return f;
+}
+
+template<typename In, typename Out, typename Kernel>
+zarr::ChunkStage
+make_stage(size_t (*out_size)(size_t), Kernel kernel) {
+    return [out_size, kernel](std::vector<uint8_t>& chunk) {
+        if (chunk.size() % sizeof(In) != 0) {
+            throw std::invalid_argument(
+              "Chunk size is not a multiple of the element size");
+        }
+        const size_t n = chunk.size() / sizeof(In);
+
+        auto& out = zarr::stage_scratch();
+        out.resize(out_size(n));
+        kernel(reinterpret_cast<const In*>(chunk.data()),
+               n,
+               reinterpret_cast<Out*>(out.data()));
+        chunk.swap(out);
+    };
+}
+} // namespace
+
+void
+zarr::pack_12bit(const uint16_t* in, size_t n, uint8_t* out) {
+    const auto npairs = static_cast<long long>(n / 2);
+
+#pragma omp simd
+    for (long long i = 0; i < npairs; ++i) {
+        const uint16_t a = in[2 * i] & 0xfff;
+        const uint16_t b = in[2 * i + 1] & 0xfff;
+        out[3 * i] = static_cast<uint8_t>(a);
+        out[3 * i + 1] = static_cast<uint8_t>((a >> 8) | (b << 4));
+        out[3 * i + 2] = static_cast<uint8_t>(b >> 4);
+    }
+
+    if (n % 2) {
+        const uint16_t a = in[n - 1] & 0xfff;
+        out[3 * npairs] = static_cast<uint8_t>(a);
+        out[3 * npairs + 1] = static_cast<uint8_t>(a >> 8);
+    }
+}
+
+void
+zarr::unpack_12bit(const uint8_t* in, size_t n, uint16_t* out) {
+    const auto npairs = static_cast<long long>(n / 2);
+
+#pragma omp simd
+    for (long long i = 0; i < npairs; ++i) {
+        const uint16_t b0 = in[3 * i];
+        const uint16_t b1 = in[3 * i + 1];
+        const uint16_t b2 = in[3 * i + 2];
+        out[2 * i] = static_cast<uint16_t>(b0 | ((b1 & 0xf) << 8));
+        out[2 * i + 1] = static_cast<uint16_t>((b1 >> 4) | (b2 << 4));
+    }
+
+    if (n % 2) {
+        out[n - 1] = static_cast<uint16_t>(in[3 * npairs] |
+                                           ((in[3 * npairs + 1] & 0xf) << 8));
+    }
+}
+
+void
+zarr::scale_u16_to_u8(const uint16_t* in, size_t n, uint8_t* out, int shift) {
+#pragma omp simd
+    for (size_t i = 0; i < n; ++i) {
+        const uint16_t v = in[i] >> shift;
+        out[i] = static_cast<uint8_t>(v > 255 ? 255 : v);
+    }
+}
+
+void
+zarr::scale_u8_to_u16(const uint8_t* in, size_t n, uint16_t* out, int shift) {
+#pragma omp simd
+    for (size_t i = 0; i < n; ++i) {
+        out[i] = static_cast<uint16_t>(in[i] << shift);
+    }
+}
+
+void
+zarr::float_to_half(const float* in, size_t n, uint16_t* out) {
+    size_t i = 0;
+#if defined(__F16C__) && defined(__AVX__)
+    for (; i + 8 <= n; i += 8) {
+        const __m256 v = _mm256_loadu_ps(in + i);
+        const __m128i h = _mm256_cvtps_ph(v, _MM_FROUND_TO_NEAREST_INT);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), h);
+    }
+#elif defined(__aarch64__)
+    for (; i + 4 <= n; i += 4) {
+        const float16x4_t h = vcvt_f16_f32(vld1q_f32(in + i));
+        vst1_u16(out + i, vreinterpret_u16_f16(h));
+    }
+#endif
+    for (; i < n; ++i) {
+        out[i] = float_to_half_scalar(in[i]);
+    }
+}
+
+void
+zarr::half_to_float(const uint16_t* in, size_t n, float* out) {
+    size_t i = 0;
+#if defined(__F16C__) && defined(__AVX__)
+    for (; i + 8 <= n; i += 8) {
+        const __m128i h =
+          _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+        _mm256_storeu_ps(out + i, _mm256_cvtph_ps(h));
+    }
+#elif defined(__aarch64__)
+    for (; i + 4 <= n; i += 4) {
+        const float16x4_t h = vreinterpret_f16_u16(vld1_u16(in + i));
+        vst1q_f32(out + i, vcvt_f32_f16(h));
+    }
+#endif
+    for (; i < n; ++i) {
+        out[i] = half_to_float_scalar(in[i]);
+    }
+}
+
+zarr::ChunkStage
+zarr::pack_12bit_stage() {
+    return make_stage<uint16_t, uint8_t>(
+      [](size_t n) { return packed_12bit_size(n); }, pack_12bit);
+}
+
+zarr::ChunkStage
+zarr::unpack_12bit_stage() {
+    // a trailing odd value occupies two bytes, so 3k + 2 bytes hold 2k + 1
+    // and 3k + 1 bytes are never the output of pack_12bit
+    return [](std::vector<uint8_t>& chunk) {
+        if (chunk.size() % 3 == 1) {
+            throw std::invalid_argument(
+              "Chunk size is not a packed 12-bit size");
+        }
+        const size_t n = 2 * (chunk.size() / 3) + (chunk.size() % 3 ? 1 : 0);
+
+        auto& out = stage_scratch();
+        out.resize(n * sizeof(uint16_t));
+        unpack_12bit(chunk.data(), n, reinterpret_cast<uint16_t*>(out.data()));
+        chunk.swap(out);
+    };
+}
+
+zarr::ChunkStage
+zarr::scale_u16_to_u8_stage(int shift) {
+    return make_stage<uint16_t, uint8_t>(
+      [](size_t n) { return n; },
+      [shift](const uint16_t* in, size_t n, uint8_t* out) {
+          scale_u16_to_u8(in, n, out, shift);
+      });
+}
+
+zarr::ChunkStage
+zarr::scale_u8_to_u16_stage(int shift) {
+    return make_stage<uint8_t, uint16_t>(
+      [](size_t n) { return n * sizeof(uint16_t); },
+      [shift](const uint8_t* in, size_t n, uint16_t* out) {
+          scale_u8_to_u16(in, n, out, shift);
+      });
+}
+
+zarr::ChunkStage
+zarr::float_to_half_stage() {
+    return make_stage<float, uint16_t>(
+      [](size_t n) { return n * sizeof(uint16_t); }, float_to_half);
+}
+
+zarr::ChunkStage
+zarr::half_to_float_stage() {
+    return make_stage<uint16_t, float>(
+      [](size_t n) { return n * sizeof(float); }, half_to_float);
+}
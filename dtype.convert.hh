@@ -0,0 +1,58 @@
+#pragma once
+
+#include "chunk.pipeline.hh"
+
+#include <cstddef>
+#include <cstdint>
+
+namespace zarr {
+/// Bytes needed to hold @p n 12-bit values packed two to three bytes.
+constexpr size_t
+packed_12bit_size(size_t n) {
+    return (3 * n + 1) / 2;
+}
+
+/// Pack the low 12 bits of each of @p n values, two values per three bytes.
+void
+pack_12bit(const uint16_t* in, size_t n, uint8_t* out);
+
+/// Inverse of pack_12bit.
+void
+unpack_12bit(const uint8_t* in, size_t n, uint16_t* out);
+
+/// out[i] = min(in[i] >> shift, 255), e.g. shift = 4 for 12-bit data.
+void
+scale_u16_to_u8(const uint16_t* in, size_t n, uint8_t* out, int shift);
+
+/// out[i] = in[i] << shift. Inverse of scale_u16_to_u8 up to truncation.
+void
+scale_u8_to_u16(const uint8_t* in, size_t n, uint16_t* out, int shift);
+
+/// IEEE 754 binary32 to binary16, rounding to nearest even.
+void
+float_to_half(const float* in, size_t n, uint16_t* out);
+
+/// IEEE 754 binary16 to binary32. Exact.
+void
+half_to_float(const uint16_t* in, size_t n, float* out);
+
+// Chunk stages wrapping the kernels above, for use in a ChunkPipeline. Input
+// chunks must hold a whole number of elements of the input type.
+ChunkStage
+pack_12bit_stage();
+
+ChunkStage
+unpack_12bit_stage();
+
+ChunkStage
+scale_u16_to_u8_stage(int shift);
+
+ChunkStage
+scale_u8_to_u16_stage(int shift);
+
+ChunkStage
+float_to_half_stage();
+
+ChunkStage
+half_to_float_stage();
+} // namespace zarr
@@ -0,0 +1,180 @@
+#include "fault.injector.hh"
+
+#include <algorithm>
+#include <cerrno>
+#include <thread>
+#include <vector>
+
+#include <unistd.h>
+
+namespace {
+std::atomic<zarr::FaultInjector*> installed_injector{ nullptr };
+} // namespace
+
+zarr::FaultInjector::FaultInjector(const Config& config)
+  : config_(config)
+  , rng_(config.seed)
+  , capacity_bytes_(config.capacity_bytes)
+  , bytes_written_(0)
+  , calls_(0)
+  , short_writes_(0)
+  , eintr_(0)
+  , eagain_(0)
+  , enospc_(0)
+  , latency_spikes_(0) {
+}
+
+zarr::FaultInjector::~FaultInjector() {
+    FaultInjector* self = this;
+    installed_injector.compare_exchange_strong(
+      self, nullptr, std::memory_order_acq_rel);
+}
+
+void
+zarr::FaultInjector::install(FaultInjector* injector) {
+    installed_injector.store(injector, std::memory_order_release);
+}
+
+zarr::FaultInjector*
+zarr::FaultInjector::installed() {
+    return installed_injector.load(std::memory_order_acquire);
+}
+
+void
+zarr::FaultInjector::set_capacity(uint64_t bytes) {
+    std::scoped_lock lock(mutex_);
+    capacity_bytes_ = bytes;
+}
+
+zarr::FaultInjector::Stats
+zarr::FaultInjector::stats() const {
+    Stats stats;
+    stats.calls = calls_.load(std::memory_order_relaxed);
+    stats.short_writes = short_writes_.load(std::memory_order_relaxed);
+    stats.eintr = eintr_.load(std::memory_order_relaxed);
+    stats.eagain = eagain_.load(std::memory_order_relaxed);
+    stats.enospc = enospc_.load(std::memory_order_relaxed);
+    stats.latency_spikes = latency_spikes_.load(std::memory_order_relaxed);
+
+    std::scoped_lock lock(mutex_);
+    stats.bytes_written = bytes_written_;
+    return stats;
+}
+
+ssize_t
+zarr::FaultInjector::pwritev(int fd,
+                             const struct iovec* iov,
+                             int iovcnt,
+                             off_t offset) {
+    if (auto* injector = installed()) {
+        return injector->pwritev_(fd, iov, iovcnt, offset);
+    }
+    return ::pwritev(fd, iov, iovcnt, offset);
+}
+
+ssize_t
+zarr::FaultInjector::pwrite(int fd,
+                            const void* buf,
+                            size_t nbytes,
+                            off_t offset) {
+    if (auto* injector = installed()) {
+        struct iovec iov;
+        iov.iov_base = const_cast<void*>(buf);
+        iov.iov_len = nbytes;
+        return injector->pwritev_(fd, &iov, 1, offset);
+    }
+    return ::pwrite(fd, buf, nbytes, offset);
+}
+
+ssize_t
+zarr::FaultInjector::pwritev_(int fd,
+                              const struct iovec* iov,
+                              int iovcnt,
+                              off_t offset) {
+    calls_.fetch_add(1, std::memory_order_relaxed);
+
+    size_t total = 0;
+    for (int i = 0; i < iovcnt; ++i) {
+        total += iov[i].iov_len;
+    }
+
+    bool spike = false;
+    int error = 0;
+    size_t limit = total;
+    {
+        std::scoped_lock lock(mutex_);
+        std::uniform_real_distribution<double> uniform(0.0, 1.0);
+        const auto roll = [&](double p) { return p > 0 && uniform(rng_) < p; };
+
+        spike = roll(config_.latency_probability);
+        if (roll(config_.enospc_probability)) {
+            error = ENOSPC;
+        } else if (roll(config_.eintr_probability)) {
+            error = EINTR;
+        } else if (roll(config_.eagain_probability)) {
+            error = EAGAIN;
+        } else {
+            // a full disk takes what fits, then refuses the rest
+            if (capacity_bytes_ > 0) {
+                const auto room = capacity_bytes_ > bytes_written_
+                                    ? capacity_bytes_ - bytes_written_
+                                    : 0;
+                if (room == 0 && total > 0) {
+                    error = ENOSPC;
+                }
+                limit = std::min<uint64_t>(limit, room);
+            }
+            if (error == 0 && limit > 1 &&
+                roll(config_.short_write_probability)) {
+                limit = std::uniform_int_distribution<size_t>(
+                  1, limit - 1)(rng_);
+            }
+        }
+    }
+
+    if (spike) {
+        latency_spikes_.fetch_add(1, std::memory_order_relaxed);
+        std::this_thread::sleep_for(config_.latency);
+    }
+
+    switch (error) {
+        case ENOSPC:
+            enospc_.fetch_add(1, std::memory_order_relaxed);
+            break;
+        case EINTR:
+            eintr_.fetch_add(1, std::memory_order_relaxed);
+            break;
+        case EAGAIN:
+            eagain_.fetch_add(1, std::memory_order_relaxed);
+            break;
+        default:
+            break;
+    }
+    if (error != 0) {
+        errno = error;
+        return -1;
+    }
+
+    ssize_t written;
+    if (limit < total) {
+        short_writes_.fetch_add(1, std::memory_order_relaxed);
+
+        std::vector<struct iovec> truncated;
+        for (int i = 0; i < iovcnt && limit > 0; ++i) {
+            struct iovec part = iov[i];
+            part.iov_len = std::min(part.iov_len, limit);
+            limit -= part.iov_len;
+            truncated.push_back(part);
+        }
+        written = ::pwritev(
+          fd, truncated.data(), static_cast<int>(truncated.size()), offset);
+    } else {
+        written = ::pwritev(fd, iov, iovcnt, offset);
+    }
+
+    if (written > 0) {
+        std::scoped_lock lock(mutex_);
+        bytes_written_ += static_cast<uint64_t>(written);
+    }
+    return written;
+}
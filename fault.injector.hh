@@ -0,0 +1,104 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <random>
+
+#include <sys/types.h>
+#include <sys/uio.h>
+
+namespace zarr {
+/**
+ * @brief Injects the failures a real disk can produce into file writes:
+ * short writes, EINTR, EAGAIN, ENOSPC and latency spikes, each with its own
+ * probability.
+ *
+ * VectorizedFileWriter and FileSink issue their writes through pwritev()
+ * and pwrite() here, which pass straight through to the system calls unless
+ * an injector is installed. A capacity, if set, stands in for a filling
+ * disk: writes are cut short at the capacity and then fail with ENOSPC
+ * until set_capacity() frees up space.
+ *
+ * For testing error handling only. POSIX only.
+ */
+class FaultInjector
+{
+  public:
+    struct Config
+    {
+        double short_write_probability = 0;
+        double eintr_probability = 0;
+        double eagain_probability = 0;
+        double enospc_probability = 0;
+        double latency_probability = 0;
+        std::chrono::microseconds latency{ 50000 };
+        uint64_t capacity_bytes = 0; // 0 for unlimited
+        uint64_t seed = 1;
+    };
+
+    struct Stats
+    {
+        uint64_t calls = 0;
+        uint64_t short_writes = 0;
+        uint64_t eintr = 0;
+        uint64_t eagain = 0;
+        uint64_t enospc = 0;
+        uint64_t latency_spikes = 0;
+        uint64_t bytes_written = 0;
+
+        uint64_t faults() const {
+            return short_writes + eintr + eagain + enospc + latency_spikes;
+        }
+    };
+
+    explicit FaultInjector(const Config& config);
+
+    /// Uninstalls the injector if it is installed.
+    ~FaultInjector();
+
+    FaultInjector(const FaultInjector&) = delete;
+    FaultInjector& operator=(const FaultInjector&) = delete;
+
+    /// Route every write through @p injector, or stop injecting if null.
+    static void install(FaultInjector* injector);
+    static FaultInjector* installed();
+
+    /// Allow @p bytes in total to be written (0 for unlimited), e.g., to
+    /// let writers recover from ENOSPC.
+    void set_capacity(uint64_t bytes);
+
+    Stats stats() const;
+
+    /// The system calls, with faults from the installed injector, if any.
+    static ssize_t pwritev(int fd,
+                           const struct iovec* iov,
+                           int iovcnt,
+                           off_t offset);
+    static ssize_t pwrite(int fd,
+                          const void* buf,
+                          size_t nbytes,
+                          off_t offset);
+
+  private:
+    const Config config_;
+
+    mutable std::mutex mutex_;
+    std::mt19937_64 rng_;
+    uint64_t capacity_bytes_;
+    uint64_t bytes_written_;
+
+    std::atomic<uint64_t> calls_;
+    std::atomic<uint64_t> short_writes_;
+    std::atomic<uint64_t> eintr_;
+    std::atomic<uint64_t> eagain_;
+    std::atomic<uint64_t> enospc_;
+    std::atomic<uint64_t> latency_spikes_;
+
+    ssize_t pwritev_(int fd,
+                     const struct iovec* iov,
+                     int iovcnt,
+                     off_t offset);
+};
+} // namespace zarr
@@ -32,6 +32,14 @@ zarr::FileSink::write(size_t offset, const std::vector<uint8_t> &data) {
     return seek_and_write(&handle_, offset, data);
 }
 
+void
+zarr::FileSink::reopen(const std::string& filename) {
+    void *handle = nullptr;
+    init_handle(&handle, filename);
+    destroy_handle(&handle_);
+    handle_ = handle;
+}
+
 bool
 zarr::FileSink::flush_() {
     return flush_file(&handle_);
@@ -13,6 +13,11 @@ namespace zarr {
 
         bool write(size_t offset, const std::vector<uint8_t> &data);
 
+        /// Retarget the sink to @p filename. The new file is opened before
+        /// the current one is closed, so if opening throws, the sink still
+        /// targets the old file.
+        void reopen(const std::string& filename);
+
     protected:
         bool flush_();
 
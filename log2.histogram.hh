@@ -0,0 +1,82 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+
+namespace zarr {
+/**
+ * @brief Lock-free histogram with power-of-two buckets.
+ *
+ * Bucket 0 counts zeros and bucket i > 0 counts values in [2^(i-1), 2^i).
+ * Any thread may record; readers see a consistent-enough snapshot for
+ * reporting. Percentiles are resolved to the upper bound of their bucket.
+ */
+class Log2Histogram
+{
+  public:
+    static constexpr size_t nbuckets = 65;
+
+    void record(uint64_t value) {
+        const auto bucket = static_cast<size_t>(std::bit_width(value));
+        buckets_[bucket].fetch_add(1, std::memory_order_relaxed);
+        count_.fetch_add(1, std::memory_order_relaxed);
+        sum_.fetch_add(value, std::memory_order_relaxed);
+
+        uint64_t max = max_.load(std::memory_order_relaxed);
+        while (value > max && !max_.compare_exchange_weak(
+                                max, value, std::memory_order_relaxed)) {
+        }
+    }
+
+    uint64_t count() const { return count_.load(std::memory_order_relaxed); }
+    uint64_t max() const { return max_.load(std::memory_order_relaxed); }
+
+    double mean() const {
+        const auto n = count();
+        const auto sum = sum_.load(std::memory_order_relaxed);
+        return n ? static_cast<double>(sum) / static_cast<double>(n) : 0.0;
+    }
+
+    uint64_t bucket(size_t i) const {
+        return buckets_[i].load(std::memory_order_relaxed);
+    }
+
+    /// Upper bound of the bucket holding the @p p-th percentile, 0 <= p <= 1.
+    uint64_t percentile(double p) const {
+        const auto n = count();
+        if (n == 0) {
+            return 0;
+        }
+
+        const auto rank = static_cast<uint64_t>(p * static_cast<double>(n - 1));
+        uint64_t seen = 0;
+        for (size_t i = 0; i < nbuckets; ++i) {
+            seen += bucket(i);
+            if (seen > rank) {
+                const uint64_t upper =
+                  i == 0 ? 0 : (i >= 64 ? ~0ULL : (1ULL << i) - 1);
+                return upper < max() ? upper : max();
+            }
+        }
+        return max();
+    }
+
+    void reset() {
+        for (auto& b : buckets_) {
+            b.store(0, std::memory_order_relaxed);
+        }
+        count_.store(0, std::memory_order_relaxed);
+        sum_.store(0, std::memory_order_relaxed);
+        max_.store(0, std::memory_order_relaxed);
+    }
+
+  private:
+    std::array<std::atomic<uint64_t>, nbuckets> buckets_{};
+    std::atomic<uint64_t> count_{ 0 };
+    std::atomic<uint64_t> sum_{ 0 };
+    std::atomic<uint64_t> max_{ 0 };
+};
+} // namespace zarr
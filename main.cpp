@@ -1,3 +1,4 @@
+#include "benchmarks/benchmarks.hh"
 #include "file.sink.hh"
 #include "vectorized.file.writer.hh"
 
@@ -63,7 +64,7 @@ void kernel(size_t nchunks, size_t &consolidated, size_t &vectorized) {
     vectorized = std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
 }
 
-int main() {
+int single_shard() {
     const size_t bytes_per_chunk = 128 * 128 * 128; // 2 MiB per chunk
     size_t consolidated_time, vectorized_time;
 
@@ -98,4 +99,49 @@ int main() {
     }
 
     return 0;
+}
+
+int main(int argc, char *argv[]) {
+    const std::vector<std::pair<std::string, std::function<int()>>> benchmarks = {
+            {"single-shard", single_shard},
+            {"shard-order", bench::shard_order},
+            {"shard-alignment", bench::shard_alignment},
+            {"dtype-convert", bench::dtype_convert},
+            {"delta-filter", bench::delta_filter},
+            {"transpose", bench::transpose},
+            {"mpsc-queue", bench::mpsc_queue},
+            {"buffer-pool", bench::buffer_pool},
+            {"adaptive-batch", bench::adaptive_batch},
+            {"numa-placement", bench::numa_placement},
+            {"rate-limit", bench::rate_limit},
+            {"priority-classes", bench::priority_classes},
+            {"stripe-scaling", bench::stripe_scaling},
+            {"zip-store", bench::zip_store},
+            {"cancellation", bench::cancellation},
+            {"open-close", bench::open_close},
+            {"metadata-batch", bench::metadata_batch},
+            {"mixed-read-write", bench::mixed_read_write},
+            {"write-order", bench::write_order},
+#ifndef _WIN32
+            {"shm-ring", bench::shm_ring},
+            {"object-store", bench::object_store},
+            {"fault-injection", bench::fault_injection},
+            {"memfd-staging", bench::memfd_staging},
+            {"multiprocess-shards", bench::multiprocess_shards},
+#endif
+    };
+
+    const std::string name = argc > 1 ? argv[1] : "single-shard";
+    for (const auto &[benchmark, run]: benchmarks) {
+        if (benchmark == name) {
+            return run();
+        }
+    }
+
+    std::cerr << "Unknown benchmark '" << name << "'. Available benchmarks:";
+    for (const auto &[benchmark, run]: benchmarks) {
+        std::cerr << " " << benchmark;
+    }
+    std::cerr << std::endl;
+    return 1;
 }
\ No newline at end of file
@@ -0,0 +1,257 @@
+#include "metadata.writer.hh"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <filesystem>
+#include <iostream>
+#include <set>
+#include <stdexcept>
+
+namespace fs = std::filesystem;
+
+namespace {
+const std::string node_metadata = "zarr.json";
+
+// Write the whole of @p data to a new or truncated @p path.
+bool
+write_file(const std::string& path, const std::string& data, bool sync) {
+#ifdef _WIN32
+    HANDLE handle = CreateFileA(path.c_str(),
+                                GENERIC_WRITE,
+                                0,
+                                nullptr,
+                                CREATE_ALWAYS,
+                                FILE_ATTRIBUTE_NORMAL,
+                                nullptr);
+    if (handle == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+    DWORD written = 0;
+    bool ok = WriteFile(handle,
+                        data.data(),
+                        static_cast<DWORD>(data.size()),
+                        &written,
+                        nullptr) &&
+              written == data.size();
+    if (ok && sync) {
+        ok = FlushFileBuffers(handle);
+    }
+    return CloseHandle(handle) && ok;
+#else
+    const int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC,
+                        0644);
+    if (fd < 0) {
+        return false;
+    }
+    size_t offset = 0;
+    bool ok = true;
+    while (ok && offset < data.size()) {
+        const auto n = write(fd, data.data() + offset, data.size() - offset);
+        if (n < 0) {
+            ok = errno == EINTR;
+        } else {
+            offset += static_cast<size_t>(n);
+        }
+    }
+    if (ok && sync) {
+        ok = fsync(fd) == 0;
+    }
+    return close(fd) == 0 && ok;
+#endif
+}
+
+// Make a directory's new entries durable. Windows has no equivalent: the
+// file system journals them with the files themselves.
+bool
+sync_directory(const std::string& path) {
+#ifdef _WIN32
+    return true;
+#else
+    const int fd = open(path.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+    const bool ok = fsync(fd) == 0;
+    close(fd);
+    return ok;
+#endif
+}
+
+std::string
+quoted(const std::string& s) {
+    std::string out = "\"";
+    for (const char c : s) {
+        if (c == '"' || c == '\\') {
+            out += '\\';
+        }
+        out += c;
+    }
+    return out + "\"";
+}
+} // namespace
+
+zarr::MetadataWriter::MetadataWriter(const std::string& root,
+                                     size_t nthreads,
+                                     bool sync)
+  : root_(root)
+  , nthreads_(std::max<size_t>(nthreads, 1))
+  , sync_(sync) {
+    if (root_.empty()) {
+        throw std::invalid_argument("Metadata root must not be empty");
+    }
+}
+
+void
+zarr::MetadataWriter::add(const std::string& key, std::string document) {
+    for (auto& [pending_key, pending_document] : pending_) {
+        if (pending_key == key) {
+            pending_document = std::move(document);
+            return;
+        }
+    }
+    pending_.emplace_back(key, std::move(document));
+}
+
+bool
+zarr::MetadataWriter::flush(bool consolidate) {
+    // the queued root stays as it is, so a failed flush can be retried
+    size_t root_index = pending_.size();
+    std::string consolidated;
+    if (consolidate && !consolidate_(root_index, consolidated)) {
+        return false;
+    }
+    if (pending_.empty()) {
+        return true;
+    }
+
+    // create each directory once, up front, rather than from every thread
+    std::set<std::string> directories;
+    for (const auto& [key, document] : pending_) {
+        directories.insert(
+          (fs::path(root_) / key).parent_path().lexically_normal().string());
+    }
+    for (const auto& directory : directories) {
+        std::error_code ec;
+        fs::create_directories(directory, ec);
+        if (ec) {
+            std::cerr << "Failed to create directory '" << directory
+                      << "': " << ec.message() << std::endl;
+            return false;
+        }
+    }
+
+    // small files are dominated by the system calls around the write, so
+    // issue them all at once and let the file system overlap them
+    const auto nfiles = static_cast<long long>(pending_.size());
+    std::vector<char> written(pending_.size(), 0);
+    uint64_t failed = 0;
+    uint64_t bytes = 0;
+#pragma omp parallel for num_threads(nthreads_) schedule(dynamic)             \
+  reduction(+ : failed, bytes)
+    for (long long i = 0; i < nfiles; ++i) {
+        const auto& [key, queued] = pending_[i];
+        const auto& document =
+          static_cast<size_t>(i) == root_index ? consolidated : queued;
+        const auto path = (fs::path(root_) / key).string();
+        if (write_file(path, document, sync_)) {
+            written[i] = 1;
+            bytes += document.size();
+        } else {
+#pragma omp critical
+            std::cerr << "Failed to write metadata '" << path << "'"
+                      << std::endl;
+            ++failed;
+        }
+    }
+
+    stats_.files_written += nfiles - failed;
+    stats_.bytes_written += bytes;
+    stats_.failed_writes += failed;
+    if (sync_) {
+        stats_.file_syncs += nfiles - failed;
+        for (const auto& directory : directories) {
+            if (!sync_directory(directory)) {
+                std::cerr << "Failed to sync directory '" << directory << "'"
+                          << std::endl;
+                ++failed;
+            }
+            ++stats_.directory_syncs;
+        }
+    }
+
+    if (failed > 0 && consolidate) {
+        // the consolidated root must list every node, so retry them all
+        return false;
+    }
+
+    // keep what failed to write queued, so the caller can retry it
+    size_t kept = 0;
+    for (size_t i = 0; i < pending_.size(); ++i) {
+        if (!written[i]) {
+            pending_[kept++] = std::move(pending_[i]);
+        }
+    }
+    pending_.resize(kept);
+    return failed == 0;
+}
+
+// Inline the queued nodes' documents into a copy of the queued root
+// document, @p root_index in pending_, as @p consolidated.
+bool
+zarr::MetadataWriter::consolidate_(size_t& root_index,
+                                   std::string& consolidated) const {
+    const std::string* root_document = nullptr;
+    std::string metadata;
+    for (size_t i = 0; i < pending_.size(); ++i) {
+        const auto& [key, document] = pending_[i];
+        const fs::path path(key);
+        if (path.filename() != node_metadata) {
+            continue; // e.g. attributes kept in a separate file
+        }
+        const auto node = path.parent_path().generic_string();
+        if (node.empty()) {
+            root_document = &document;
+            root_index = i;
+            continue;
+        }
+        if (!metadata.empty()) {
+            metadata += ',';
+        }
+        metadata += quoted(node);
+        metadata += ':';
+        metadata += document;
+    }
+
+    // the consolidated metadata can only list what is queued, and a root
+    // made up here would replace one on disk, attributes and all
+    if (root_document == nullptr) {
+        std::cerr << "Root metadata is not queued; not consolidating"
+                  << std::endl;
+        return false;
+    }
+
+    // inline the nodes' documents as the root's last member
+    consolidated = *root_document;
+    const auto end = consolidated.find_last_of('}');
+    if (end == std::string::npos || end == 0) {
+        std::cerr << "Root metadata is not a JSON object; not consolidating"
+                  << std::endl;
+        return false;
+    }
+    const auto last = consolidated.find_last_not_of(" \t\r\n", end - 1);
+    const bool has_members =
+      last != std::string::npos && consolidated[last] != '{';
+    consolidated.insert(end,
+                        std::string(has_members ? "," : "") +
+                          R"("consolidated_metadata":{"kind":"inline",)"
+                          R"("must_understand":false,"metadata":{)" +
+                          metadata + "}}");
+    return true;
+}
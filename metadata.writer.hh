@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace zarr {
+/**
+ * @brief Writes a hierarchy's small metadata files (zarr.json, attributes)
+ * in batches rather than one open/write/fsync/close round trip at a time.
+ *
+ * Documents are queued with add() and written by flush() in one round:
+ * directories are created once each, the files are written in parallel by
+ * a pool of threads, each opening, writing, syncing and closing its own
+ * files, and then each parent directory is synced once, so that the new
+ * entries are durable too.
+ *
+ * flush() can also consolidate the hierarchy's metadata into the root
+ * group's zarr.json, inline, as "consolidated_metadata", so that readers
+ * open the hierarchy with a single read.
+ */
+class MetadataWriter
+{
+  public:
+    struct Stats
+    {
+        uint64_t files_written = 0;
+        uint64_t bytes_written = 0;
+        uint64_t file_syncs = 0;
+        uint64_t directory_syncs = 0;
+        uint64_t failed_writes = 0;
+    };
+
+    /// Files are written under @p root by up to @p nthreads threads, and
+    /// synced to storage if @p sync.
+    explicit MetadataWriter(const std::string& root,
+                            size_t nthreads = 8,
+                            bool sync = true);
+
+    /// Queue @p document to be written to @p key, a '/'-separated path
+    /// under the root, e.g. "group/array/zarr.json". A later document for
+    /// the same key replaces it.
+    void add(const std::string& key, std::string document);
+
+    /// Write everything queued. With @p consolidate, every queued
+    /// zarr.json document is also inlined into the queued root zarr.json,
+    /// which replaces any on disk; consolidate only in a flush that holds
+    /// the whole hierarchy. Without a queued root, nothing is written and
+    /// the documents stay queued, rather than replacing the root on disk
+    /// with one that drops its attributes and earlier nodes. Returns false
+    /// if any file failed to write or consolidation was refused; documents
+    /// that failed to write stay queued for another flush, and with
+    /// @p consolidate, all of them do.
+    bool flush(bool consolidate = false);
+
+    size_t pending() const { return pending_.size(); }
+    const Stats& stats() const { return stats_; }
+
+  private:
+    const std::string root_;
+    const size_t nthreads_;
+    const bool sync_;
+    std::vector<std::pair<std::string, std::string>> pending_;
+    Stats stats_;
+
+    bool consolidate_(size_t& root_index, std::string& consolidated) const;
+};
+} // namespace zarr
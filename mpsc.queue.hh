@@ -0,0 +1,96 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <utility>
+
+namespace zarr {
+/**
+ * @brief Bounded lock-free multi-producer, single-consumer queue.
+ *
+ * Each slot carries a sequence number (D. Vyukov's bounded queue): producers
+ * claim a slot with a CAS on the tail and publish it by bumping the slot's
+ * sequence; the single consumer owns the head outright. Neither side takes a
+ * lock, and a full or empty queue is reported rather than waited on.
+ */
+template<typename T>
+class MpscQueue
+{
+  public:
+    explicit MpscQueue(size_t capacity)
+      : capacity_(capacity)
+      , mask_(capacity - 1)
+      , slots_(new Slot[capacity])
+      , head_(0)
+      , tail_(0) {
+        if (capacity < 2 || (capacity & (capacity - 1)) != 0) {
+            throw std::invalid_argument(
+              "Queue capacity must be a power of 2 greater than 1");
+        }
+        for (size_t i = 0; i < capacity; ++i) {
+            slots_[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    MpscQueue(const MpscQueue&) = delete;
+    MpscQueue& operator=(const MpscQueue&) = delete;
+
+    /// Any thread. Returns false, leaving @p value untouched, when full.
+    bool try_push(T&& value) {
+        size_t pos = tail_.load(std::memory_order_relaxed);
+        while (true) {
+            Slot& slot = slots_[pos & mask_];
+            const size_t seq = slot.sequence.load(std::memory_order_acquire);
+            const auto diff =
+              static_cast<std::ptrdiff_t>(seq) - static_cast<std::ptrdiff_t>(pos);
+
+            if (diff == 0) {
+                if (tail_.compare_exchange_weak(
+                      pos, pos + 1, std::memory_order_relaxed)) {
+                    slot.value = std::move(value);
+                    slot.sequence.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false; // the consumer has not freed this slot yet
+            } else {
+                pos = tail_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    /// Consumer thread only. Returns false when empty.
+    bool try_pop(T& value) {
+        Slot& slot = slots_[head_ & mask_];
+        const size_t seq = slot.sequence.load(std::memory_order_acquire);
+        if (seq != head_ + 1) {
+            return false; // empty, or the producer is still writing the slot
+        }
+
+        value = std::move(slot.value);
+        slot.sequence.store(head_ + capacity_, std::memory_order_release);
+        ++head_;
+        return true;
+    }
+
+    size_t capacity() const { return capacity_; }
+
+  private:
+    struct Slot
+    {
+        std::atomic<size_t> sequence;
+        T value;
+    };
+
+    const size_t capacity_;
+    const size_t mask_;
+    std::unique_ptr<Slot[]> slots_;
+
+    // keep the consumer's and producers' cursors on separate cache lines
+    alignas(64) size_t head_;
+    alignas(64) std::atomic<size_t> tail_;
+};
+} // namespace zarr
@@ -0,0 +1,165 @@
+#include "numa.topology.hh"
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#include <sys/stat.h>
+#include <sys/sysmacros.h>
+#endif
+
+namespace fs = std::filesystem;
+
+namespace {
+// Parse a sysfs CPU list such as "0-3,8-11".
+std::vector<int>
+parse_cpu_list(const std::string& list) {
+    std::vector<int> cpus;
+    std::stringstream ss(list);
+    std::string range;
+    while (std::getline(ss, range, ',')) {
+        if (range.empty() || range == "\n") {
+            continue;
+        }
+        const auto dash = range.find('-');
+        const int first = std::stoi(range.substr(0, dash));
+        const int last =
+          dash == std::string::npos ? first : std::stoi(range.substr(dash + 1));
+        for (int cpu = first; cpu <= last; ++cpu) {
+            cpus.push_back(cpu);
+        }
+    }
+    return cpus;
+}
+
+std::vector<int>
+all_cpus() {
+    std::vector<int> cpus(std::max(1u, std::thread::hardware_concurrency()));
+    for (size_t i = 0; i < cpus.size(); ++i) {
+        cpus[i] = static_cast<int>(i);
+    }
+    return cpus;
+}
+
+#ifdef __linux__
+bool
+pin_to_node(pthread_t thread, int node) {
+    for (const auto& numa_node : zarr::numa_nodes()) {
+        if (numa_node.id != node) {
+            continue;
+        }
+
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        for (const int cpu : numa_node.cpus) {
+            if (cpu < CPU_SETSIZE) {
+                CPU_SET(cpu, &set);
+            }
+        }
+        return pthread_setaffinity_np(thread, sizeof(set), &set) == 0;
+    }
+    return false;
+}
+#endif
+} // namespace
+
+std::vector<zarr::NumaNode>
+zarr::numa_nodes() {
+    std::vector<NumaNode> nodes;
+
+#ifdef __linux__
+    std::error_code ec;
+    for (const auto& entry :
+         fs::directory_iterator("/sys/devices/system/node", ec)) {
+        const auto name = entry.path().filename().string();
+        if (name.rfind("node", 0) != 0 ||
+            name.find_first_not_of("0123456789", 4) != std::string::npos) {
+            continue;
+        }
+
+        std::ifstream cpulist(entry.path() / "cpulist");
+        std::string list;
+        std::getline(cpulist, list);
+
+        NumaNode node{ std::stoi(name.substr(4)), parse_cpu_list(list) };
+        if (!node.cpus.empty()) {
+            nodes.push_back(std::move(node));
+        }
+    }
+    std::sort(nodes.begin(), nodes.end(), [](const auto& a, const auto& b) {
+        return a.id < b.id;
+    });
+#endif
+
+    if (nodes.empty()) {
+        nodes.push_back({ 0, all_cpus() });
+    }
+    return nodes;
+}
+
+int
+zarr::current_numa_node() {
+#ifdef __linux__
+    const int cpu = sched_getcpu();
+    for (const auto& node : numa_nodes()) {
+        if (std::find(node.cpus.begin(), node.cpus.end(), cpu) !=
+            node.cpus.end()) {
+            return node.id;
+        }
+    }
+#endif
+    return 0;
+}
+
+int
+zarr::numa_node_of_path(const std::string& path) {
+#ifdef __linux__
+    struct stat st;
+    if (stat(path.c_str(), &st) < 0) {
+        return -1;
+    }
+
+    // the block device's sysfs entry; its numa_node, or that of the nearest
+    // ancestor (the disk of a partition, the PCI device of a disk), says
+    // where the controller is attached
+    std::error_code ec;
+    auto device = fs::canonical("/sys/dev/block/" +
+                                  std::to_string(major(st.st_dev)) + ":" +
+                                  std::to_string(minor(st.st_dev)),
+                                ec);
+    if (ec) {
+        return -1;
+    }
+
+    for (; device.has_relative_path(); device = device.parent_path()) {
+        std::ifstream numa_node(device / "numa_node");
+        int node = -1;
+        if (numa_node >> node) {
+            return node;
+        }
+    }
+#endif
+    return -1;
+}
+
+bool
+zarr::pin_current_thread_to_numa_node(int node) {
+#ifdef __linux__
+    return pin_to_node(pthread_self(), node);
+#else
+    return false;
+#endif
+}
+
+bool
+zarr::pin_thread_to_numa_node(std::thread& thread, int node) {
+#ifdef __linux__
+    return thread.joinable() && pin_to_node(thread.native_handle(), node);
+#else
+    return false;
+#endif
+}
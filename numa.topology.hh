@@ -0,0 +1,37 @@
+#pragma once
+
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace zarr {
+struct NumaNode
+{
+    int id;
+    std::vector<int> cpus;
+};
+
+/// NUMA nodes that have CPUs, in id order. Where the topology is not
+/// available (non-Linux, or no sysfs), a single node 0 holding every CPU.
+std::vector<NumaNode>
+numa_nodes();
+
+/// Node of the CPU the calling thread is running on, or 0 if unknown.
+int
+current_numa_node();
+
+/// Node the block device holding @p path is attached to, or -1 if unknown
+/// (including devices that report no affinity).
+int
+numa_node_of_path(const std::string& path);
+
+/// Restrict the calling thread to the CPUs of @p node. Returns false if
+/// thread affinity is unsupported or @p node does not exist. Memory the
+/// thread touches first is then placed on @p node by the kernel.
+bool
+pin_current_thread_to_numa_node(int node);
+
+/// As above, for @p thread.
+bool
+pin_thread_to_numa_node(std::thread& thread, int node);
+} // namespace zarr
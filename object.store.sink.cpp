@@ -0,0 +1,549 @@
+#include "object.store.sink.hh"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+namespace {
+/// Percent-encode @p value for a URL, keeping '/' if @p keep_slash.
+std::string
+url_encode(const std::string& value, bool keep_slash) {
+    static const char* hex = "0123456789ABCDEF";
+    std::string encoded;
+    for (const unsigned char c : value) {
+        if (isalnum(c) || c == '-' || c == '_' || c == '.' || c == '~' ||
+            (keep_slash && c == '/')) {
+            encoded += static_cast<char>(c);
+        } else {
+            encoded += '%';
+            encoded += hex[c >> 4];
+            encoded += hex[c & 0xf];
+        }
+    }
+    return encoded;
+}
+
+std::string
+xml_value(const std::string& xml, const std::string& tag) {
+    const auto open = "<" + tag + ">";
+    const auto begin = xml.find(open);
+    if (begin == std::string::npos) {
+        return {};
+    }
+    const auto end = xml.find("</" + tag + ">", begin);
+    if (end == std::string::npos) {
+        return {};
+    }
+    return xml.substr(begin + open.size(), end - begin - open.size());
+}
+
+/**
+ * @brief Minimal HTTP/1.1 client over one keep-alive connection: requests
+ * with a Content-Length body, responses with a Content-Length body (no
+ * chunked transfer encoding).
+ */
+class HttpConnection
+{
+  public:
+    struct Response
+    {
+        int status = 0;
+        std::string etag;
+        std::string body;
+    };
+
+    HttpConnection(const std::string& host, uint16_t port)
+      : host_(host)
+      , port_(port)
+      , fd_(-1) {
+    }
+
+    ~HttpConnection() { close_(); }
+
+    HttpConnection(const HttpConnection&) = delete;
+    HttpConnection& operator=(const HttpConnection&) = delete;
+
+    /// Send one request. An idempotent request is retried once on a fresh
+    /// connection, in case the server closed the idle one mid-request; a
+    /// POST is not, since the server may have acted on it already.
+    bool request(const std::string& method,
+                 const std::string& target,
+                 std::span<const uint8_t> body,
+                 Response& response) {
+        const int attempts = method == "POST" ? 1 : 2;
+        for (int attempt = 0; attempt < attempts; ++attempt) {
+            if (fd_ >= 0 && closed_by_peer_()) {
+                close_(); // nothing sent yet, so safe for any method
+            }
+            if (fd_ < 0 && !connect_()) {
+                return false;
+            }
+            if (send_(method, target, body) && receive_(response)) {
+                return true;
+            }
+            close_();
+        }
+        return false;
+    }
+
+  private:
+    const std::string host_;
+    const uint16_t port_;
+    int fd_;
+    std::string received_; // bytes read past the previous response
+
+    bool connect_() {
+        addrinfo hints{};
+        hints.ai_family = AF_UNSPEC;
+        hints.ai_socktype = SOCK_STREAM;
+
+        addrinfo* addresses = nullptr;
+        if (getaddrinfo(host_.c_str(),
+                        std::to_string(port_).c_str(),
+                        &hints,
+                        &addresses) != 0) {
+            return false;
+        }
+
+        for (auto* address = addresses; address != nullptr;
+             address = address->ai_next) {
+            fd_ = socket(
+              address->ai_family, address->ai_socktype, address->ai_protocol);
+            if (fd_ < 0) {
+                continue;
+            }
+            if (connect(fd_, address->ai_addr, address->ai_addrlen) == 0) {
+                break;
+            }
+            close_();
+        }
+        freeaddrinfo(addresses);
+
+        if (fd_ < 0) {
+            return false;
+        }
+        const int one = 1;
+        setsockopt(fd_, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        received_.clear();
+        return true;
+    }
+
+    // Whether the server has closed the idle connection, e.g. on its
+    // keep-alive timeout.
+    bool closed_by_peer_() {
+        char c;
+        const auto n = recv(fd_, &c, 1, MSG_PEEK | MSG_DONTWAIT);
+        return n == 0 || (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK &&
+                          errno != EINTR);
+    }
+
+    void close_() {
+        if (fd_ >= 0) {
+            close(fd_);
+            fd_ = -1;
+        }
+    }
+
+    // header and body go out together with one gather write, without
+    // copying the body
+    bool send_(const std::string& method,
+               const std::string& target,
+               std::span<const uint8_t> body) {
+        std::stringstream ss;
+        ss << method << " " << target << " HTTP/1.1\r\n"
+           << "Host: " << host_ << ":" << port_ << "\r\n"
+           << "Content-Length: " << body.size() << "\r\n"
+           << "Connection: keep-alive\r\n\r\n";
+        const auto header = ss.str();
+
+        iovec iov[2];
+        iov[0].iov_base = const_cast<char*>(header.data());
+        iov[0].iov_len = header.size();
+        iov[1].iov_base = const_cast<uint8_t*>(body.data());
+        iov[1].iov_len = body.size();
+
+        size_t first = 0;
+        while (first < 2) {
+            msghdr msg{};
+            msg.msg_iov = iov + first;
+            msg.msg_iovlen = 2 - first;
+            auto sent = sendmsg(fd_, &msg, MSG_NOSIGNAL);
+            if (sent < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                return false;
+            }
+
+            while (first < 2 &&
+                   static_cast<size_t>(sent) >= iov[first].iov_len) {
+                sent -= static_cast<ssize_t>(iov[first].iov_len);
+                ++first;
+            }
+            if (first < 2) {
+                iov[first].iov_base =
+                  static_cast<uint8_t*>(iov[first].iov_base) + sent;
+                iov[first].iov_len -= static_cast<size_t>(sent);
+            }
+        }
+        return true;
+    }
+
+    bool read_more_() {
+        char buffer[64 * 1024];
+        while (true) {
+            const auto n = recv(fd_, buffer, sizeof(buffer), 0);
+            if (n > 0) {
+                received_.append(buffer, static_cast<size_t>(n));
+                return true;
+            }
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+    }
+
+    bool receive_(Response& response) {
+        size_t header_end;
+        while ((header_end = received_.find("\r\n\r\n")) == std::string::npos) {
+            if (!read_more_()) {
+                return false;
+            }
+        }
+
+        std::stringstream header(received_.substr(0, header_end));
+        received_.erase(0, header_end + 4);
+
+        std::string line;
+        std::getline(header, line);
+        std::stringstream status_line(line);
+        std::string version;
+        response = {};
+        if (!(status_line >> version >> response.status)) {
+            return false;
+        }
+
+        size_t content_length = 0;
+        bool keep_alive = true;
+        while (std::getline(header, line)) {
+            if (!line.empty() && line.back() == '\r') {
+                line.pop_back();
+            }
+            const auto colon = line.find(':');
+            if (colon == std::string::npos) {
+                continue;
+            }
+            std::string name = line.substr(0, colon);
+            std::transform(name.begin(), name.end(), name.begin(), ::tolower);
+            const auto value_begin = line.find_first_not_of(' ', colon + 1);
+            const auto value = value_begin == std::string::npos
+                                 ? std::string()
+                                 : line.substr(value_begin);
+
+            if (name == "content-length") {
+                content_length = std::stoull(value);
+            } else if (name == "etag") {
+                response.etag = value;
+            } else if (name == "connection" && value == "close") {
+                keep_alive = false;
+            }
+        }
+
+        while (received_.size() < content_length) {
+            if (!read_more_()) {
+                return false;
+            }
+        }
+        response.body = received_.substr(0, content_length);
+        received_.erase(0, content_length);
+
+        if (!keep_alive) {
+            close_();
+        }
+        return true;
+    }
+};
+
+bool
+counted_request(HttpConnection& connection,
+                const std::string& method,
+                const std::string& target,
+                std::span<const uint8_t> body,
+                HttpConnection::Response& response,
+                std::atomic<uint64_t>& requests,
+                std::atomic<uint64_t>& failed_requests) {
+    requests.fetch_add(1, std::memory_order_relaxed);
+    if (connection.request(method, target, body, response) &&
+        response.status / 100 == 2) {
+        return true;
+    }
+
+    failed_requests.fetch_add(1, std::memory_order_relaxed);
+    std::cerr << method << " " << target << " failed";
+    if (response.status != 0) {
+        std::cerr << " with status " << response.status;
+    }
+    std::cerr << std::endl;
+    return false;
+}
+} // namespace
+
+zarr::ObjectStoreSink::ObjectStoreSink(const Config& config)
+  : config_(config)
+  , object_path_("/" + url_encode(config.bucket, false) + "/" +
+                 url_encode(config.key, true))
+  , next_offset_(0)
+  , next_part_(1)
+  , finalized_(false)
+  , in_flight_(0)
+  , stopping_(false)
+  , failed_(false)
+  , parts_uploaded_(0)
+  , bytes_uploaded_(0)
+  , requests_(0)
+  , failed_requests_(0) {
+    if (config.bucket.empty() || config.key.empty()) {
+        throw std::invalid_argument("Object store sink needs a bucket and key");
+    }
+    if (config.part_size == 0 || config.max_concurrent_parts == 0) {
+        throw std::invalid_argument(
+          "Part size and concurrency must be nonzero");
+    }
+
+    HttpConnection connection(config_.host, config_.port);
+    HttpConnection::Response response;
+    if (!counted_request(connection,
+                         "POST",
+                         object_path_ + "?uploads",
+                         {},
+                         response,
+                         requests_,
+                         failed_requests_)) {
+        throw std::runtime_error("Failed to initiate upload of " +
+                                 object_path_);
+    }
+
+    upload_id_ = xml_value(response.body, "UploadId");
+    if (upload_id_.empty()) {
+        throw std::runtime_error("No upload id in response for " +
+                                 object_path_);
+    }
+
+    current_.reserve(config_.part_size);
+    for (size_t i = 0; i < config_.max_concurrent_parts; ++i) {
+        workers_.emplace_back([this] { run_(); });
+    }
+}
+
+zarr::ObjectStoreSink::~ObjectStoreSink() {
+    if (!finalized_) {
+        stop_workers_();
+        abort_();
+    }
+}
+
+bool
+zarr::ObjectStoreSink::write_vectors(
+  const std::vector<std::vector<uint8_t>>& buffers,
+  size_t offset) {
+    std::vector<std::span<const uint8_t>> spans(buffers.begin(), buffers.end());
+    return write_vectors(spans, offset);
+}
+
+bool
+zarr::ObjectStoreSink::write_vectors(
+  const std::vector<std::span<const uint8_t>>& buffers,
+  size_t offset) {
+    if (finalized_ || failed_.load(std::memory_order_acquire)) {
+        return false;
+    }
+    if (offset != next_offset_) {
+        std::cerr << "Object store writes must be sequential: expected offset "
+                  << next_offset_ << ", got " << offset << std::endl;
+        return false;
+    }
+
+    for (const auto& buffer : buffers) {
+        size_t copied = 0;
+        while (copied < buffer.size()) {
+            const auto n = std::min(buffer.size() - copied,
+                                    config_.part_size - current_.size());
+            current_.insert(current_.end(),
+                            buffer.begin() + copied,
+                            buffer.begin() + copied + n);
+            copied += n;
+
+            if (current_.size() == config_.part_size) {
+                enqueue_part_();
+            }
+        }
+        next_offset_ += buffer.size();
+    }
+
+    return !failed_.load(std::memory_order_acquire);
+}
+
+bool
+zarr::ObjectStoreSink::finalize() {
+    if (finalized_) {
+        return !failed_.load(std::memory_order_acquire);
+    }
+    finalized_ = true;
+
+    // a multipart upload needs at least one part, even an empty one
+    if (!current_.empty() || next_part_ == 1) {
+        enqueue_part_();
+    }
+    stop_workers_();
+
+    if (failed_.load(std::memory_order_acquire)) {
+        abort_();
+        return false;
+    }
+
+    std::stringstream ss;
+    ss << "<CompleteMultipartUpload>";
+    for (size_t i = 0; i < etags_.size(); ++i) {
+        ss << "<Part><PartNumber>" << i + 1 << "</PartNumber><ETag>"
+           << etags_[i] << "</ETag></Part>";
+    }
+    ss << "</CompleteMultipartUpload>";
+    const auto xml = ss.str();
+
+    HttpConnection connection(config_.host, config_.port);
+    HttpConnection::Response response;
+    const std::span<const uint8_t> body(
+      reinterpret_cast<const uint8_t*>(xml.data()), xml.size());
+    const bool ok = counted_request(connection,
+                                    "POST",
+                                    object_path_ + "?uploadId=" +
+                                      url_encode(upload_id_, false),
+                                    body,
+                                    response,
+                                    requests_,
+                                    failed_requests_);
+
+    // S3 can report a failed completion in the body of a 200 response
+    if (!ok || response.body.find("<Error>") != std::string::npos) {
+        failed_ = true;
+        abort_();
+        return false;
+    }
+    return true;
+}
+
+zarr::ObjectStoreSink::Stats
+zarr::ObjectStoreSink::stats() const {
+    Stats stats;
+    stats.parts_uploaded = parts_uploaded_.load(std::memory_order_relaxed);
+    stats.bytes_uploaded = bytes_uploaded_.load(std::memory_order_relaxed);
+    stats.requests = requests_.load(std::memory_order_relaxed);
+    stats.failed_requests = failed_requests_.load(std::memory_order_relaxed);
+    return stats;
+}
+
+void
+zarr::ObjectStoreSink::enqueue_part_() {
+    std::unique_lock lock(mutex_);
+    cv_.wait(lock, [this] {
+        return pending_.size() + in_flight_ < config_.max_concurrent_parts;
+    });
+
+    etags_.resize(next_part_);
+    pending_.push_back({ next_part_++, std::move(current_) });
+    cv_.notify_all();
+    lock.unlock();
+
+    current_ = {};
+    current_.reserve(config_.part_size);
+}
+
+void
+zarr::ObjectStoreSink::run_() {
+    HttpConnection connection(config_.host, config_.port);
+    const auto upload_query =
+      "&uploadId=" + url_encode(upload_id_, false);
+
+    while (true) {
+        Part part;
+        {
+            std::unique_lock lock(mutex_);
+            cv_.wait(lock, [this] { return stopping_ || !pending_.empty(); });
+            if (pending_.empty()) {
+                return; // stopping, and nothing left to upload
+            }
+            part = std::move(pending_.front());
+            pending_.pop_front();
+            ++in_flight_;
+        }
+
+        // skip the upload once any part has failed; the upload is aborted
+        bool ok = false;
+        HttpConnection::Response response;
+        if (!failed_.load(std::memory_order_acquire)) {
+            ok = counted_request(connection,
+                                 "PUT",
+                                 object_path_ + "?partNumber=" +
+                                   std::to_string(part.number) + upload_query,
+                                 part.data,
+                                 response,
+                                 requests_,
+                                 failed_requests_) &&
+                 !response.etag.empty();
+        }
+
+        if (ok) {
+            parts_uploaded_.fetch_add(1, std::memory_order_relaxed);
+            bytes_uploaded_.fetch_add(part.data.size(),
+                                      std::memory_order_relaxed);
+        } else {
+            failed_ = true;
+        }
+
+        std::scoped_lock lock(mutex_);
+        if (ok) {
+            etags_[part.number - 1] = response.etag;
+        }
+        --in_flight_;
+        cv_.notify_all();
+    }
+}
+
+void
+zarr::ObjectStoreSink::stop_workers_() {
+    {
+        std::scoped_lock lock(mutex_);
+        stopping_ = true;
+    }
+    cv_.notify_all();
+
+    for (auto& worker : workers_) {
+        if (worker.joinable()) {
+            worker.join();
+        }
+    }
+}
+
+void
+zarr::ObjectStoreSink::abort_() {
+    HttpConnection connection(config_.host, config_.port);
+    HttpConnection::Response response;
+    counted_request(connection,
+                    "DELETE",
+                    object_path_ + "?uploadId=" + url_encode(upload_id_, false),
+                    {},
+                    response,
+                    requests_,
+                    failed_requests_);
+}
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <span>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace zarr {
+/**
+ * @brief Streams a shard to an S3-compatible object store as a multipart
+ * upload, with the same write_vectors interface as VectorizedFileWriter.
+ *
+ * Object uploads are append-only, so writes must arrive in offset order.
+ * Chunk buffers are packed into parts of part_size bytes, and each full part
+ * is uploaded by one of max_concurrent_parts worker threads, each with its
+ * own keep-alive connection. finalize() uploads the last, possibly short,
+ * part and completes the upload; destroying an unfinalized sink aborts it.
+ *
+ * Speaks plain HTTP/1.1 without request signing, so it suits a local
+ * stand-in, an unauthenticated endpoint or a signing proxy. POSIX only.
+ */
+class ObjectStoreSink
+{
+  public:
+    struct Config
+    {
+        std::string host = "127.0.0.1";
+        uint16_t port = 9000;
+        std::string bucket;
+        std::string key;
+        size_t part_size = 8 << 20; // S3 requires >= 5 MiB but for the last
+        size_t max_concurrent_parts = 4;
+    };
+
+    struct Stats
+    {
+        uint64_t parts_uploaded = 0;
+        uint64_t bytes_uploaded = 0;
+        uint64_t requests = 0; // including initiate and complete
+        uint64_t failed_requests = 0;
+    };
+
+    /// Initiates the multipart upload; throws if the store refuses.
+    explicit ObjectStoreSink(const Config& config);
+    ~ObjectStoreSink();
+
+    ObjectStoreSink(const ObjectStoreSink&) = delete;
+    ObjectStoreSink& operator=(const ObjectStoreSink&) = delete;
+
+    /// Append @p buffers, which must start where the previous write ended.
+    /// Waits while max_concurrent_parts parts are already queued. Returns
+    /// false if @p offset is out of order or an earlier part failed.
+    bool write_vectors(const std::vector<std::vector<uint8_t>>& buffers,
+                       size_t offset);
+    bool write_vectors(const std::vector<std::span<const uint8_t>>& buffers,
+                       size_t offset);
+
+    /// Upload what is buffered and complete the upload. Returns false, and
+    /// aborts the upload, if any part failed.
+    bool finalize();
+
+    const std::string& upload_id() const { return upload_id_; }
+    Stats stats() const;
+
+  private:
+    struct Part
+    {
+        int number;
+        std::vector<uint8_t> data;
+    };
+
+    const Config config_;
+    const std::string object_path_; // "/bucket/key"
+    std::string upload_id_;
+
+    std::vector<uint8_t> current_; // part being filled
+    size_t next_offset_;
+    int next_part_;
+    bool finalized_;
+
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::deque<Part> pending_;
+    std::vector<std::string> etags_; // by part number - 1
+    size_t in_flight_;
+    bool stopping_;
+    std::atomic<bool> failed_;
+    std::vector<std::thread> workers_;
+
+    std::atomic<uint64_t> parts_uploaded_;
+    std::atomic<uint64_t> bytes_uploaded_;
+    std::atomic<uint64_t> requests_;
+    std::atomic<uint64_t> failed_requests_;
+
+    void enqueue_part_();
+    void run_();
+    void stop_workers_();
+    void abort_();
+};
+} // namespace zarr
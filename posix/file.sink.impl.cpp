@@ -1,5 +1,10 @@
+#include "fault.injector.hh"
+
+#include <algorithm>
+#include <chrono>
 #include <iostream>
 #include <string>
+#include <thread>
 #include <vector>
 
 #include <cstdint>
@@ -40,16 +45,31 @@ seek_and_write(void **handle, size_t offset, const std::vector<uint8_t> &data) {
     auto *cur = reinterpret_cast<const char *>(data.data());
     auto *end = cur + data.size();
 
+    // retry short writes until done; interrupted, refused and empty writes
+    // count as retries, which reset whenever a write makes progress
     int retries = 0;
-    const auto max_retries = 3;
+    const auto max_retries = 16;
+    const auto min_backoff = std::chrono::microseconds(100);
+    auto backoff = min_backoff;
     while (cur < end && retries < max_retries) {
         size_t remaining = end - cur;
-        ssize_t written = pwrite(*fd, cur, remaining, offset);
-        if (written < 0) {
+        ssize_t written =
+          zarr::FaultInjector::pwrite(*fd, cur, remaining, offset);
+        if (written < 0 && errno != EINTR && errno != EAGAIN) {
             const auto err = get_last_error_as_string();
             throw std::runtime_error("Failed to write to file: " + err);
         }
-        retries += (written == 0) ? 1 : 0;
+        if (written <= 0) {
+            if (written == 0 || errno == EAGAIN) {
+                std::this_thread::sleep_for(backoff);
+                backoff = std::min(2 * backoff,
+                                   std::chrono::microseconds(100000));
+            }
+            ++retries;
+            continue;
+        }
+        retries = 0;
+        backoff = min_backoff;
         offset += written;
         cur += written;
     }
@@ -0,0 +1,116 @@
+#include "rate.limiter.hh"
+
+#include <algorithm>
+#include <limits>
+#include <thread>
+
+std::chrono::nanoseconds
+zarr::RateLimiter::Bucket::take(double n) {
+    if (rate <= 0) {
+        return std::chrono::nanoseconds(0);
+    }
+
+    tokens -= n;
+    if (tokens >= 0) {
+        return std::chrono::nanoseconds(0);
+    }
+    return std::chrono::nanoseconds(
+      static_cast<int64_t>(-tokens / rate * 1e9));
+}
+
+zarr::RateLimiter::RateLimiter()
+  : RateLimiter(Limits{}) {
+}
+
+zarr::RateLimiter::RateLimiter(const Limits& limits)
+  : limited_(false)
+  , total_delay_us_(0) {
+    set_limits(limits);
+}
+
+zarr::RateLimiter&
+zarr::RateLimiter::global() {
+    static RateLimiter limiter;
+    return limiter;
+}
+
+void
+zarr::RateLimiter::set_limits(const Limits& limits) {
+    std::scoped_lock lock(mutex_);
+    limits_ = limits;
+
+    bytes_.rate = std::max(limits.bytes_per_second, 0.0);
+    bytes_.capacity =
+      static_cast<double>(std::max<size_t>(limits.burst_bytes, 1));
+    bytes_.tokens = bytes_.capacity;
+
+    ops_.rate = std::max(limits.ops_per_second, 0.0);
+    ops_.capacity = static_cast<double>(std::max<size_t>(limits.burst_ops, 1));
+    ops_.tokens = ops_.capacity;
+
+    last_refill_ = Clock::now();
+    limited_.store(bytes_.rate > 0 || ops_.rate > 0,
+                   std::memory_order_release);
+}
+
+zarr::RateLimiter::Limits
+zarr::RateLimiter::limits() const {
+    std::scoped_lock lock(mutex_);
+    return limits_;
+}
+
+size_t
+zarr::RateLimiter::slice_bytes() const {
+    // every write asks, so unlimited writers must not contend on the mutex
+    if (!limited()) {
+        return std::numeric_limits<size_t>::max();
+    }
+
+    std::scoped_lock lock(mutex_);
+    return bytes_.rate > 0 ? static_cast<size_t>(bytes_.capacity)
+                           : std::numeric_limits<size_t>::max();
+}
+
+std::chrono::nanoseconds
+zarr::RateLimiter::reserve(size_t nbytes, size_t nops) {
+    if (!limited()) {
+        return std::chrono::nanoseconds(0);
+    }
+
+    std::chrono::nanoseconds delay;
+    {
+        std::scoped_lock lock(mutex_);
+
+        const auto now = Clock::now();
+        const double elapsed =
+          std::chrono::duration<double>(now - last_refill_).count();
+        last_refill_ = now;
+        for (auto* bucket : { &bytes_, &ops_ }) {
+            bucket->tokens = std::min(
+              bucket->capacity, bucket->tokens + bucket->rate * elapsed);
+        }
+
+        delay = std::max(bytes_.take(static_cast<double>(nbytes)),
+                         ops_.take(static_cast<double>(nops)));
+    }
+
+    const auto delay_us = static_cast<uint64_t>(
+      std::chrono::duration_cast<std::chrono::microseconds>(delay).count());
+    delay_us_.record(delay_us);
+    total_delay_us_.fetch_add(delay_us, std::memory_order_relaxed);
+    return delay;
+}
+
+void
+zarr::RateLimiter::acquire(size_t nbytes, size_t nops) {
+    const auto delay = reserve(nbytes, nops);
+    if (delay.count() > 0) {
+        std::this_thread::sleep_for(delay);
+    }
+}
+
+void
+zarr::RateLimiter::reset_metrics() {
+    delay_us_.reset();
+    total_delay_us_.store(0, std::memory_order_relaxed);
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#include "log2.histogram.hh"
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+
+namespace zarr {
+/**
+ * @brief Bandwidth and IOPS limits enforced with two token buckets.
+ *
+ * Each write reserves its bytes and one operation up front, going into debt
+ * if the buckets run dry, and the caller sleeps until the debt is paid off.
+ * Writers split large writes into slices of at most slice_bytes() so that a
+ * limited writer issues a steady stream of small writes rather than
+ * sleeping and then bursting.
+ *
+ * A limiter may be shared by several writers; global() is consulted by
+ * every VectorizedFileWriter and is unlimited until configured.
+ */
+class RateLimiter
+{
+  public:
+    struct Limits
+    {
+        double bytes_per_second = 0; // 0 for unlimited
+        double ops_per_second = 0;   // 0 for unlimited
+        size_t burst_bytes = 4 << 20;
+        size_t burst_ops = 16;
+    };
+
+    RateLimiter();
+    explicit RateLimiter(const Limits& limits);
+
+    RateLimiter(const RateLimiter&) = delete;
+    RateLimiter& operator=(const RateLimiter&) = delete;
+
+    /// Process-wide limiter applied to every writer.
+    static RateLimiter& global();
+
+    /// Replace the limits. The buckets start full.
+    void set_limits(const Limits& limits);
+    Limits limits() const;
+    bool limited() const { return limited_.load(std::memory_order_acquire); }
+
+    /// Largest write that should be issued at once; SIZE_MAX if unlimited.
+    size_t slice_bytes() const;
+
+    /// Reserve @p nbytes and @p nops, returning how long the caller must
+    /// wait before issuing them.
+    std::chrono::nanoseconds reserve(size_t nbytes, size_t nops = 1);
+
+    /// Reserve, then sleep for the delay.
+    void acquire(size_t nbytes, size_t nops = 1);
+
+    /// Delay imposed per reservation, in us, including zeros.
+    const Log2Histogram& throttle_delay_us() const { return delay_us_; }
+
+    /// Total delay imposed, in us.
+    uint64_t total_delay_us() const {
+        return total_delay_us_.load(std::memory_order_relaxed);
+    }
+
+    /// Clear the delay metrics.
+    void reset_metrics();
+
+  private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Bucket
+    {
+        double rate = 0; // tokens per second; 0 for unlimited
+        double capacity = 0;
+        double tokens = 0;
+
+        /// Take @p n tokens; how long until the bucket is out of debt.
+        std::chrono::nanoseconds take(double n);
+    };
+
+    mutable std::mutex mutex_;
+    Limits limits_;
+    Bucket bytes_;
+    Bucket ops_;
+    Clock::time_point last_refill_;
+    std::atomic<bool> limited_;
+
+    Log2Histogram delay_us_;
+    std::atomic<uint64_t> total_delay_us_;
+};
+} // namespace zarr
@@ -0,0 +1,84 @@
+#include "shard.builder.hh"
+
+#include <algorithm>
+#include <span>
+#include <stdexcept>
+
+zarr::ShardBuilder::ShardBuilder(const ShardLayout& layout, size_t alignment)
+  : layout_(layout)
+  , alignment_(alignment)
+  , index_(2 * layout.size(), missing_chunk)
+  , zeros_(alignment > 1 ? alignment - 1 : 0)
+  , data_size_(0)
+  , padding_size_(0) {
+    if (alignment_ == 0) {
+        throw std::invalid_argument("Alignment must be nonzero");
+    }
+}
+
+void
+zarr::ShardBuilder::build_index(
+  const std::vector<std::vector<uint8_t>>& chunks) {
+    if (chunks.size() != layout_.size()) {
+        throw std::invalid_argument("Expected one buffer per inner chunk");
+    }
+
+    std::fill(index_.begin(), index_.end(), missing_chunk);
+
+    size_t offset = 0;
+    padding_size_ = 0;
+    for (size_t pos = 0; pos < layout_.size(); ++pos) {
+        const auto chunk_index = layout_.chunk_at(pos);
+        const auto& chunk = chunks[chunk_index];
+        if (chunk.empty()) {
+            continue;
+        }
+
+        const auto aligned =
+          (offset + alignment_ - 1) / alignment_ * alignment_;
+        padding_size_ += aligned - offset;
+        offset = aligned;
+
+        index_[2 * chunk_index] = offset;
+        index_[2 * chunk_index + 1] = chunk.size();
+        offset += chunk.size();
+    }
+    data_size_ = offset;
+}
+
+bool
+zarr::ShardBuilder::write(VectorizedFileWriter& writer,
+                          const std::vector<std::vector<uint8_t>>& chunks,
+                          size_t offset) {
+    build_index(chunks);
+
+    std::vector<std::span<const uint8_t>> buffers;
+    buffers.reserve(2 * layout_.size() + 1);
+    size_t end = 0;
+    for (size_t pos = 0; pos < layout_.size(); ++pos) {
+        const auto chunk_index = layout_.chunk_at(pos);
+        const auto& chunk = chunks[chunk_index];
+        if (chunk.empty()) {
+            continue;
+        }
+
+        const auto padding = index_[2 * chunk_index] - end;
+        if (padding > 0) {
+            buffers.emplace_back(zeros_.data(), padding);
+        }
+        buffers.emplace_back(chunk);
+        end = index_[2 * chunk_index] + chunk.size();
+    }
+
+    // index entries are stored little-endian, which is native on all our
+    // target platforms
+    buffers.emplace_back(reinterpret_cast<const uint8_t*>(index_.data()),
+                         index_.size() * sizeof(uint64_t));
+
+    return writer.write_vectors(buffers, offset);
+}
+
+size_t
+zarr::ShardBuilder::shard_size() const {
+    return data_size_ + index_.size() * sizeof(uint64_t);
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include "shard.layout.hh"
+#include "vectorized.file.writer.hh"
+
+#include <cstdint>
+#include <vector>
+
+namespace zarr {
+/**
+ * @brief Lays out encoded inner chunks in a shard and writes the shard,
+ * including its trailing index, with a single vectored write.
+ *
+ * The index follows the zarr v3 sharding codec: one (offset, nbytes) pair of
+ * little-endian uint64 per inner chunk in C order, with missing chunks marked
+ * by all bits set.
+ *
+ * With an alignment greater than 1, each chunk starts at a multiple of the
+ * alignment relative to the start of the shard, so that chunks can be read
+ * with direct I/O without touching their neighbours' sectors. The gaps are
+ * zero-filled and the index records each chunk's true length.
+ */
+class ShardBuilder
+{
+  public:
+    static constexpr uint64_t missing_chunk = ~0ULL;
+
+    explicit ShardBuilder(const ShardLayout& layout, size_t alignment = 1);
+
+    /// Compute the index for @p chunks, indexed by C-order chunk index.
+    void build_index(const std::vector<std::vector<uint8_t>>& chunks);
+
+    /// Lay out @p chunks and write the shard at @p offset.
+    bool write(VectorizedFileWriter& writer,
+               const std::vector<std::vector<uint8_t>>& chunks,
+               size_t offset = 0);
+
+    const std::vector<uint64_t>& index() const { return index_; }
+    size_t alignment() const { return alignment_; }
+    size_t data_size() const { return data_size_; }
+    size_t padding_size() const { return padding_size_; }
+    size_t shard_size() const;
+
+  private:
+    const ShardLayout& layout_;
+    size_t alignment_;
+    std::vector<uint64_t> index_;
+    std::vector<uint8_t> zeros_;
+    size_t data_size_;
+    size_t padding_size_;
+};
+} // namespace zarr
@@ -0,0 +1,250 @@
+#include "shard.coordinator.hh"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <stdexcept>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace fs = std::filesystem;
+
+namespace {
+constexpr uint8_t shard_pending = 0;
+constexpr uint8_t shard_completed = 1;
+
+// the run id, followed by one byte per shard
+constexpr off_t header_bytes = sizeof(uint64_t);
+
+#ifdef F_OFD_SETLK
+constexpr int set_lock = F_OFD_SETLK;
+constexpr int set_lock_wait = F_OFD_SETLKW;
+#else
+constexpr int set_lock = F_SETLK;
+constexpr int set_lock_wait = F_SETLKW;
+#endif
+
+std::string
+last_error() {
+    return strerror(errno);
+}
+} // namespace
+
+const char* zarr::ShardCoordinator::lease_file_name = ".shard_leases";
+
+zarr::ShardCoordinator::ShardCoordinator(const std::string& directory,
+                                         size_t nshards,
+                                         uint64_t run)
+  : nshards_(nshards)
+  , fd_(-1)
+  , cursor_(0) {
+    if (nshards_ == 0) {
+        throw std::invalid_argument("Need at least one shard");
+    }
+
+    std::error_code ec;
+    fs::create_directories(directory, ec);
+    const auto path = (fs::path(directory) / lease_file_name).string();
+    fd_ = open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (fd_ < 0) {
+        throw std::runtime_error("Failed to open lease file '" + path +
+                                 "': " + last_error());
+    }
+
+    try {
+        start_run_(run);
+    } catch (const std::exception& exc) {
+        close(fd_);
+        throw std::runtime_error("Lease file '" + path + "': " + exc.what());
+    }
+}
+
+zarr::ShardCoordinator::~ShardCoordinator() {
+    // closing the file drops any locks still held
+    close(fd_);
+}
+
+std::optional<size_t>
+zarr::ShardCoordinator::claim() {
+    size_t start;
+    {
+        std::scoped_lock lock(mutex_);
+        start = cursor_;
+    }
+
+    for (size_t i = 0; i < nshards_; ++i) {
+        const size_t shard = (start + i) % nshards_;
+        if (try_claim(shard)) {
+            std::scoped_lock lock(mutex_);
+            cursor_ = (shard + 1) % nshards_;
+            return shard;
+        }
+    }
+    return std::nullopt;
+}
+
+bool
+zarr::ShardCoordinator::try_claim(size_t shard) {
+    if (shard >= nshards_) {
+        return false;
+    }
+
+    {
+        std::scoped_lock lock(mutex_);
+        if (!held_.insert(shard).second) {
+            return false; // another thread here holds it
+        }
+    }
+
+    // check for completion only once we hold the lock, so a shard cannot be
+    // completed between the check and the claim
+    if (lock_(shard, true)) {
+        if (!completed(shard)) {
+            return true;
+        }
+        lock_(shard, false);
+    }
+
+    std::scoped_lock lock(mutex_);
+    held_.erase(shard);
+    return false;
+}
+
+bool
+zarr::ShardCoordinator::complete(size_t shard) {
+    {
+        std::scoped_lock lock(mutex_);
+        if (held_.count(shard) == 0) {
+            std::cerr << "Cannot complete unclaimed shard " << shard
+                      << std::endl;
+            return false;
+        }
+    }
+
+    const uint8_t state = shard_completed;
+    const bool ok =
+      pwrite(fd_, &state, 1, header_bytes + static_cast<off_t>(shard)) == 1;
+    if (!ok) {
+        std::cerr << "Failed to mark shard " << shard
+                  << " completed: " << last_error() << std::endl;
+    }
+    release(shard);
+    return ok;
+}
+
+void
+zarr::ShardCoordinator::release(size_t shard) {
+    std::scoped_lock lock(mutex_);
+    if (held_.erase(shard) > 0) {
+        lock_(shard, false);
+    }
+}
+
+bool
+zarr::ShardCoordinator::completed(size_t shard) const {
+    uint8_t state = shard_pending;
+    return pread(fd_, &state, 1, header_bytes + static_cast<off_t>(shard)) ==
+             1 &&
+           state == shard_completed;
+}
+
+size_t
+zarr::ShardCoordinator::remaining() const {
+    std::vector<uint8_t> states(nshards_, shard_pending);
+    if (pread(fd_, states.data(), states.size(), header_bytes) !=
+        static_cast<ssize_t>(states.size())) {
+        return nshards_;
+    }
+    return static_cast<size_t>(
+      std::count(states.begin(), states.end(), shard_pending));
+}
+
+bool
+zarr::ShardCoordinator::lock_(size_t shard, bool lock) {
+    if (lock_range_(header_bytes + static_cast<off_t>(shard),
+                    1,
+                    lock ? F_WRLCK : F_UNLCK,
+                    false)) {
+        return true;
+    }
+    if (errno != EAGAIN && errno != EACCES) {
+        std::cerr << "Failed to lock shard " << shard << ": " << last_error()
+                  << std::endl;
+    }
+    return false; // someone else holds it
+}
+
+// Apply a lock of @p type to @p length bytes from @p start, to the end of
+// the file if @p length is 0. Without @p wait, fails with errno EAGAIN or
+// EACCES if someone else holds a conflicting lock.
+bool
+zarr::ShardCoordinator::lock_range_(off_t start,
+                                    off_t length,
+                                    int type,
+                                    bool wait) {
+    struct flock fl;
+    memset(&fl, 0, sizeof(fl)); // OFD locks require l_pid == 0
+    fl.l_type = static_cast<short>(type);
+    fl.l_whence = SEEK_SET;
+    fl.l_start = start;
+    fl.l_len = length;
+
+    while (fcntl(fd_, wait ? set_lock_wait : set_lock, &fl) < 0) {
+        if (errno != EINTR) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Reset the lease file for @p run unless it already records it. The header
+// lock keeps the processes of a run from racing to reset it, and the lock on
+// every shard's byte keeps a reset from pulling shards out from under
+// another run's writers.
+void
+zarr::ShardCoordinator::start_run_(uint64_t run) {
+    if (!lock_range_(0, header_bytes, F_WRLCK, true)) {
+        throw std::runtime_error("failed to lock header: " + last_error());
+    }
+
+    std::string error;
+    uint64_t recorded = 0;
+    const bool same_run =
+      pread(fd_, &recorded, sizeof(recorded), 0) == sizeof(recorded) &&
+      recorded == run;
+    if (!same_run) {
+        if (!lock_range_(header_bytes, 0, F_WRLCK, false)) {
+            error = errno == EAGAIN || errno == EACCES
+                      ? "in use by another run"
+                      : "failed to lock shards: " + last_error();
+        } else {
+            // truncating discards the old states, and the new bytes read
+            // as zero, i.e. pending; stamp the run only once that is done
+            if (ftruncate(fd_, header_bytes) < 0 ||
+                ftruncate(fd_, header_bytes + static_cast<off_t>(nshards_)) <
+                  0 ||
+                pwrite(fd_, &run, sizeof(run), 0) != sizeof(run)) {
+                error = "failed to reset: " + last_error();
+            }
+            lock_range_(header_bytes, 0, F_UNLCK, false);
+        }
+    } else {
+        struct stat st;
+        if (fstat(fd_, &st) < 0 ||
+            (st.st_size < header_bytes + static_cast<off_t>(nshards_) &&
+             ftruncate(fd_, header_bytes + static_cast<off_t>(nshards_)) <
+               0)) {
+            error = "failed to size: " + last_error();
+        }
+    }
+
+    lock_range_(0, header_bytes, F_UNLCK, false);
+    if (!error.empty()) {
+        throw std::runtime_error(error);
+    }
+}
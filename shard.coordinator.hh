@@ -0,0 +1,87 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <set>
+#include <string>
+
+#include <sys/types.h> // off_t
+
+namespace zarr {
+/**
+ * @brief Shares out the shards of an array among several writer processes,
+ * so that each shard is written by exactly one of them.
+ *
+ * The processes coordinate through a lease file in the array's directory,
+ * holding one byte per shard. A process owns a shard while it holds a
+ * write lock on the shard's byte, and marks the byte once the shard is
+ * written so that no one claims it again. Locks are open file description
+ * (OFD) locks on Linux, and classic POSIX record locks elsewhere, so only
+ * one coordinator per process per array there. Either way, the kernel
+ * drops a crashed process's locks, and its unfinished shards can be
+ * claimed by the others.
+ *
+ * The lease file starts with the id of the run it records. A coordinator
+ * for another run, e.g. one rewriting the array, resets every shard to
+ * pending first, provided no one holds any; processes sharing a run must
+ * all pass its id, and runs must not overlap.
+ *
+ * Threads in one process may share a coordinator. POSIX only.
+ */
+class ShardCoordinator
+{
+  public:
+    /// Coordinate @p nshards shards for run @p run through the lease file
+    /// in @p directory, creating both if need be. If the file records
+    /// another run, its shards are reset to pending, or, if someone still
+    /// holds one, std::runtime_error is thrown.
+    ShardCoordinator(const std::string& directory,
+                     size_t nshards,
+                     uint64_t run);
+    ~ShardCoordinator();
+
+    ShardCoordinator(const ShardCoordinator&) = delete;
+    ShardCoordinator& operator=(const ShardCoordinator&) = delete;
+
+    size_t nshards() const { return nshards_; }
+
+    /// Claim a shard that no one holds and no one has completed, or
+    /// nullopt once there are none.
+    std::optional<size_t> claim();
+
+    /// Claim @p shard. Returns false if someone holds or has completed it.
+    bool try_claim(size_t shard);
+
+    /// Mark a claimed @p shard as written, and release it.
+    bool complete(size_t shard);
+
+    /// Release a claimed @p shard unwritten, e.g. after a failed write, so
+    /// that someone else may claim it.
+    void release(size_t shard);
+
+    /// Whether anyone has completed @p shard.
+    bool completed(size_t shard) const;
+
+    /// Number of shards no one has completed yet. While claim() finds
+    /// nothing but this is nonzero, others hold the rest, and a shard comes
+    /// free again if its holder dies.
+    size_t remaining() const;
+
+    /// Name of the lease file within an array's directory.
+    static const char* lease_file_name;
+
+  private:
+    const size_t nshards_;
+    int fd_;
+
+    mutable std::mutex mutex_;
+    std::set<size_t> held_; // the lock is per process, not per thread
+    size_t cursor_;         // where claim() starts looking
+
+    bool lock_(size_t shard, bool lock);
+    bool lock_range_(off_t start, off_t length, int type, bool wait);
+    void start_run_(uint64_t run);
+};
+} // namespace zarr
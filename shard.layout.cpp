@@ -0,0 +1,278 @@
+#include "shard.layout.hh"
+
+#include <algorithm>
+#include <numeric>
+#include <stdexcept>
+
+#if defined(__BMI2__)
+#include <immintrin.h>
+#endif
+
+namespace {
+#if !defined(__BMI2__)
+// Spread the low 32 bits of x so that there is one zero bit between each.
+uint64_t
+part1by1(uint64_t x) {
+    x &= 0x00000000ffffffffULL;
+    x = (x | (x << 16)) & 0x0000ffff0000ffffULL;
+    x = (x | (x << 8)) & 0x00ff00ff00ff00ffULL;
+    x = (x | (x << 4)) & 0x0f0f0f0f0f0f0f0fULL;
+    x = (x | (x << 2)) & 0x3333333333333333ULL;
+    x = (x | (x << 1)) & 0x5555555555555555ULL;
+    return x;
+}
+
+// Spread the low 21 bits of x so that there are two zero bits between each.
+uint64_t
+part1by2(uint64_t x) {
+    x &= 0x00000000001fffffULL;
+    x = (x | (x << 32)) & 0x001f00000000ffffULL;
+    x = (x | (x << 16)) & 0x001f0000ff0000ffULL;
+    x = (x | (x << 8)) & 0x100f00f00f00f00fULL;
+    x = (x | (x << 4)) & 0x10c30c30c30c30c3ULL;
+    x = (x | (x << 2)) & 0x1249249249249249ULL;
+    return x;
+}
+#endif
+
+int
+bits_needed(const std::vector<uint32_t>& shape) {
+    const uint32_t max_extent =
+      *std::max_element(shape.begin(), shape.end());
+
+    int bits = 1;
+    while ((1ULL << bits) < max_extent) {
+        ++bits;
+    }
+    return bits;
+}
+} // namespace
+
+std::string
+zarr::to_string(ChunkOrder order) {
+    switch (order) {
+        case ChunkOrder::C:
+            return "c";
+        case ChunkOrder::Morton:
+            return "morton";
+        case ChunkOrder::Hilbert:
+            return "hilbert";
+    }
+    throw std::invalid_argument("Unknown chunk order");
+}
+
+zarr::ChunkOrder
+zarr::chunk_order_from_string(const std::string& name) {
+    if (name == "c") {
+        return ChunkOrder::C;
+    }
+    if (name == "morton") {
+        return ChunkOrder::Morton;
+    }
+    if (name == "hilbert") {
+        return ChunkOrder::Hilbert;
+    }
+    throw std::invalid_argument("Unknown chunk order: " + name);
+}
+
+uint64_t
+zarr::morton_encode_2d(uint32_t x, uint32_t y) {
+#if defined(__BMI2__)
+    return _pdep_u64(x, 0xaaaaaaaaaaaaaaaaULL) |
+           _pdep_u64(y, 0x5555555555555555ULL);
+#else
+    return (part1by1(x) << 1) | part1by1(y);
+#endif
+}
+
+uint64_t
+zarr::morton_encode_3d(uint32_t x, uint32_t y, uint32_t z) {
+#if defined(__BMI2__)
+    return _pdep_u64(x, 0x4924924924924924ULL) |
+           _pdep_u64(y, 0x2492492492492492ULL) |
+           _pdep_u64(z, 0x9249249249249249ULL);
+#else
+    return (part1by2(x) << 2) | (part1by2(y) << 1) | part1by2(z);
+#endif
+}
+
+uint64_t
+zarr::morton_encode(const std::vector<uint32_t>& coords, int bits) {
+    const auto ndim = static_cast<int>(coords.size());
+    if (ndim * bits > 64) {
+        throw std::invalid_argument("Morton key does not fit in 64 bits");
+    }
+
+    if (ndim == 2 && bits <= 32) {
+        return morton_encode_2d(coords[0], coords[1]);
+    }
+    if (ndim == 3 && bits <= 21) {
+        return morton_encode_3d(coords[0], coords[1], coords[2]);
+    }
+
+    uint64_t key = 0;
+    for (int b = bits - 1; b >= 0; --b) {
+        for (int d = 0; d < ndim; ++d) {
+            key = (key << 1) | ((coords[d] >> b) & 1);
+        }
+    }
+    return key;
+}
+
+uint64_t
+zarr::hilbert_encode(const std::vector<uint32_t>& coords, int bits) {
+    const auto ndim = static_cast<int>(coords.size());
+    if (ndim * bits > 64) {
+        throw std::invalid_argument("Hilbert key does not fit in 64 bits");
+    }
+
+    // J. Skilling, "Programming the Hilbert curve", AIP Conf. Proc. 707
+    // (2004): convert axes to the transposed Hilbert index in place.
+    std::vector<uint32_t> x(coords);
+    const uint32_t m = 1U << (bits - 1);
+
+    for (uint32_t q = m; q > 1; q >>= 1) {
+        const uint32_t p = q - 1;
+        for (int i = 0; i < ndim; ++i) {
+            if (x[i] & q) {
+                x[0] ^= p;
+            } else {
+                const uint32_t t = (x[0] ^ x[i]) & p;
+                x[0] ^= t;
+                x[i] ^= t;
+            }
+        }
+    }
+
+    for (int i = 1; i < ndim; ++i) {
+        x[i] ^= x[i - 1];
+    }
+    uint32_t t = 0;
+    for (uint32_t q = m; q > 1; q >>= 1) {
+        if (x[ndim - 1] & q) {
+            t ^= q - 1;
+        }
+    }
+    for (int i = 0; i < ndim; ++i) {
+        x[i] ^= t;
+    }
+
+    // the transposed index is the Morton interleaving of the result
+    return morton_encode(x, bits);
+}
+
+zarr::ShardLayout::ShardLayout(const std::vector<uint32_t>& chunks_per_shard,
+                               ChunkOrder order)
+  : chunks_per_shard_(chunks_per_shard)
+  , order_(order) {
+    if (chunks_per_shard_.empty()) {
+        throw std::invalid_argument("Shard must have at least one dimension");
+    }
+
+    size_t nchunks = 1;
+    for (const auto& n : chunks_per_shard_) {
+        if (n == 0) {
+            throw std::invalid_argument("Shard dimensions must be nonzero");
+        }
+        nchunks *= n;
+    }
+
+    chunk_at_.resize(nchunks);
+    std::iota(chunk_at_.begin(), chunk_at_.end(), 0);
+
+    if (order_ != ChunkOrder::C) {
+        const int bits = bits_needed(chunks_per_shard_);
+
+        std::vector<uint64_t> keys(nchunks);
+        for (size_t i = 0; i < nchunks; ++i) {
+            const auto coords = chunk_coords(i);
+            keys[i] = order_ == ChunkOrder::Morton
+                        ? morton_encode(coords, bits)
+                        : hilbert_encode(coords, bits);
+        }
+
+        // curve positions outside a non-power-of-two grid are skipped
+        std::sort(chunk_at_.begin(),
+                  chunk_at_.end(),
+                  [&keys](size_t a, size_t b) { return keys[a] < keys[b]; });
+    }
+
+    position_of_.resize(nchunks);
+    for (size_t pos = 0; pos < nchunks; ++pos) {
+        position_of_[chunk_at_[pos]] = pos;
+    }
+}
+
+size_t
+zarr::ShardLayout::position_of(size_t chunk_index) const {
+    return position_of_.at(chunk_index);
+}
+
+size_t
+zarr::ShardLayout::chunk_at(size_t position) const {
+    return chunk_at_.at(position);
+}
+
+size_t
+zarr::ShardLayout::chunk_index(const std::vector<uint32_t>& coords) const {
+    if (coords.size() != chunks_per_shard_.size()) {
+        throw std::invalid_argument("Coordinate dimensionality mismatch");
+    }
+
+    size_t index = 0;
+    for (size_t d = 0; d < coords.size(); ++d) {
+        index = index * chunks_per_shard_[d] + coords[d];
+    }
+    return index;
+}
+
+std::vector<uint32_t>
+zarr::ShardLayout::chunk_coords(size_t chunk_index) const {
+    std::vector<uint32_t> coords(chunks_per_shard_.size());
+    for (auto d = coords.size(); d-- > 0;) {
+        coords[d] = static_cast<uint32_t>(chunk_index % chunks_per_shard_[d]);
+        chunk_index /= chunks_per_shard_[d];
+    }
+    return coords;
+}
+
+std::vector<size_t>
+zarr::ShardLayout::chunks_in_region(const std::vector<uint32_t>& begin,
+                                    const std::vector<uint32_t>& end) const {
+    const auto ndim = chunks_per_shard_.size();
+    if (begin.size() != ndim || end.size() != ndim) {
+        throw std::invalid_argument("Region dimensionality mismatch");
+    }
+
+    std::vector<size_t> chunks;
+    for (size_t d = 0; d < ndim; ++d) {
+        if (begin[d] >= end[d]) {
+            return chunks;
+        }
+        if (end[d] > chunks_per_shard_[d]) {
+            throw std::out_of_range("Region exceeds shard bounds");
+        }
+    }
+
+    std::vector<uint32_t> coords(begin);
+    while (true) {
+        chunks.push_back(chunk_index(coords));
+
+        // odometer increment, last dimension fastest
+        auto d = ndim;
+        while (d-- > 0) {
+            if (++coords[d] < end[d]) {
+                break;
+            }
+            coords[d] = begin[d];
+        }
+        if (d == static_cast<size_t>(-1)) {
+            break;
+        }
+    }
+
+    std::sort(chunks.begin(), chunks.end(), [this](size_t a, size_t b) {
+        return position_of_[a] < position_of_[b];
+    });
+    return chunks;
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace zarr {
+/// Order in which inner chunks are laid out inside a shard.
+enum class ChunkOrder
+{
+    C,       // row-major over chunk coordinates (last dimension fastest)
+    Morton,  // Z-order curve
+    Hilbert, // Hilbert curve
+};
+
+std::string
+to_string(ChunkOrder order);
+
+ChunkOrder
+chunk_order_from_string(const std::string& name);
+
+/// Interleave the low 32 bits of @p x and @p y, @p y taking the low bit.
+uint64_t
+morton_encode_2d(uint32_t x, uint32_t y);
+
+/// Interleave the low 21 bits of @p x, @p y and @p z, @p z taking the low bit.
+uint64_t
+morton_encode_3d(uint32_t x, uint32_t y, uint32_t z);
+
+/// Morton key of an N-dimensional coordinate, last dimension in the low bit.
+uint64_t
+morton_encode(const std::vector<uint32_t>& coords, int bits);
+
+/// Hilbert key of an N-dimensional coordinate (Skilling's algorithm).
+uint64_t
+hilbert_encode(const std::vector<uint32_t>& coords, int bits);
+
+/**
+ * @brief Maps inner chunks of a shard to their storage position.
+ *
+ * Chunks are identified by their row-major (C-order) index over the grid of
+ * inner chunks, which is also the order of entries in the shard index. The
+ * storage position is where the chunk's bytes land in the shard.
+ */
+class ShardLayout
+{
+  public:
+    ShardLayout(const std::vector<uint32_t>& chunks_per_shard,
+                ChunkOrder order);
+
+    ChunkOrder order() const { return order_; }
+    const std::vector<uint32_t>& shape() const { return chunks_per_shard_; }
+    size_t size() const { return chunk_at_.size(); }
+
+    size_t position_of(size_t chunk_index) const;
+    size_t chunk_at(size_t position) const;
+
+    size_t chunk_index(const std::vector<uint32_t>& coords) const;
+    std::vector<uint32_t> chunk_coords(size_t chunk_index) const;
+
+    /// C-order indices of the chunks in [begin, end), sorted by position.
+    std::vector<size_t> chunks_in_region(
+      const std::vector<uint32_t>& begin,
+      const std::vector<uint32_t>& end) const;
+
+  private:
+    std::vector<uint32_t> chunks_per_shard_;
+    ChunkOrder order_;
+    std::vector<size_t> position_of_;
+    std::vector<size_t> chunk_at_;
+};
+} // namespace zarr
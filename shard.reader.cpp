@@ -0,0 +1,305 @@
+#include "shard.reader.hh"
+
+#include <algorithm>
+#include <climits> // IOV_MAX
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+
+namespace {
+constexpr uint64_t missing_chunk = ~0ULL;
+
+class AlignedBuffer
+{
+  public:
+    AlignedBuffer(size_t size, size_t alignment)
+      : data_(nullptr) {
+#ifdef _WIN32
+        data_ = static_cast<uint8_t*>(_aligned_malloc(size, alignment));
+#else
+        void* ptr = nullptr;
+        if (posix_memalign(&ptr, alignment, size) == 0) {
+            data_ = static_cast<uint8_t*>(ptr);
+        }
+#endif
+        if (data_ == nullptr) {
+            throw std::bad_alloc();
+        }
+    }
+
+    ~AlignedBuffer() {
+#ifdef _WIN32
+        _aligned_free(data_);
+#else
+        free(data_);
+#endif
+    }
+
+    uint8_t* data() { return data_; }
+
+  private:
+    uint8_t* data_;
+};
+} // namespace
+
+zarr::ShardReader::ShardReader(const std::string& path,
+                               const ShardLayout& layout,
+                               bool direct_io,
+                               size_t dio_alignment,
+                               size_t shard_alignment)
+  : layout_(layout)
+  , direct_io_(direct_io)
+  , dio_alignment_(dio_alignment)
+  , shard_alignment_(std::max<size_t>(shard_alignment, 1))
+  , index_(2 * layout.size())
+  , discard_(shard_alignment_ - 1)
+  , reads_issued_(0)
+  , bytes_read_(0) {
+    if (dio_alignment_ == 0 ||
+        (dio_alignment_ & (dio_alignment_ - 1)) != 0) {
+        throw std::invalid_argument("Alignment must be a power of 2");
+    }
+
+    size_t file_size;
+#ifdef _WIN32
+    handle_ = CreateFileA(path.c_str(),
+                          GENERIC_READ,
+                          FILE_SHARE_READ,
+                          nullptr,
+                          OPEN_EXISTING,
+                          direct_io_ ? FILE_FLAG_NO_BUFFERING
+                                     : FILE_ATTRIBUTE_NORMAL,
+                          nullptr);
+    if (handle_ == INVALID_HANDLE_VALUE) {
+        throw std::runtime_error("Failed to open file: " + path);
+    }
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(handle_, &size)) {
+        CloseHandle(handle_);
+        throw std::runtime_error("Failed to get size of file: " + path);
+    }
+    file_size = static_cast<size_t>(size.QuadPart);
+#else
+    int flags = O_RDONLY;
+#ifdef O_DIRECT
+    if (direct_io_) {
+        flags |= O_DIRECT;
+    }
+#endif
+    fd_ = open(path.c_str(), flags);
+    if (fd_ < 0) {
+        throw std::runtime_error("Failed to open file: " + path);
+    }
+#if defined(__APPLE__)
+    if (direct_io_) {
+        fcntl(fd_, F_NOCACHE, 1);
+    }
+#endif
+
+    struct stat st;
+    if (fstat(fd_, &st) < 0) {
+        close(fd_);
+        throw std::runtime_error("Failed to stat file: " + path);
+    }
+    file_size = static_cast<size_t>(st.st_size);
+#endif
+
+    const size_t index_size = index_.size() * sizeof(uint64_t);
+    if (file_size < index_size ||
+        !read_segments_(
+          { { reinterpret_cast<uint8_t*>(index_.data()), index_size } },
+          file_size - index_size)) {
+        close_();
+        throw std::runtime_error("Failed to read shard index: " + path);
+    }
+}
+
+zarr::ShardReader::~ShardReader() {
+    close_();
+}
+
+void
+zarr::ShardReader::close_() {
+#ifdef _WIN32
+    if (handle_ != INVALID_HANDLE_VALUE) {
+        CloseHandle(handle_);
+        handle_ = INVALID_HANDLE_VALUE;
+    }
+#else
+    if (fd_ >= 0) {
+        close(fd_);
+        fd_ = -1;
+    }
+#endif
+}
+
+std::vector<uint8_t>
+zarr::ShardReader::read_chunk(size_t chunk_index) {
+    return std::move(read_chunks({ chunk_index }).front());
+}
+
+std::vector<std::vector<uint8_t>>
+zarr::ShardReader::read_chunks(const std::vector<size_t>& chunk_indices) {
+    std::vector<std::vector<uint8_t>> chunks(chunk_indices.size());
+
+    // visit requested chunks in storage order
+    std::vector<size_t> order;
+    order.reserve(chunk_indices.size());
+    for (size_t i = 0; i < chunk_indices.size(); ++i) {
+        const auto chunk_index = chunk_indices[i];
+        if (chunk_index >= layout_.size()) {
+            throw std::out_of_range("Chunk index out of range");
+        }
+        if (index_[2 * chunk_index] == missing_chunk) {
+            continue; // leave empty
+        }
+        chunks[i].resize(index_[2 * chunk_index + 1]);
+        order.push_back(i);
+    }
+    std::sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+        return index_[2 * chunk_indices[a]] < index_[2 * chunk_indices[b]];
+    });
+
+    // coalesce runs of chunks that are adjacent on disk into one read,
+    // reading through padding; chunks start on shard_alignment_ boundaries,
+    // so a smaller gap cannot hold another chunk
+    std::vector<Segment> segments;
+    size_t run_offset = 0, run_end = 0;
+    for (const auto i : order) {
+        const auto offset = index_[2 * chunk_indices[i]];
+        if (!segments.empty() && offset - run_end >= shard_alignment_) {
+            if (!read_segments_(segments, run_offset)) {
+                throw std::runtime_error("Failed to read chunks");
+            }
+            segments.clear();
+        }
+        if (segments.empty()) {
+            run_offset = run_end = offset;
+        } else if (offset > run_end) {
+            segments.push_back({ nullptr, offset - run_end });
+        }
+        segments.push_back({ chunks[i].data(), chunks[i].size() });
+        run_end = offset + chunks[i].size();
+    }
+    if (!segments.empty() && !read_segments_(segments, run_offset)) {
+        throw std::runtime_error("Failed to read chunks");
+    }
+
+    return chunks;
+}
+
+bool
+zarr::ShardReader::read_segments_(const std::vector<Segment>& segments,
+                                  size_t offset) {
+    return direct_io_ ? read_direct_(segments, offset)
+                      : read_buffered_(segments, offset);
+}
+
+bool
+zarr::ShardReader::read_buffered_(const std::vector<Segment>& segments,
+                                  size_t offset) {
+#ifdef _WIN32
+    // no scatter read for buffered handles; stage through one buffer
+    return read_direct_(segments, offset);
+#else
+    std::vector<struct iovec> iovecs(segments.size());
+    for (size_t i = 0; i < segments.size(); ++i) {
+        iovecs[i].iov_base =
+          segments[i].data ? segments[i].data : discard_.data();
+        iovecs[i].iov_len = segments[i].size;
+    }
+
+    const auto max_iovecs = static_cast<size_t>(IOV_MAX);
+    for (size_t first = 0; first < iovecs.size(); first += max_iovecs) {
+        const auto count = std::min(max_iovecs, iovecs.size() - first);
+
+        ssize_t total_bytes = 0;
+        for (auto i = first; i < first + count; ++i) {
+            total_bytes += static_cast<ssize_t>(iovecs[i].iov_len);
+        }
+
+        ++reads_issued_;
+        bytes_read_ += total_bytes;
+        const ssize_t bytes_read = preadv(fd_,
+                                          iovecs.data() + first,
+                                          static_cast<int>(count),
+                                          static_cast<off_t>(offset));
+        if (bytes_read != total_bytes) {
+            return false;
+        }
+        offset += total_bytes;
+    }
+    return true;
+#endif
+}
+
+bool
+zarr::ShardReader::read_direct_(const std::vector<Segment>& segments,
+                                size_t offset) {
+    size_t total_bytes = 0;
+    for (const auto& segment : segments) {
+        total_bytes += segment.size;
+    }
+
+    // widen the read to whole aligned blocks
+    const size_t alignment = direct_io_ ? dio_alignment_ : 1;
+    const size_t begin = offset / alignment * alignment;
+    const size_t end =
+      (offset + total_bytes + alignment - 1) / alignment * alignment;
+    const size_t nbytes = end - begin;
+
+    AlignedBuffer staging(nbytes, dio_alignment_);
+    ++reads_issued_;
+    bytes_read_ += nbytes;
+
+    // the last block may extend past the end of the file
+    const size_t needed = offset + total_bytes - begin;
+    size_t got = 0;
+#ifdef _WIN32
+    OVERLAPPED overlapped = { 0 };
+    overlapped.Offset = static_cast<DWORD>(begin & 0xFFFFFFFF);
+    overlapped.OffsetHigh = static_cast<DWORD>(begin >> 32);
+
+    DWORD bytes_read = 0;
+    if (!ReadFile(handle_,
+                  staging.data(),
+                  static_cast<DWORD>(nbytes),
+                  &bytes_read,
+                  &overlapped)) {
+        return false;
+    }
+    got = bytes_read;
+#else
+    while (got < needed) {
+        const ssize_t bytes_read = pread(fd_,
+                                         staging.data() + got,
+                                         nbytes - got,
+                                         static_cast<off_t>(begin + got));
+        if (bytes_read <= 0) {
+            break;
+        }
+        got += static_cast<size_t>(bytes_read);
+    }
+#endif
+    if (got < needed) {
+        return false;
+    }
+
+    const auto* cur = staging.data() + (offset - begin);
+    for (const auto& segment : segments) {
+        if (segment.data) {
+            memcpy(segment.data, cur, segment.size);
+        }
+        cur += segment.size;
+    }
+    return true;
+}
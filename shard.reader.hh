@@ -0,0 +1,77 @@
+#pragma once
+
+#include "shard.layout.hh"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+namespace zarr {
+/**
+ * @brief Reads inner chunks from a shard written by ShardBuilder.
+ *
+ * Requested chunks are fetched in storage order, and chunks that are
+ * adjacent on disk, or separated only by the padding of a shard written with
+ * @p shard_alignment, are coalesced into a single scatter read, so the
+ * number of reads needed for a region depends on the shard's chunk order.
+ * Unrequested chunks are never read.
+ *
+ * With direct I/O, each read is widened to @p dio_alignment boundaries and
+ * staged through an aligned buffer; shards written with a matching alignment
+ * need no widening at the start of each chunk.
+ */
+class ShardReader
+{
+  public:
+    ShardReader(const std::string& path,
+                const ShardLayout& layout,
+                bool direct_io = false,
+                size_t dio_alignment = 4096,
+                size_t shard_alignment = 1);
+    ~ShardReader();
+
+    std::vector<uint8_t> read_chunk(size_t chunk_index);
+
+    /// Read @p chunk_indices, returning the buffers in the requested order.
+    std::vector<std::vector<uint8_t>> read_chunks(
+      const std::vector<size_t>& chunk_indices);
+
+    const std::vector<uint64_t>& index() const { return index_; }
+
+    /// Number of read calls issued so far.
+    size_t reads_issued() const { return reads_issued_; }
+
+    /// Number of bytes requested from the file so far, including padding.
+    size_t bytes_read() const { return bytes_read_; }
+
+  private:
+    struct Segment
+    {
+        uint8_t* data; // nullptr to skip the bytes
+        size_t size;
+    };
+
+    const ShardLayout& layout_;
+    bool direct_io_;
+    size_t dio_alignment_;
+    size_t shard_alignment_; // gaps smaller than this are padding
+    std::vector<uint64_t> index_;
+    std::vector<uint8_t> discard_;
+    size_t reads_issued_;
+    size_t bytes_read_;
+#ifdef _WIN32
+    HANDLE handle_;
+#else
+    int fd_;
+#endif
+
+    void close_();
+    bool read_segments_(const std::vector<Segment>& segments, size_t offset);
+    bool read_buffered_(const std::vector<Segment>& segments, size_t offset);
+    bool read_direct_(const std::vector<Segment>& segments, size_t offset);
+};
+} // namespace zarr
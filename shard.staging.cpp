@@ -0,0 +1,286 @@
+#include "shard.staging.hh"
+
+#include <algorithm>
+#include <cerrno>
+#include <climits> // IOV_MAX
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <stdexcept>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <sys/mman.h> // memfd_create
+#include <sys/sendfile.h>
+#endif
+
+namespace {
+const int all_seals =
+#ifdef __linux__
+  F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE | F_SEAL_SEAL;
+#else
+  0;
+#endif
+
+// the most copy_file_range and sendfile move in one call
+const size_t max_copy_bytes = 0x7ffff000;
+
+std::string
+last_error() {
+    return strerror(errno);
+}
+
+int
+create_staging_fd(const std::string& name) {
+#ifdef __linux__
+    return memfd_create(name.c_str(), MFD_CLOEXEC | MFD_ALLOW_SEALING);
+#else
+    auto path = (std::filesystem::temp_directory_path() / (name + "-XXXXXX"))
+                  .string();
+    const int fd = mkstemp(path.data());
+    if (fd >= 0) {
+        unlink(path.c_str());
+        fcntl(fd, F_SETFD, FD_CLOEXEC);
+    }
+    return fd;
+#endif
+}
+
+// Write all of @p buffers contiguously to @p fd at @p offset, with one
+// pwritev per IOV_MAX buffers, resubmitting the rest of a short write.
+bool
+write_all(int fd,
+          const std::vector<std::span<const uint8_t>>& buffers,
+          size_t offset) {
+    const auto max_iovecs = static_cast<size_t>(IOV_MAX);
+    std::vector<struct iovec> iovecs;
+    iovecs.reserve(std::min(max_iovecs, buffers.size()));
+
+    size_t i = 0;
+    while (i < buffers.size()) {
+        iovecs.clear();
+        size_t nbytes = 0;
+        for (; i < buffers.size() && iovecs.size() < max_iovecs; ++i) {
+            struct iovec iov;
+            iov.iov_base = const_cast<uint8_t*>(buffers[i].data());
+            iov.iov_len = buffers[i].size();
+            iovecs.push_back(iov);
+            nbytes += iov.iov_len;
+        }
+
+        size_t first = 0;
+        while (nbytes > 0) {
+            const auto n = pwritev(fd,
+                                   iovecs.data() + first,
+                                   static_cast<int>(iovecs.size() - first),
+                                   static_cast<off_t>(offset));
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            if (n <= 0) {
+                return false;
+            }
+            offset += static_cast<size_t>(n);
+            nbytes -= static_cast<size_t>(n);
+
+            auto remaining = static_cast<size_t>(n);
+            while (first < iovecs.size() &&
+                   remaining >= iovecs[first].iov_len) {
+                remaining -= iovecs[first].iov_len;
+                ++first;
+            }
+            if (remaining > 0) {
+                iovecs[first].iov_base =
+                  static_cast<uint8_t*>(iovecs[first].iov_base) + remaining;
+                iovecs[first].iov_len -= remaining;
+            }
+        }
+    }
+    return true;
+}
+} // namespace
+
+zarr::ShardStaging::ShardStaging(const std::string& name)
+  : ShardStaging(create_staging_fd(name)) {
+}
+
+zarr::ShardStaging::ShardStaging(int fd)
+  : fd_(fd)
+  , sealed_(false)
+  , copy_method_(CopyMethod::None) {
+    if (fd_ < 0) {
+        throw std::runtime_error("Failed to create staging area: " +
+                                 last_error());
+    }
+}
+
+zarr::ShardStaging
+zarr::ShardStaging::from_fd(int fd) {
+    const int own_fd = dup(fd);
+    if (own_fd < 0) {
+        throw std::runtime_error("Failed to duplicate descriptor: " +
+                                 last_error());
+    }
+    return ShardStaging(own_fd);
+}
+
+zarr::ShardStaging::ShardStaging(ShardStaging&& other) noexcept
+  : fd_(other.fd_)
+  , sealed_(other.sealed_)
+  , copy_method_(other.copy_method_) {
+    other.fd_ = -1;
+}
+
+zarr::ShardStaging::~ShardStaging() {
+    if (fd_ >= 0) {
+        close(fd_);
+    }
+}
+
+size_t
+zarr::ShardStaging::size() const {
+    struct stat st;
+    if (fstat(fd_, &st) < 0) {
+        return 0;
+    }
+    return static_cast<size_t>(st.st_size);
+}
+
+bool
+zarr::ShardStaging::write_vectors(
+  const std::vector<std::span<const uint8_t>>& buffers,
+  size_t offset) {
+    if (sealed()) {
+        std::cerr << "Cannot stage into a sealed shard" << std::endl;
+        return false;
+    }
+
+    if (!write_all(fd_, buffers, offset)) {
+        std::cerr << "Failed to stage shard data: " << last_error()
+                  << std::endl;
+        return false;
+    }
+    return true;
+}
+
+void
+zarr::ShardStaging::seal() {
+#ifdef __linux__
+    if (fcntl(fd_, F_ADD_SEALS, all_seals) < 0 && !sealed()) {
+        throw std::runtime_error("Failed to seal staged shard: " +
+                                 last_error());
+    }
+#endif
+    sealed_ = true;
+}
+
+bool
+zarr::ShardStaging::sealed() const {
+#ifdef __linux__
+    // another process may have sealed it
+    const int seals = fcntl(fd_, F_GET_SEALS);
+    return seals >= 0 && (seals & all_seals) == all_seals;
+#else
+    return sealed_;
+#endif
+}
+
+bool
+zarr::ShardStaging::commit(const std::string& path, size_t offset) {
+    if (!sealed()) {
+        std::cerr << "Cannot commit a shard that is not sealed" << std::endl;
+        return false;
+    }
+
+    // a shard committed at the start of the file replaces the file, so a
+    // larger old shard's tail and index do not linger past the new one
+    const int flags =
+      O_WRONLY | O_CREAT | O_CLOEXEC | (offset == 0 ? O_TRUNC : 0);
+    const int dst = open(path.c_str(), flags, 0644);
+    if (dst < 0) {
+        std::cerr << "Failed to open file '" << path << "': " << last_error()
+                  << std::endl;
+        return false;
+    }
+    const bool ok = copy_to_(dst, offset);
+    if (!ok) {
+        std::cerr << "Failed to commit shard to '" << path
+                  << "': " << last_error() << std::endl;
+    }
+    return close(dst) == 0 && ok;
+}
+
+bool
+zarr::ShardStaging::copy_to_(int dst, size_t offset) {
+    const size_t nbytes = size();
+    size_t copied = 0;
+    copy_method_ = CopyMethod::None;
+
+#ifdef __linux__
+    // copy_file_range between file systems of different types fails with
+    // EXDEV on some kernels; sendfile copies in the kernel regardless
+    copy_method_ = CopyMethod::CopyFileRange;
+    while (copied < nbytes && copy_method_ == CopyMethod::CopyFileRange) {
+        auto in = static_cast<loff_t>(copied);
+        auto out = static_cast<loff_t>(offset + copied);
+        const auto n = copy_file_range(
+          fd_, &in, dst, &out, std::min(nbytes - copied, max_copy_bytes), 0);
+        if (n > 0) {
+            copied += static_cast<size_t>(n);
+        } else if (n < 0 && errno == EINTR) {
+            continue;
+        } else if (n < 0 && copied == 0 &&
+                   (errno == EXDEV || errno == EINVAL || errno == ENOSYS ||
+                    errno == EOPNOTSUPP)) {
+            copy_method_ = CopyMethod::Sendfile;
+        } else {
+            return false; // an error, or the shard shrank under us
+        }
+    }
+
+    if (copy_method_ == CopyMethod::Sendfile) {
+        if (lseek(dst, static_cast<off_t>(offset), SEEK_SET) < 0) {
+            return false;
+        }
+        while (copied < nbytes) {
+            auto in = static_cast<off_t>(copied);
+            const auto n = sendfile(
+              dst, fd_, &in, std::min(nbytes - copied, max_copy_bytes));
+            if (n > 0) {
+                copied += static_cast<size_t>(n);
+            } else if (n < 0 && errno == EINTR) {
+                continue;
+            } else {
+                return false;
+            }
+        }
+    }
+    return true;
+#else
+    copy_method_ = CopyMethod::ReadWrite;
+    std::vector<uint8_t> buffer(std::min<size_t>(nbytes, 8 << 20));
+    while (copied < nbytes) {
+        const auto n = pread(fd_,
+                             buffer.data(),
+                             std::min(nbytes - copied, buffer.size()),
+                             static_cast<off_t>(copied));
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0 ||
+            !write_all(dst,
+                       { std::span<const uint8_t>(buffer.data(),
+                                                  static_cast<size_t>(n)) },
+                       offset + copied)) {
+            return false;
+        }
+        copied += static_cast<size_t>(n);
+    }
+    return true;
+#endif
+}
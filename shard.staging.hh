@@ -0,0 +1,82 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace zarr {
+/**
+ * @brief Builds a shard in anonymous memory so that one process can prepare
+ * it and another commit it to its file.
+ *
+ * On Linux the shard is staged in a memfd, which is sealed against further
+ * changes once complete, so the committing process can trust that what it
+ * copies is what was prepared. Pass fd() to the committing process, e.g.
+ * across fork() or over a Unix socket, and attach to it with from_fd().
+ *
+ * commit() copies the shard into the target file in the kernel with
+ * copy_file_range, or sendfile where the two files' file systems do not
+ * support copying between them, so the data never passes through user
+ * space a second time. Elsewhere, the shard is staged in an unlinked
+ * temporary file, sealing only marks it complete, and commit() copies it
+ * with reads and writes. POSIX only.
+ */
+class ShardStaging
+{
+  public:
+    enum class CopyMethod
+    {
+        None,
+        CopyFileRange,
+        Sendfile,
+        ReadWrite,
+    };
+
+    /// Create an empty staging area. @p name only labels the memfd, e.g.
+    /// in /proc/<pid>/fd.
+    explicit ShardStaging(const std::string& name = "zarr-shard");
+
+    /// Attach to a staging area through a file descriptor, e.g. a memfd
+    /// inherited from the process that prepared it.
+    static ShardStaging from_fd(int fd);
+
+    ShardStaging(ShardStaging&& other) noexcept;
+    ShardStaging& operator=(ShardStaging&& other) = delete;
+    ShardStaging(const ShardStaging&) = delete;
+    ~ShardStaging();
+
+    int fd() const { return fd_; }
+
+    /// Size of the staged shard in bytes.
+    size_t size() const;
+
+    /// Stage @p buffers contiguously at @p offset into the shard. Fails once
+    /// sealed.
+    bool write_vectors(const std::vector<std::span<const uint8_t>>& buffers,
+                       size_t offset);
+
+    /// Make the staged shard immutable. On Linux, this applies to every
+    /// process holding the memfd.
+    void seal();
+    bool sealed() const;
+
+    /// Copy the staged shard into @p path at @p offset, creating the file if
+    /// necessary. At offset 0 the shard replaces the file's contents. The
+    /// shard must be sealed.
+    bool commit(const std::string& path, size_t offset = 0);
+
+    /// How the last commit() copied the shard.
+    CopyMethod copy_method() const { return copy_method_; }
+
+  private:
+    int fd_;
+    bool sealed_;
+    CopyMethod copy_method_;
+
+    explicit ShardStaging(int fd);
+
+    bool copy_to_(int dst, size_t offset);
+};
+} // namespace zarr
@@ -0,0 +1,366 @@
+#include "shm.ring.hh"
+
+#include <atomic>
+#include <cstddef>
+#include <cerrno>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+#include <thread>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free,
+              "Shared-memory ring needs address-free 64-bit atomics");
+
+namespace {
+constexpr uint64_t ring_magic = 0x474e495252415a5aULL; // "ZZARRING"
+
+size_t
+align_up(size_t size, size_t alignment) {
+    return (size + alignment - 1) / alignment * alignment;
+}
+
+// Whether @p layout, the leading fields of a ring's header, describes a
+// ring that fits in @p nbytes of shared memory.
+bool
+valid_layout(const uint64_t layout[5], size_t nbytes) {
+    const uint64_t magic = layout[0];
+    const uint64_t nslots = layout[1];
+    const uint64_t slot_size = layout[2];
+    const uint64_t slot_stride = layout[3];
+    const uint64_t data_offset = layout[4];
+    return magic == ring_magic && nslots >= 2 && slot_size > 0 &&
+           slot_stride >= slot_size && data_offset <= nbytes &&
+           nslots <= (nbytes - data_offset) / slot_stride;
+}
+
+std::string
+last_error() {
+    return strerror(errno);
+}
+
+// Poll @p ready until it holds or @p timeout passes: spin briefly, then
+// sleep in short steps so a stalled peer does not burn a core.
+template<typename Predicate>
+bool
+wait_until(Predicate ready, std::chrono::microseconds timeout) {
+    const auto deadline = std::chrono::steady_clock::now() + timeout;
+    for (int attempt = 0;; ++attempt) {
+        if (ready()) {
+            return true;
+        }
+        if (std::chrono::steady_clock::now() >= deadline) {
+            return false;
+        }
+        if (attempt < 64) {
+            std::this_thread::yield();
+        } else {
+            std::this_thread::sleep_for(std::chrono::microseconds(20));
+        }
+    }
+}
+} // namespace
+
+struct zarr::ShmRing::Header
+{
+    uint64_t magic;
+    uint64_t nslots;
+    uint64_t slot_size;
+    uint64_t slot_stride;
+    uint64_t data_offset;
+    std::atomic<uint32_t> producer_closed;
+    std::atomic<uint64_t> producer_waits;
+
+    // each cursor is written by one side only
+    alignas(64) std::atomic<uint64_t> write_pos;
+    alignas(64) std::atomic<uint64_t> read_pos;
+};
+
+// A slot for sequence s is free for the producer when its sequence is s,
+// committed when it is s + 1, and free again for s + nslots once released.
+struct zarr::ShmRing::SlotHeader
+{
+    std::atomic<uint64_t> sequence;
+    uint64_t nbytes;
+    uint64_t offset;
+};
+
+zarr::ShmRing::ShmRing(int fd, bool initialize, size_t nslots, size_t slot_size)
+  : fd_(fd)
+  , base_(MAP_FAILED)
+  , mapped_size_(0) {
+    const auto page_size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+
+    if (initialize) {
+        // with one slot, frame s's committed sequence s + 1 would read as
+        // free for frame s + 1, and the producer would overwrite it
+        if (nslots < 2 || slot_size == 0) {
+            close(fd_);
+            throw std::invalid_argument(
+              "Ring needs at least 2 slots and a nonzero slot size");
+        }
+
+        const size_t data_offset = align_up(
+          sizeof(Header) + nslots * sizeof(SlotHeader), page_size);
+        const size_t slot_stride = align_up(slot_size, page_size);
+        mapped_size_ = data_offset + nslots * slot_stride;
+
+        if (ftruncate(fd_, static_cast<off_t>(mapped_size_)) < 0) {
+            const auto err = last_error();
+            close(fd_);
+            throw std::runtime_error("Failed to size shared memory: " + err);
+        }
+    } else {
+        // check the layout another process wrote before mapping by it
+        struct stat st;
+        uint64_t layout[5]; // magic, nslots, slot_size, stride, data offset
+        static_assert(offsetof(Header, data_offset) == 4 * sizeof(uint64_t));
+        if (fstat(fd_, &st) < 0 ||
+            static_cast<size_t>(st.st_size) < sizeof(Header) ||
+            pread(fd_, layout, sizeof(layout), 0) !=
+              static_cast<ssize_t>(sizeof(layout)) ||
+            !valid_layout(layout, static_cast<size_t>(st.st_size))) {
+            close(fd_);
+            throw std::runtime_error("Shared memory is not a ring");
+        }
+        mapped_size_ = static_cast<size_t>(st.st_size);
+    }
+
+    base_ = mmap(
+      nullptr, mapped_size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+    if (base_ == MAP_FAILED) {
+        const auto err = last_error();
+        close(fd_);
+        throw std::runtime_error("Failed to map shared memory: " + err);
+    }
+
+    if (initialize) {
+        auto* header = new (base_) Header{};
+        header->nslots = nslots;
+        header->slot_size = slot_size;
+        header->slot_stride = align_up(slot_size, page_size);
+        header->data_offset = align_up(
+          sizeof(Header) + nslots * sizeof(SlotHeader), page_size);
+
+        auto* slots = reinterpret_cast<SlotHeader*>(header + 1);
+        for (size_t i = 0; i < nslots; ++i) {
+            auto* slot = new (slots + i) SlotHeader{};
+            slot->sequence.store(i, std::memory_order_relaxed);
+        }
+
+        // publish the layout last, so attachers never see a partial ring
+        std::atomic_thread_fence(std::memory_order_release);
+        header->magic = ring_magic;
+    }
+}
+
+zarr::ShmRing::ShmRing(ShmRing&& other) noexcept
+  : fd_(other.fd_)
+  , base_(other.base_)
+  , mapped_size_(other.mapped_size_) {
+    other.fd_ = -1;
+    other.base_ = MAP_FAILED;
+    other.mapped_size_ = 0;
+}
+
+zarr::ShmRing::~ShmRing() {
+    if (base_ != MAP_FAILED) {
+        munmap(base_, mapped_size_);
+    }
+    if (fd_ >= 0) {
+        close(fd_);
+    }
+}
+
+zarr::ShmRing
+zarr::ShmRing::create(const std::string& name,
+                      size_t nslots,
+                      size_t slot_size) {
+    const int fd = shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (fd < 0) {
+        throw std::runtime_error("Failed to create shared memory '" + name +
+                                 "': " + last_error());
+    }
+    return ShmRing(fd, true, nslots, slot_size);
+}
+
+zarr::ShmRing
+zarr::ShmRing::open(const std::string& name) {
+    const int fd = shm_open(name.c_str(), O_RDWR, 0600);
+    if (fd < 0) {
+        throw std::runtime_error("Failed to open shared memory '" + name +
+                                 "': " + last_error());
+    }
+    return ShmRing(fd, false, 0, 0);
+}
+
+void
+zarr::ShmRing::unlink(const std::string& name) {
+    shm_unlink(name.c_str());
+}
+
+#ifdef __linux__
+zarr::ShmRing
+zarr::ShmRing::create_memfd(size_t nslots, size_t slot_size) {
+    const int fd = memfd_create("zarr-shm-ring", 0);
+    if (fd < 0) {
+        throw std::runtime_error("Failed to create memfd: " + last_error());
+    }
+    return ShmRing(fd, true, nslots, slot_size);
+}
+#endif
+
+zarr::ShmRing
+zarr::ShmRing::from_fd(int fd) {
+    const int own_fd = dup(fd);
+    if (own_fd < 0) {
+        throw std::runtime_error("Failed to duplicate descriptor: " +
+                                 last_error());
+    }
+    return ShmRing(own_fd, false, 0, 0);
+}
+
+size_t
+zarr::ShmRing::nslots() const {
+    return header_()->nslots;
+}
+
+size_t
+zarr::ShmRing::slot_size() const {
+    return header_()->slot_size;
+}
+
+std::optional<zarr::ShmRing::Lease>
+zarr::ShmRing::acquire(std::chrono::microseconds timeout) {
+    auto* header = header_();
+    const uint64_t pos = header->write_pos.load(std::memory_order_relaxed);
+    auto* slot = slot_(pos);
+
+    const auto is_free = [slot, pos] {
+        return slot->sequence.load(std::memory_order_acquire) == pos;
+    };
+    if (!is_free()) {
+        header->producer_waits.fetch_add(1, std::memory_order_relaxed);
+        if (!wait_until(is_free, timeout)) {
+            return std::nullopt;
+        }
+    }
+
+    header->write_pos.store(pos + 1, std::memory_order_release);
+    return Lease{ pos, slot_data_(pos), header->slot_size };
+}
+
+void
+zarr::ShmRing::commit(const Lease& lease, size_t nbytes, uint64_t offset) {
+    if (nbytes > lease.capacity) {
+        throw std::length_error("Frame is larger than its slot");
+    }
+
+    auto* slot = slot_(lease.sequence);
+    slot->nbytes = nbytes;
+    slot->offset = offset;
+    slot->sequence.store(lease.sequence + 1, std::memory_order_release);
+}
+
+void
+zarr::ShmRing::close_producer() {
+    header_()->producer_closed.store(1, std::memory_order_release);
+}
+
+uint64_t
+zarr::ShmRing::producer_waits() const {
+    return header_()->producer_waits.load(std::memory_order_relaxed);
+}
+
+std::vector<zarr::ShmRing::Frame>
+zarr::ShmRing::peek(size_t max_frames, std::chrono::microseconds timeout) {
+    std::vector<Frame> frames;
+    const uint64_t pos = header_()->read_pos.load(std::memory_order_relaxed);
+
+    const auto is_committed = [this](uint64_t sequence) {
+        return slot_(sequence)->sequence.load(std::memory_order_acquire) ==
+               sequence + 1;
+    };
+    if (max_frames == 0 ||
+        !wait_until([&] { return is_committed(pos); }, timeout)) {
+        return frames;
+    }
+
+    for (uint64_t s = pos; frames.size() < max_frames && is_committed(s);
+         ++s) {
+        const auto* slot = slot_(s);
+        const std::span<const uint8_t> data(slot_data_(s), slot->nbytes);
+        frames.push_back({ s, data, slot->offset });
+    }
+    return frames;
+}
+
+void
+zarr::ShmRing::release(size_t nframes) {
+    auto* header = header_();
+    const uint64_t pos = header->read_pos.load(std::memory_order_relaxed);
+    for (uint64_t s = pos; s < pos + nframes; ++s) {
+        slot_(s)->sequence.store(s + header->nslots, std::memory_order_release);
+    }
+    header->read_pos.store(pos + nframes, std::memory_order_release);
+}
+
+size_t
+zarr::ShmRing::write_ready(VectorizedFileWriter& writer,
+                           size_t max_frames,
+                           std::chrono::microseconds timeout) {
+    const auto frames = peek(max_frames, timeout);
+
+    std::vector<std::span<const uint8_t>> buffers;
+    size_t first = 0;
+    while (first < frames.size()) {
+        buffers.clear();
+        buffers.push_back(frames[first].data);
+        uint64_t end = frames[first].offset + frames[first].data.size();
+
+        size_t last = first + 1;
+        while (last < frames.size() && frames[last].offset == end) {
+            buffers.push_back(frames[last].data);
+            end += frames[last].data.size();
+            ++last;
+        }
+
+        if (!writer.write_vectors(buffers, frames[first].offset)) {
+            throw std::runtime_error("Failed to write frames from ring");
+        }
+        first = last;
+    }
+
+    release(frames.size());
+    return frames.size();
+}
+
+bool
+zarr::ShmRing::drained() const {
+    const auto* header = header_();
+    return header->producer_closed.load(std::memory_order_acquire) &&
+           header->read_pos.load(std::memory_order_acquire) ==
+             header->write_pos.load(std::memory_order_acquire);
+}
+
+zarr::ShmRing::Header*
+zarr::ShmRing::header_() const {
+    return static_cast<Header*>(base_);
+}
+
+zarr::ShmRing::SlotHeader*
+zarr::ShmRing::slot_(uint64_t sequence) const {
+    auto* slots = reinterpret_cast<SlotHeader*>(header_() + 1);
+    return slots + sequence % header_()->nslots;
+}
+
+uint8_t*
+zarr::ShmRing::slot_data_(uint64_t sequence) const {
+    const auto* header = header_();
+    return static_cast<uint8_t*>(base_) + header->data_offset +
+           (sequence % header->nslots) * header->slot_stride;
+}
@@ -0,0 +1,127 @@
+#pragma once
+
+#include "vectorized.file.writer.hh"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace zarr {
+/**
+ * @brief Single-producer, single-consumer ring of fixed-size frame slots in
+ * shared memory, for handing frames from an acquisition process to a writer
+ * process without copying them through a socket.
+ *
+ * The producer leases a free slot, fills it in place and commits it with the
+ * frame's length and destination file offset. The consumer maps the same
+ * memory, takes runs of committed slots in sequence order and passes them
+ * straight to write_vectors as iovecs, then releases them back to the
+ * producer. Every slot carries a sequence number, so frames are consumed in
+ * the order they were leased and a slot is never reused before it has been
+ * written. When all slots are in use, acquire() waits (backpressure) up to
+ * its timeout.
+ *
+ * Ring state lives in the shared mapping, so either side may attach to an
+ * existing ring. Waiting is by polling with backoff, which works across
+ * processes without futexes. POSIX only.
+ */
+class ShmRing
+{
+  public:
+    struct Lease
+    {
+        uint64_t sequence;
+        uint8_t* data;
+        size_t capacity;
+    };
+
+    struct Frame
+    {
+        uint64_t sequence;
+        std::span<const uint8_t> data;
+        uint64_t offset;
+    };
+
+    /// Create a named ring of @p nslots slots, at least 2, with shm_open.
+    /// Fails if @p name already exists.
+    static ShmRing create(const std::string& name,
+                          size_t nslots,
+                          size_t slot_size);
+
+    /// Attach to a ring created with create().
+    static ShmRing open(const std::string& name);
+
+    /// Remove the name of a ring created with create().
+    static void unlink(const std::string& name);
+
+#ifdef __linux__
+    /// Create an anonymous ring backed by a memfd. Share it by passing fd()
+    /// to a child process or over a Unix socket.
+    static ShmRing create_memfd(size_t nslots, size_t slot_size);
+#endif
+
+    /// Attach to a ring through a file descriptor, e.g. an inherited memfd.
+    static ShmRing from_fd(int fd);
+
+    ShmRing(ShmRing&& other) noexcept;
+    ShmRing& operator=(ShmRing&& other) = delete;
+    ShmRing(const ShmRing&) = delete;
+    ~ShmRing();
+
+    int fd() const { return fd_; }
+    size_t nslots() const;
+    size_t slot_size() const;
+
+    // producer side
+
+    /// Lease the next free slot, waiting up to @p timeout for one.
+    std::optional<Lease> acquire(std::chrono::microseconds timeout);
+
+    /// Publish a leased slot holding @p nbytes to be written at @p offset.
+    void commit(const Lease& lease, size_t nbytes, uint64_t offset);
+
+    /// Signal that no more frames will be committed.
+    void close_producer();
+
+    /// Number of times acquire() had to wait for a free slot.
+    uint64_t producer_waits() const;
+
+    // consumer side
+
+    /// Up to @p max_frames consecutive committed frames, waiting up to
+    /// @p timeout for the first. The frames stay valid until release().
+    std::vector<Frame> peek(size_t max_frames,
+                            std::chrono::microseconds timeout);
+
+    /// Return the @p nframes oldest peeked frames to the producer.
+    void release(size_t nframes);
+
+    /// Write up to @p max_frames committed frames with one write_vectors call
+    /// per run of contiguous offsets, then release them. Returns the number
+    /// of frames written; throws if a write fails.
+    size_t write_ready(VectorizedFileWriter& writer,
+                       size_t max_frames,
+                       std::chrono::microseconds timeout);
+
+    /// True once the producer has closed and every frame has been released.
+    bool drained() const;
+
+  private:
+    struct Header;
+    struct SlotHeader;
+
+    int fd_;
+    void* base_;
+    size_t mapped_size_;
+
+    ShmRing(int fd, bool initialize, size_t nslots, size_t slot_size);
+
+    Header* header_() const;
+    SlotHeader* slot_(uint64_t sequence) const;
+    uint8_t* slot_data_(uint64_t sequence) const;
+};
+} // namespace zarr
@@ -0,0 +1,233 @@
+#include "striped.shard.writer.hh"
+#include "vectorized.file.writer.hh"
+
+#include <filesystem>
+#include <iostream>
+#include <stdexcept>
+
+namespace fs = std::filesystem;
+
+zarr::StripedShardWriter::Target::Target(const std::string& dir,
+                                         size_t queue_capacity)
+  : directory(dir)
+  , queue(queue_capacity)
+  , wake(0)
+  , submitted(0)
+  , completed(0)
+  , outstanding_bytes(0)
+  , shards_written(0)
+  , bytes_written(0)
+  , failed_writes(0)
+  , busy_ns(0) {
+}
+
+zarr::StripedShardWriter::StripedShardWriter(
+  const std::vector<std::string>& directories,
+  size_t queue_capacity)
+  : next_(0)
+  , stopping_(false)
+  , submitting_(0) {
+    if (directories.empty()) {
+        throw std::invalid_argument("Striping needs at least one directory");
+    }
+
+    for (const auto& directory : directories) {
+        fs::create_directories(directory);
+        targets_.push_back(
+          std::make_unique<Target>(directory, queue_capacity));
+    }
+    for (auto& target : targets_) {
+        target->thread = std::thread([this, t = target.get()] { run_(*t); });
+    }
+}
+
+zarr::StripedShardWriter::~StripedShardWriter() {
+    stop();
+}
+
+std::string
+zarr::StripedShardWriter::write_shard(
+  const std::string& name,
+  std::vector<std::vector<uint8_t>>&& chunks) {
+    // stop() waits for calls that get past this check, so that it drains
+    // whatever they queue; either it sees the count or we see stopping_
+    submitting_.fetch_add(1);
+    const auto done = [this] {
+        submitting_.fetch_sub(1);
+        submitting_.notify_all();
+    };
+    if (stopping_.load()) {
+        done();
+        return {};
+    }
+
+    size_t nbytes = 0;
+    for (const auto& chunk : chunks) {
+        nbytes += chunk.size();
+    }
+
+    auto& target = place_();
+    const auto path = (fs::path(target.directory) / name).string();
+
+    // count the shard against its target before queueing, so concurrent
+    // placements see the load
+    target.outstanding_bytes.fetch_add(nbytes, std::memory_order_relaxed);
+
+    ShardJob job{ path, std::move(chunks), nbytes };
+    // read before pushing, so a shard completing in between is not missed
+    auto completed = target.completed.load(std::memory_order_acquire);
+    while (!target.queue.try_push(std::move(job))) {
+        if (stopping_.load(std::memory_order_acquire)) {
+            target.outstanding_bytes.fetch_sub(nbytes,
+                                               std::memory_order_relaxed);
+            chunks = std::move(job.chunks); // hand the chunks back
+            done();
+            return {};
+        }
+        // full; sleep until the target's writer, which is still running
+        // while we count as submitting, finishes a shard
+        target.completed.wait(completed, std::memory_order_acquire);
+        completed = target.completed.load(std::memory_order_acquire);
+    }
+
+    target.submitted.fetch_add(1, std::memory_order_release);
+    target.wake.fetch_add(1, std::memory_order_release);
+    target.wake.notify_one();
+    done();
+    return path;
+}
+
+void
+zarr::StripedShardWriter::flush() {
+    for (auto& target : targets_) {
+        const auto goal = target->submitted.load(std::memory_order_acquire);
+        auto completed = target->completed.load(std::memory_order_acquire);
+        while (completed < goal) {
+            target->completed.wait(completed, std::memory_order_acquire);
+            completed = target->completed.load(std::memory_order_acquire);
+        }
+    }
+}
+
+void
+zarr::StripedShardWriter::stop() {
+    if (stopping_.exchange(true)) {
+        return;
+    }
+
+    // let calls already past the stop check finish queueing
+    for (auto n = submitting_.load(); n != 0; n = submitting_.load()) {
+        submitting_.wait(n);
+    }
+
+    for (auto& target : targets_) {
+        target->wake.fetch_add(1, std::memory_order_release);
+        target->wake.notify_one();
+    }
+    for (auto& target : targets_) {
+        if (target->thread.joinable()) {
+            target->thread.join();
+        }
+
+        // pick up anything pushed while the writer thread was exiting
+        ShardJob job;
+        while (target->queue.try_pop(job)) {
+            write_(*target, job);
+        }
+    }
+}
+
+std::vector<zarr::StripedShardWriter::TargetStats>
+zarr::StripedShardWriter::stats() const {
+    std::vector<TargetStats> stats;
+    for (const auto& target : targets_) {
+        TargetStats s;
+        s.directory = target->directory;
+        s.shards_written =
+          target->shards_written.load(std::memory_order_relaxed);
+        s.bytes_written = target->bytes_written.load(std::memory_order_relaxed);
+        s.failed_writes = target->failed_writes.load(std::memory_order_relaxed);
+        s.busy_seconds =
+          static_cast<double>(
+            target->busy_ns.load(std::memory_order_relaxed)) /
+          1e9;
+        stats.push_back(s);
+    }
+    return stats;
+}
+
+zarr::StripedShardWriter::Target&
+zarr::StripedShardWriter::place_() {
+    // least outstanding bytes, scanning from a rotating start so that
+    // equally loaded targets take turns
+    const size_t start = next_.fetch_add(1, std::memory_order_relaxed);
+    Target* best = nullptr;
+    uint64_t best_load = 0;
+    for (size_t i = 0; i < targets_.size(); ++i) {
+        auto* target = targets_[(start + i) % targets_.size()].get();
+        const auto load =
+          target->outstanding_bytes.load(std::memory_order_relaxed);
+        if (best == nullptr || load < best_load) {
+            best = target;
+            best_load = load;
+        }
+    }
+    return *best;
+}
+
+void
+zarr::StripedShardWriter::run_(Target& target) {
+    while (true) {
+        // read the wake counter before draining so that a submit racing
+        // with an empty drain still wakes us
+        const auto wake = target.wake.load(std::memory_order_acquire);
+
+        ShardJob job;
+        bool wrote = false;
+        while (target.queue.try_pop(job)) {
+            write_(target, job);
+            wrote = true;
+        }
+        if (wrote) {
+            continue;
+        }
+
+        if (stopping_.load(std::memory_order_acquire)) {
+            break;
+        }
+        target.wake.wait(wake, std::memory_order_acquire);
+    }
+}
+
+void
+zarr::StripedShardWriter::write_(Target& target, ShardJob& job) {
+    const auto start = std::chrono::steady_clock::now();
+    bool ok = false;
+    try {
+        fs::create_directories(fs::path(job.path).parent_path());
+        // a rewritten shard may be smaller than the one it replaces
+        FileOpenOptions options;
+        options.truncate = true;
+        VectorizedFileWriter writer(job.path, options);
+        ok = writer.write_vectors(job.chunks, 0);
+    } catch (const std::exception& exc) {
+        std::cerr << "Failed to write shard '" << job.path
+                  << "': " << exc.what() << std::endl;
+    }
+    const auto elapsed = std::chrono::steady_clock::now() - start;
+
+    target.busy_ns.fetch_add(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count(),
+      std::memory_order_relaxed);
+    if (ok) {
+        target.shards_written.fetch_add(1, std::memory_order_relaxed);
+        target.bytes_written.fetch_add(job.nbytes, std::memory_order_relaxed);
+    } else {
+        target.failed_writes.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    job.chunks.clear();
+    target.outstanding_bytes.fetch_sub(job.nbytes, std::memory_order_relaxed);
+    target.completed.fetch_add(1, std::memory_order_release);
+    target.completed.notify_all();
+}
@@ -0,0 +1,101 @@
+#pragma once
+
+#include "mpsc.queue.hh"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace zarr {
+/**
+ * @brief Spreads whole shards across a set of target directories, one per
+ * storage device, each with its own queue and writer thread.
+ *
+ * Each shard goes to the target with the fewest bytes queued or being
+ * written (ties rotate), so a slow or busy device gets fewer shards. Shards
+ * are written whole, with one write_vectors call, so every shard stays a
+ * single readable file; the caller records where each one landed.
+ *
+ * Give one directory per device: targets on the same device share its
+ * bandwidth and only add contention.
+ */
+class StripedShardWriter
+{
+  public:
+    struct TargetStats
+    {
+        std::string directory;
+        uint64_t shards_written = 0;
+        uint64_t bytes_written = 0;
+        uint64_t failed_writes = 0;
+        double busy_seconds = 0; // time spent writing
+    };
+
+    /// Creates @p directories if need be. @p queue_capacity is per target
+    /// and must be a power of 2.
+    explicit StripedShardWriter(const std::vector<std::string>& directories,
+                                size_t queue_capacity = 16);
+    ~StripedShardWriter();
+
+    StripedShardWriter(const StripedShardWriter&) = delete;
+    StripedShardWriter& operator=(const StripedShardWriter&) = delete;
+
+    /// Queue @p chunks to be written, in order, as the file @p name (which
+    /// may contain subdirectories) under the least-loaded target. Returns
+    /// the path the shard will be written to, or an empty string, leaving
+    /// @p chunks intact, once stop() has been called. Sleeps while that
+    /// target's queue is full.
+    std::string write_shard(const std::string& name,
+                            std::vector<std::vector<uint8_t>>&& chunks);
+
+    /// Block until every shard queued so far has been written.
+    void flush();
+
+    /// Write out everything queued, then stop the writer threads.
+    void stop();
+
+    size_t ntargets() const { return targets_.size(); }
+    std::vector<TargetStats> stats() const;
+
+  private:
+    struct ShardJob
+    {
+        std::string path;
+        std::vector<std::vector<uint8_t>> chunks;
+        size_t nbytes = 0;
+    };
+
+    struct Target
+    {
+        explicit Target(const std::string& dir, size_t queue_capacity);
+
+        const std::string directory;
+        MpscQueue<ShardJob> queue;
+
+        std::atomic<uint64_t> wake;
+        std::atomic<uint64_t> submitted;
+        std::atomic<uint64_t> completed; // written or failed
+        std::atomic<uint64_t> outstanding_bytes;
+
+        std::atomic<uint64_t> shards_written;
+        std::atomic<uint64_t> bytes_written;
+        std::atomic<uint64_t> failed_writes;
+        std::atomic<uint64_t> busy_ns;
+
+        std::thread thread;
+    };
+
+    std::vector<std::unique_ptr<Target>> targets_;
+    std::atomic<size_t> next_; // rotates ties between equally loaded targets
+    std::atomic<bool> stopping_;
+    std::atomic<size_t> submitting_; // write_shard calls past the stop check
+
+    Target& place_();
+    void run_(Target& target);
+    void write_(Target& target, ShardJob& job);
+};
+} // namespace zarr
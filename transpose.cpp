@@ -0,0 +1,238 @@
+#include "transpose.hh"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+#if defined(__SSE__) || defined(_M_X64)
+#include <xmmintrin.h>
+#define TRANSPOSE_SSE 1
+#endif
+
+namespace {
+// Largest tile side, in elements, handled without further splitting. A
+// 32 x 32 tile of 8-byte elements is 8 KiB, so input and output tiles fit
+// in L1 together.
+constexpr size_t tile = 32;
+
+template<typename T>
+void
+transpose_tile_scalar(const T* in,
+                      size_t in_stride,
+                      T* out,
+                      size_t out_stride,
+                      size_t rows,
+                      size_t cols) {
+    for (size_t c = 0; c < cols; ++c) {
+        T* dst = out + c * out_stride;
+#pragma omp simd
+        for (size_t r = 0; r < rows; ++r) {
+            dst[r] = in[r * in_stride + c];
+        }
+    }
+}
+
+template<typename T>
+void
+transpose_tile(const T* in,
+               size_t in_stride,
+               T* out,
+               size_t out_stride,
+               size_t rows,
+               size_t cols) {
+    transpose_tile_scalar(in, in_stride, out, out_stride, rows, cols);
+}
+
+#ifdef TRANSPOSE_SSE
+// 4-byte elements: transpose 4 x 4 blocks in registers.
+template<>
+void
+transpose_tile<uint32_t>(const uint32_t* in,
+                         size_t in_stride,
+                         uint32_t* out,
+                         size_t out_stride,
+                         size_t rows,
+                         size_t cols) {
+    const size_t rows4 = rows & ~size_t(3);
+    const size_t cols4 = cols & ~size_t(3);
+
+    for (size_t r = 0; r < rows4; r += 4) {
+        for (size_t c = 0; c < cols4; c += 4) {
+            const auto* src =
+              reinterpret_cast<const float*>(in + r * in_stride + c);
+            __m128 row0 = _mm_loadu_ps(src);
+            __m128 row1 = _mm_loadu_ps(src + in_stride);
+            __m128 row2 = _mm_loadu_ps(src + 2 * in_stride);
+            __m128 row3 = _mm_loadu_ps(src + 3 * in_stride);
+            _MM_TRANSPOSE4_PS(row0, row1, row2, row3);
+
+            auto* dst = reinterpret_cast<float*>(out + c * out_stride + r);
+            _mm_storeu_ps(dst, row0);
+            _mm_storeu_ps(dst + out_stride, row1);
+            _mm_storeu_ps(dst + 2 * out_stride, row2);
+            _mm_storeu_ps(dst + 3 * out_stride, row3);
+        }
+    }
+
+    // ragged edges: trailing columns of every row, then trailing rows
+    transpose_tile_scalar(in + cols4,
+                          in_stride,
+                          out + cols4 * out_stride,
+                          out_stride,
+                          rows,
+                          cols - cols4);
+    transpose_tile_scalar(in + rows4 * in_stride,
+                          in_stride,
+                          out + rows4,
+                          out_stride,
+                          rows - rows4,
+                          cols4);
+}
+#endif
+
+template<typename T>
+void
+transpose_recursive(const T* in,
+                    size_t in_stride,
+                    T* out,
+                    size_t out_stride,
+                    size_t rows,
+                    size_t cols) {
+    if (rows <= tile && cols <= tile) {
+        transpose_tile(in, in_stride, out, out_stride, rows, cols);
+    } else if (rows >= cols) {
+        const size_t half = rows / 2;
+        transpose_recursive(in, in_stride, out, out_stride, half, cols);
+        transpose_recursive(in + half * in_stride,
+                            in_stride,
+                            out + half,
+                            out_stride,
+                            rows - half,
+                            cols);
+    } else {
+        const size_t half = cols / 2;
+        transpose_recursive(in, in_stride, out, out_stride, rows, half);
+        transpose_recursive(in + half,
+                            in_stride,
+                            out + half * out_stride,
+                            out_stride,
+                            rows,
+                            cols - half);
+    }
+}
+
+// (nz, ny, nx) in C order -> (nx, ny, nz) in C order: each y plane is an
+// independent strided 2D transpose of its (z, x) slice.
+template<typename T>
+void
+reverse_axes_3d(const T* in, size_t nz, size_t ny, size_t nx, T* out) {
+    const auto nplanes = static_cast<long long>(ny);
+#pragma omp parallel for
+    for (long long y = 0; y < nplanes; ++y) {
+        transpose_recursive(
+          in + y * nx, ny * nx, out + y * nz, ny * nz, nz, nx);
+    }
+}
+
+template<typename T>
+void
+reverse_axes(const uint8_t* in,
+             const std::vector<size_t>& shape,
+             uint8_t* out) {
+    const auto* src = reinterpret_cast<const T*>(in);
+    auto* dst = reinterpret_cast<T*>(out);
+
+    switch (shape.size()) {
+        case 1:
+            memcpy(dst, src, shape[0] * sizeof(T));
+            break;
+        case 2:
+            transpose_recursive(
+              src, shape[1], dst, shape[0], shape[0], shape[1]);
+            break;
+        case 3:
+            reverse_axes_3d(src, shape[0], shape[1], shape[2], dst);
+            break;
+        default:
+            throw std::invalid_argument(
+              "Only 1, 2 and 3 dimensional transposes are supported");
+    }
+}
+
+size_t
+element_count(const std::vector<size_t>& shape) {
+    size_t n = 1;
+    for (const auto& extent : shape) {
+        n *= extent;
+    }
+    return n;
+}
+} // namespace
+
+void
+zarr::transpose_2d(const uint8_t* in,
+                   size_t rows,
+                   size_t cols,
+                   size_t bytes_per_element,
+                   uint8_t* out) {
+    c_to_f_order(in, { rows, cols }, bytes_per_element, out);
+}
+
+void
+zarr::c_to_f_order(const uint8_t* in,
+                   const std::vector<size_t>& shape,
+                   size_t bytes_per_element,
+                   uint8_t* out) {
+    switch (bytes_per_element) {
+        case 1:
+            reverse_axes<uint8_t>(in, shape, out);
+            break;
+        case 2:
+            reverse_axes<uint16_t>(in, shape, out);
+            break;
+        case 4:
+            reverse_axes<uint32_t>(in, shape, out);
+            break;
+        case 8:
+            reverse_axes<uint64_t>(in, shape, out);
+            break;
+        default:
+            throw std::invalid_argument("Unsupported element size: " +
+                                        std::to_string(bytes_per_element));
+    }
+}
+
+void
+zarr::f_to_c_order(const uint8_t* in,
+                   const std::vector<size_t>& shape,
+                   size_t bytes_per_element,
+                   uint8_t* out) {
+    // F order over shape is C order over the reversed shape
+    c_to_f_order(in,
+                 std::vector<size_t>(shape.rbegin(), shape.rend()),
+                 bytes_per_element,
+                 out);
+}
+
+zarr::ChunkStage
+zarr::c_to_f_order_stage(const std::vector<size_t>& shape,
+                         size_t bytes_per_element) {
+    const size_t nbytes = element_count(shape) * bytes_per_element;
+    return [shape, bytes_per_element, nbytes](std::vector<uint8_t>& chunk) {
+        if (chunk.size() != nbytes) {
+            throw std::invalid_argument("Chunk does not match the shape");
+        }
+        auto& out = stage_scratch();
+        out.resize(nbytes);
+        c_to_f_order(chunk.data(), shape, bytes_per_element, out.data());
+        chunk.swap(out);
+    };
+}
+
+zarr::ChunkStage
+zarr::f_to_c_order_stage(const std::vector<size_t>& shape,
+                         size_t bytes_per_element) {
+    return c_to_f_order_stage(
+      std::vector<size_t>(shape.rbegin(), shape.rend()), bytes_per_element);
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "chunk.pipeline.hh"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace zarr {
+/**
+ * @brief Transpose a row-major @p rows x @p cols matrix of elements of
+ * @p bytes_per_element bytes (1, 2, 4 or 8) into @p out, which must not
+ * alias @p in.
+ *
+ * The matrix is split recursively along its longer side until tiles fit in
+ * L1, so both the strided reads and the strided writes stay cache-resident
+ * whatever the shape.
+ */
+void
+transpose_2d(const uint8_t* in,
+             size_t rows,
+             size_t cols,
+             size_t bytes_per_element,
+             uint8_t* out);
+
+/**
+ * @brief Convert a C-order (last index fastest) array of @p shape to F-order
+ * (first index fastest), i.e., reverse its axes. Supports up to 3 dimensions.
+ */
+void
+c_to_f_order(const uint8_t* in,
+             const std::vector<size_t>& shape,
+             size_t bytes_per_element,
+             uint8_t* out);
+
+/// Inverse of c_to_f_order; @p shape is the C-order shape.
+void
+f_to_c_order(const uint8_t* in,
+             const std::vector<size_t>& shape,
+             size_t bytes_per_element,
+             uint8_t* out);
+
+// Chunk stages for a ChunkPipeline. Chunks must have exactly @p shape.
+ChunkStage
+c_to_f_order_stage(const std::vector<size_t>& shape, size_t bytes_per_element);
+
+ChunkStage
+f_to_c_order_stage(const std::vector<size_t>& shape, size_t bytes_per_element);
+} // namespace zarr
@@ -1,8 +1,20 @@
 #include "vectorized.file.writer.hh"
 
+#ifndef _WIN32
+#include "fault.injector.hh"
+
+#include <sys/stat.h>
+#endif
+
+#include <algorithm>
+#include <chrono>
+#include <climits> // IOV_MAX
 #include <cstdint>
+#include <cstdlib>
 #include <cstring>
 #include <iostream>
+#include <memory>
+#include <thread>
 
 namespace {
 #ifdef _WIN32
@@ -33,69 +45,123 @@ namespace {
         return message;
     }
 
-    size_t
-    get_sector_size(const std::string& path)
+    HANDLE
+    open_file(const std::string& path,
+              const zarr::FileOpenOptions& options)
     {
-        // Get volume root path
-        char volume_path[MAX_PATH];
-        if (!GetVolumePathNameA(path.c_str(), volume_path, MAX_PATH)) {
-            return 0;
-        }
+        return CreateFileA(path.c_str(),
+                           GENERIC_WRITE,
+                           0, // No sharing
+                           nullptr,
+                           options.truncate ? CREATE_ALWAYS : OPEN_ALWAYS,
+                           FILE_FLAG_OVERLAPPED | FILE_FLAG_NO_BUFFERING |
+                             FILE_FLAG_SEQUENTIAL_SCAN,
+                           nullptr);
+    }
+#else
 
-        DWORD sectors_per_cluster;
-        DWORD bytes_per_sector;
-        DWORD number_of_free_clusters;
-        DWORD total_number_of_clusters;
+    std::string
+    get_last_error_as_string() {
+        return strerror(errno);
+    }
 
-        if (!GetDiskFreeSpaceA(volume_path,
-                               &sectors_per_cluster,
-                               &bytes_per_sector,
-                               &number_of_free_clusters,
-                               &total_number_of_clusters)) {
-            return 0;
+    int
+    open_file(const std::string& path,
+              const zarr::FileOpenOptions& options) {
+        int flags = O_WRONLY | O_CREAT;
+        if (options.truncate) {
+            flags |= O_TRUNC;
+        }
+        if (options.close_on_exec) {
+            flags |= O_CLOEXEC;
+        }
+#ifdef O_DIRECT
+        if (options.direct) {
+            flags |= O_DIRECT;
         }
+#endif
 
-        return bytes_per_sector;
+        int fd = -1;
+#ifdef O_NOATIME
+        // only the file's owner may set O_NOATIME
+        if (options.no_atime) {
+            fd = open(path.c_str(), flags | O_NOATIME, 0644);
+            if (fd < 0 && errno != EPERM) {
+                return fd;
+            }
+        }
+#endif
+        if (fd < 0) {
+            fd = open(path.c_str(), flags, 0644);
+        }
+#if defined(__APPLE__)
+        if (fd >= 0 && options.direct) {
+            fcntl(fd, F_NOCACHE, 1);
+        }
+#endif
+        return fd;
     }
+
+    // What O_DIRECT requires of buffers, sizes and offsets; 0 without it.
+    // F_NOCACHE on macOS requires nothing.
+    size_t
+    direct_alignment(const zarr::FileOpenOptions& options,
+                     const zarr::DeviceInfo& device) {
+#ifdef O_DIRECT
+        return options.direct ? device.direct_io_alignment() : 0;
 #else
+        return 0;
+#endif
+    }
 
-    std::string
-    get_last_error_as_string() {
-        return strerror(errno);
+    bool
+    is_aligned(const std::vector<std::span<const uint8_t>>& buffers,
+               size_t alignment) {
+        for (const auto& buffer : buffers) {
+            if (reinterpret_cast<uintptr_t>(buffer.data()) % alignment != 0 ||
+                buffer.size() % alignment != 0) {
+                return false;
+            }
+        }
+        return true;
     }
 
+    struct AlignedFree
+    {
+        void operator()(uint8_t* p) const { free(p); }
+    };
+
 #endif
 } // namespace
 
-zarr::VectorizedFileWriter::VectorizedFileWriter(const std::string &path) {
+zarr::VectorizedFileWriter::VectorizedFileWriter(
+  const std::string &path,
+  const FileOpenOptions &options)
+  : limiter_(nullptr) {
 #ifdef _WIN32
     SYSTEM_INFO si;
     GetSystemInfo(&si);
     page_size_ = si.dwPageSize;
 
-    sector_size_ = get_sector_size(path);
+    device_ = probe_device(path);
+    sector_size_ = device_.dio_offset_alignment;
     if (sector_size_ == 0) {
         throw std::runtime_error("Failed to get sector size");
     }
 
-    handle_ = CreateFileA(path.c_str(),
-                          GENERIC_WRITE,
-                          0, // No sharing
-                          nullptr,
-                          OPEN_ALWAYS,
-                          FILE_FLAG_OVERLAPPED | FILE_FLAG_NO_BUFFERING |
-                            FILE_FLAG_SEQUENTIAL_SCAN,
-                          nullptr);
+    handle_ = open_file(path, options);
     if (handle_ == INVALID_HANDLE_VALUE) {
         auto err = get_last_error_as_string();
         throw std::runtime_error("Failed to open file '" + path + "': " + err);
     }
 #else
     page_size_ = sysconf(_SC_PAGESIZE);
-    fd_ = open(path.c_str(), O_WRONLY | O_CREAT, 0644);
+    fd_ = open_file(path, options);
     if (fd_ < 0) {
         throw std::runtime_error("Failed to open file: " + path);
     }
+    device_ = probe_device(fd_);
+    direct_alignment_ = direct_alignment(options, device_);
 #endif
 }
 
@@ -111,11 +177,150 @@ zarr::VectorizedFileWriter::~VectorizedFileWriter() {
 #endif
 }
 
+void
+zarr::VectorizedFileWriter::reopen(const std::string &path,
+                                   const FileOpenOptions &options) {
+    std::lock_guard<std::mutex> lock(mutex_);
+#ifdef _WIN32
+    const auto device = probe_device(path);
+    const auto sector_size = device.dio_offset_alignment;
+    if (sector_size == 0) {
+        throw std::runtime_error("Failed to get sector size");
+    }
+
+    HANDLE handle = open_file(path, options);
+    if (handle == INVALID_HANDLE_VALUE) {
+        auto err = get_last_error_as_string();
+        throw std::runtime_error("Failed to open file '" + path + "': " + err);
+    }
+
+    if (handle_ != INVALID_HANDLE_VALUE) {
+        CloseHandle(handle_);
+    }
+    handle_ = handle;
+    sector_size_ = sector_size;
+    device_ = device;
+#else
+    const int fd = open_file(path, options);
+    if (fd < 0) {
+        throw std::runtime_error("Failed to open file: " + path);
+    }
+
+    if (fd_ >= 0) {
+        close(fd_);
+    }
+    fd_ = fd;
+    device_ = probe_device(fd_);
+    direct_alignment_ = direct_alignment(options, device_);
+#endif
+}
+
+bool
+zarr::VectorizedFileWriter::truncate(size_t nbytes) {
+    std::lock_guard<std::mutex> lock(mutex_);
+#ifdef _WIN32
+    FILE_END_OF_FILE_INFO info;
+    info.EndOfFile.QuadPart = static_cast<LONGLONG>(nbytes);
+    if (!SetFileInformationByHandle(
+          handle_, FileEndOfFileInfo, &info, sizeof(info))) {
+        std::cerr << "Failed to truncate file: "
+                  << get_last_error_as_string() << std::endl;
+        return false;
+    }
+#else
+    if (ftruncate(fd_, static_cast<off_t>(nbytes)) < 0) {
+        std::cerr << "Failed to truncate file: "
+                  << get_last_error_as_string() << std::endl;
+        return false;
+    }
+#endif
+    return true;
+}
+
+bool
+zarr::VectorizedFileWriter::preallocate(size_t nbytes) {
+    std::lock_guard<std::mutex> lock(mutex_);
+#ifdef _WIN32
+    // allocation only; grow the file too, as posix_fallocate does
+    FILE_ALLOCATION_INFO allocation;
+    allocation.AllocationSize.QuadPart = static_cast<LONGLONG>(nbytes);
+    LARGE_INTEGER size;
+    if (!SetFileInformationByHandle(handle_,
+                                    FileAllocationInfo,
+                                    &allocation,
+                                    sizeof(allocation)) ||
+        !GetFileSizeEx(handle_, &size)) {
+        std::cerr << "Failed to preallocate file: "
+                  << get_last_error_as_string() << std::endl;
+        return false;
+    }
+    if (static_cast<size_t>(size.QuadPart) < nbytes) {
+        FILE_END_OF_FILE_INFO end;
+        end.EndOfFile.QuadPart = static_cast<LONGLONG>(nbytes);
+        if (!SetFileInformationByHandle(
+              handle_, FileEndOfFileInfo, &end, sizeof(end))) {
+            std::cerr << "Failed to extend file: "
+                      << get_last_error_as_string() << std::endl;
+            return false;
+        }
+    }
+#elif defined(__APPLE__)
+    fstore_t store = {
+        F_ALLOCATECONTIG | F_ALLOCATEALL, F_PEOFPOSMODE, 0,
+        static_cast<off_t>(nbytes), 0
+    };
+    if (fcntl(fd_, F_PREALLOCATE, &store) < 0) {
+        store.fst_flags = F_ALLOCATEALL; // contiguous space not available
+        if (fcntl(fd_, F_PREALLOCATE, &store) < 0) {
+            std::cerr << "Failed to preallocate file: "
+                      << get_last_error_as_string() << std::endl;
+            return false;
+        }
+    }
+
+    struct stat st;
+    if (fstat(fd_, &st) < 0 ||
+        (static_cast<size_t>(st.st_size) < nbytes &&
+         ftruncate(fd_, static_cast<off_t>(nbytes)) < 0)) {
+        std::cerr << "Failed to extend file: " << get_last_error_as_string()
+                  << std::endl;
+        return false;
+    }
+#else
+    const int err = posix_fallocate(fd_, 0, static_cast<off_t>(nbytes));
+    if (err != 0) {
+        std::cerr << "Failed to preallocate file: " << strerror(err)
+                  << std::endl;
+        return false;
+    }
+#endif
+    return true;
+}
+
 bool
 zarr::VectorizedFileWriter::write_vectors(
         const std::vector<std::vector<uint8_t>> &buffers,
         size_t offset) {
+    std::vector<std::span<const uint8_t>> spans(buffers.begin(), buffers.end());
+    return write_vectors(spans, offset);
+}
+
+bool
+zarr::VectorizedFileWriter::write_vectors(
+        const std::vector<std::span<const uint8_t>> &buffers,
+        size_t offset) {
+    return write_vectors(buffers, offset, WriteBounds{}) == WriteStatus::Ok;
+}
+
+zarr::WriteStatus
+zarr::VectorizedFileWriter::write_vectors(
+        const std::vector<std::span<const uint8_t>> &buffers,
+        size_t offset,
+        const WriteBounds &bounds) {
     std::lock_guard<std::mutex> lock(mutex_);
+    if (const auto status = bounds.check(); status != WriteStatus::Ok) {
+        return status;
+    }
     bool retval{true};
 
 #ifdef _WIN32
@@ -129,13 +334,13 @@ zarr::VectorizedFileWriter::write_vectors(
         std::cerr << "Aligned size is less than total bytes to write: "
                   << nbytes_aligned << " < " << total_bytes_to_write
                   << std::endl;
-        return false;
+        return WriteStatus::Failed;
     }
 
     auto* aligned_ptr =
       static_cast<uint8_t*>(_aligned_malloc(nbytes_aligned, page_size_));
     if (!aligned_ptr) {
-        return false;
+        return WriteStatus::Failed;
     }
 
     auto* cur = aligned_ptr;
@@ -160,6 +365,7 @@ zarr::VectorizedFileWriter::write_vectors(
 
     DWORD bytes_written;
 
+    throttle_(nbytes_aligned);
     if (!WriteFileGather(
           handle_, segments.data(), nbytes_aligned, nullptr, &overlapped)) {
         if (GetLastError() != ERROR_IO_PENDING) {
@@ -178,45 +384,217 @@ zarr::VectorizedFileWriter::write_vectors(
 
     _aligned_free(aligned_ptr);
 #else
-    std::vector<struct iovec> iovecs(buffers.size());
+    // O_DIRECT rejects unaligned buffers and sizes, so stage such writes
+    // through one aligned, zero-padded copy
+    std::vector<std::span<const uint8_t>> staged;
+    std::unique_ptr<uint8_t, AlignedFree> staging;
+    if (direct_alignment_ > 0) {
+        if (offset % direct_alignment_ != 0) {
+            std::cerr << "Direct write offset " << offset
+                      << " is not aligned to " << direct_alignment_
+                      << " bytes" << std::endl;
+            return WriteStatus::Failed;
+        }
+        if (!is_aligned(buffers, direct_alignment_)) {
+            size_t nbytes = 0;
+            for (const auto& buffer : buffers) {
+                nbytes += buffer.size();
+            }
+            const size_t nbytes_aligned = align_size_(nbytes);
+
+            void* p = nullptr;
+            if (posix_memalign(&p,
+                               std::max(direct_alignment_, sizeof(void*)),
+                               nbytes_aligned) != 0) {
+                std::cerr << "Failed to allocate aligned memory" << std::endl;
+                return WriteStatus::Failed;
+            }
+            staging.reset(static_cast<uint8_t*>(p));
+
+            uint8_t* cur = staging.get();
+            for (const auto& buffer : buffers) {
+                if (!buffer.empty()) {
+                    memcpy(cur, buffer.data(), buffer.size());
+                }
+                cur += buffer.size();
+            }
+            memset(cur, 0, nbytes_aligned - nbytes);
+
+            staged.emplace_back(staging.get(), nbytes_aligned);
+        }
+    }
+    const auto& write_buffers = staged.empty() ? buffers : staged;
+
+    // pwritev rejects more than IOV_MAX vectors, so submit in batches; a
+    // rate-limited or bounded writer also caps each batch at a slice size,
+    // splitting buffers if need be, and a bounded one checks its bounds
+    // between batches. Direct writers slice on alignment boundaries.
+    const auto max_iovecs = static_cast<size_t>(IOV_MAX);
+    size_t slice_bytes =
+      bounds.bounded() ? std::min(slice_bytes_(), bounds.slice_bytes)
+                       : slice_bytes_();
+    if (direct_alignment_ > 0) {
+        slice_bytes = std::max(slice_bytes / direct_alignment_ *
+                                 direct_alignment_,
+                               direct_alignment_);
+    }
+
+    std::vector<struct iovec> iovecs;
+    iovecs.reserve(std::min(max_iovecs, write_buffers.size()));
+
+    size_t i = 0;
+    size_t consumed = 0; // bytes of write_buffers[i] already submitted
+    while (i < write_buffers.size()) {
+        if (i > 0 || consumed > 0) {
+            if (const auto status = bounds.check();
+                status != WriteStatus::Ok) {
+                return status;
+            }
+        }
+
+        iovecs.clear();
+        size_t total_bytes = 0;
+        while (i < write_buffers.size() && iovecs.size() < max_iovecs &&
+               total_bytes < slice_bytes) {
+            const size_t len = std::min(write_buffers[i].size() - consumed,
+                                        slice_bytes - total_bytes);
+
+            struct iovec iov;
+            iov.iov_base = const_cast<void*>(
+              static_cast<const void*>(write_buffers[i].data() + consumed));
+            iov.iov_len = len;
+            iovecs.push_back(iov);
+
+            total_bytes += len;
+            consumed += len;
+            if (consumed == write_buffers[i].size()) {
+                ++i;
+                consumed = 0;
+            }
+        }
 
-    for (auto i = 0; i < buffers.size(); ++i) {
-        auto *iov = &iovecs[i];
-        memset(iov, 0, sizeof(struct iovec));
-        iov->iov_base =
-                const_cast<void *>(static_cast<const void *>(buffers[i].data()));
-        iov->iov_len = buffers[i].size();
+        if (total_bytes == 0) {
+            continue; // only empty buffers; nothing to write
+        }
+        throttle_(total_bytes);
+        if (!write_iovecs_(iovecs, offset)) {
+            retval = false;
+            break;
+        }
+        offset += total_bytes;
     }
+#endif
+    return retval ? WriteStatus::Ok : WriteStatus::Failed;
+}
 
-    ssize_t total_bytes = 0;
-    for (const auto &buffer: buffers) {
-        total_bytes += static_cast<ssize_t>(buffer.size());
+#ifndef _WIN32
+bool
+zarr::VectorizedFileWriter::write_iovecs_(std::vector<struct iovec>& iovecs,
+                                          size_t offset) {
+    // pwritev may write less than asked (a signal, a filling disk, or more
+    // than 2 GiB on Linux), so resubmit the rest. Interrupted, refused and
+    // empty writes are retried with backoff a bounded number of times in a
+    // row, so a stuck device fails the write instead of hanging it.
+    const int max_stalls = 16;
+    const auto min_backoff = std::chrono::microseconds(100);
+    auto backoff = min_backoff;
+
+    // a write of 0 bytes is only a stall while there is something to write
+    size_t bytes_left = 0;
+    for (const auto& iov : iovecs) {
+        bytes_left += iov.iov_len;
     }
 
-    ssize_t bytes_written = pwritev(fd_,
-                                    iovecs.data(),
-                                    static_cast<int>(iovecs.size()),
-                                    static_cast<int>(offset));
+    size_t first = 0;
+    int stalls = 0;
+    while (bytes_left > 0) {
+        const auto bytes_written =
+          FaultInjector::pwritev(fd_,
+                                 iovecs.data() + first,
+                                 static_cast<int>(iovecs.size() - first),
+                                 static_cast<off_t>(offset));
+
+        if (bytes_written <= 0) {
+            const int error = bytes_written < 0 ? errno : 0;
+            const bool transient =
+              error == 0 || error == EINTR || error == EAGAIN;
+            if (!transient || ++stalls >= max_stalls) {
+                std::cerr << "Failed to write file: "
+                          << (error != 0 ? strerror(error)
+                                         : "no progress")
+                          << std::endl;
+                return false;
+            }
+            if (error != EINTR) {
+                std::this_thread::sleep_for(backoff);
+                backoff = std::min(2 * backoff,
+                                   std::chrono::microseconds(100000));
+            }
+            continue;
+        }
+
+        stalls = 0;
+        backoff = min_backoff;
+        offset += static_cast<size_t>(bytes_written);
+        bytes_left -= static_cast<size_t>(bytes_written);
 
-    if (bytes_written != total_bytes) {
-        std::cerr << "Failed to write file: " << get_last_error_as_string();
-        retval = false;
+        auto remaining = static_cast<size_t>(bytes_written);
+        while (first < iovecs.size() && remaining >= iovecs[first].iov_len) {
+            remaining -= iovecs[first].iov_len;
+            ++first;
+        }
+        if (remaining > 0) {
+            iovecs[first].iov_base =
+              static_cast<uint8_t*>(iovecs[first].iov_base) + remaining;
+            iovecs[first].iov_len -= remaining;
+        }
     }
-#endif
-    return retval;
+    return true;
 }
+#endif
 
 size_t
 zarr::VectorizedFileWriter::align_size_(size_t size) const {
-    size = align_to_page_(size);
 #ifdef _WIN32
+    size = align_to_page_(size);
     return (size + sector_size_ - 1) & ~(sector_size_ - 1);
 #else
-    return size;
+    if (direct_alignment_ == 0) {
+        return size;
+    }
+    return (size + direct_alignment_ - 1) / direct_alignment_ *
+           direct_alignment_;
 #endif
 }
 
 size_t
 zarr::VectorizedFileWriter::align_to_page_(size_t size) const {
     return (size + page_size_ - 1) & ~(page_size_ - 1);
-}
\ No newline at end of file
+}
+
+void
+zarr::VectorizedFileWriter::set_rate_limiter(RateLimiter* limiter) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    limiter_ = limiter;
+}
+
+size_t
+zarr::VectorizedFileWriter::slice_bytes_() const {
+    size_t slice_bytes = RateLimiter::global().slice_bytes();
+    if (limiter_ != nullptr) {
+        slice_bytes = std::min(slice_bytes, limiter_->slice_bytes());
+    }
+    return slice_bytes;
+}
+
+void
+zarr::VectorizedFileWriter::throttle_(size_t nbytes) {
+    // reserve from both limiters before sleeping, so their waits overlap
+    auto delay = RateLimiter::global().reserve(nbytes);
+    if (limiter_ != nullptr) {
+        delay = std::max(delay, limiter_->reserve(nbytes));
+    }
+    if (delay.count() > 0) {
+        std::this_thread::sleep_for(delay);
+    }
+}
@@ -1,5 +1,9 @@
 #pragma once
 
+#include "cancellation.token.hh"
+#include "device.probe.hh"
+#include "rate.limiter.hh"
+
 #include <cstdint>
 #include <mutex>
 #include <span>
@@ -15,28 +19,83 @@
 #endif
 
 namespace zarr {
+struct FileOpenOptions
+{
+    bool truncate = false;     // discard any existing contents
+    bool no_atime = false;     // Linux; ignored if not permitted
+    bool direct = false;       // POSIX; see VectorizedFileWriter
+    bool close_on_exec = true; // POSIX
+};
+
 class VectorizedFileWriter
 {
   public:
-    explicit VectorizedFileWriter(const std::string& path);
+    /// With @p options.direct, the page cache is bypassed (O_DIRECT, or
+    /// F_NOCACHE on macOS), and offsets must be aligned to
+    /// device().direct_io_alignment(). With O_DIRECT, a write whose buffers
+    /// are not aligned to it is copied to an aligned buffer first and
+    /// padded with zeros to a multiple of it, as every write is on Windows,
+    /// where writers always bypass the cache.
+    explicit VectorizedFileWriter(const std::string& path,
+                                  const FileOpenOptions& options = {});
     ~VectorizedFileWriter();
 
     bool write_vectors(const std::vector<std::vector<uint8_t>> &buffers,
                        size_t offset);
+    bool write_vectors(const std::vector<std::span<const uint8_t>> &buffers,
+                       size_t offset);
+
+    /// As above, stopping between slices of the write once @p bounds are
+    /// exceeded. A rate-limited writer checks between its own slices too.
+    WriteStatus write_vectors(
+      const std::vector<std::span<const uint8_t>> &buffers,
+      size_t offset,
+      const WriteBounds &bounds);
 
     std::mutex& mutex() { return mutex_; }
 
+    /// Capabilities of the storage the file is on, probed when it is
+    /// opened.
+    const DeviceInfo& device() const { return device_; }
+
+    /// Retarget the writer to @p path, e.g. the next shard, keeping its
+    /// rate limiter. The new file is opened before the current one is
+    /// closed, so if opening throws, the writer still targets the old file.
+    void reopen(const std::string& path,
+                const FileOpenOptions& options = {});
+
+    /// Set the file's length to @p nbytes, e.g. 0 to reuse the file for a
+    /// new shard without unlinking and recreating it.
+    bool truncate(size_t nbytes = 0);
+
+    /// Allocate the first @p nbytes of the file, extending it if need be,
+    /// so that later writes there allocate no blocks.
+    bool preallocate(size_t nbytes);
+
+    /// Throttle this writer through @p limiter, on top of
+    /// RateLimiter::global(), or stop throttling it if null. The limiter
+    /// must outlive the writer or be unset first.
+    void set_rate_limiter(RateLimiter* limiter);
+
   private:
     std::mutex mutex_;
     size_t page_size_;
+    RateLimiter* limiter_;
+    DeviceInfo device_;
 #ifdef _WIN32
     HANDLE handle_;
     size_t sector_size_;
 #else
     int fd_;
+    size_t direct_alignment_; // 0 unless opened with O_DIRECT
 #endif
 
     size_t align_size_(size_t size) const;
     size_t align_to_page_(size_t size) const;
+    size_t slice_bytes_() const;
+    void throttle_(size_t nbytes);
+#ifndef _WIN32
+    bool write_iovecs_(std::vector<struct iovec>& iovecs, size_t offset);
+#endif
 };
 } // namespace zarr
\ No newline at end of file
@@ -0,0 +1,278 @@
+#include "zip.store.writer.hh"
+
+#include <array>
+#include <cstring>
+#include <ctime>
+#include <filesystem>
+#include <iostream>
+
+namespace fs = std::filesystem;
+
+namespace {
+constexpr uint32_t local_header_signature = 0x04034b50;
+constexpr uint32_t central_header_signature = 0x02014b50;
+constexpr uint32_t zip64_end_signature = 0x06064b50;
+constexpr uint32_t zip64_locator_signature = 0x07064b50;
+constexpr uint32_t end_signature = 0x06054b50;
+
+constexpr uint16_t version_default = 20; // 2.0: stored entries, directories
+constexpr uint16_t version_zip64 = 45;
+constexpr uint16_t flag_utf8_name = 1 << 11;
+constexpr uint16_t zip64_extra_id = 0x0001;
+
+constexpr uint64_t max32 = 0xffffffff;
+constexpr uint64_t max16 = 0xffff;
+
+// 8 tables of 256 entries, for slicing-by-8: 8 input bytes per step
+std::array<std::array<uint32_t, 256>, 8>
+make_crc_tables() {
+    std::array<std::array<uint32_t, 256>, 8> tables{};
+    for (uint32_t i = 0; i < 256; ++i) {
+        uint32_t crc = i;
+        for (auto bit = 0; bit < 8; ++bit) {
+            crc = (crc >> 1) ^ (0xedb88320 & (0 - (crc & 1)));
+        }
+        tables[0][i] = crc;
+    }
+    for (uint32_t i = 0; i < 256; ++i) {
+        for (size_t t = 1; t < 8; ++t) {
+            const auto prev = tables[t - 1][i];
+            tables[t][i] = (prev >> 8) ^ tables[0][prev & 0xff];
+        }
+    }
+    return tables;
+}
+
+const auto crc_tables = make_crc_tables();
+
+// zip fields are little-endian, which is native on all our target platforms
+template<typename T>
+void
+put(std::vector<uint8_t>& out, T value) {
+    const auto pos = out.size();
+    out.resize(pos + sizeof(T));
+    memcpy(out.data() + pos, &value, sizeof(T));
+}
+
+void
+put(std::vector<uint8_t>& out, const std::string& value) {
+    out.insert(out.end(), value.begin(), value.end());
+}
+
+const std::string&
+replace_file(const std::string& path) {
+    std::error_code ec;
+    fs::remove(path, ec);
+    return path;
+}
+} // namespace
+
+uint32_t
+zarr::crc32(std::span<const uint8_t> data, uint32_t crc) {
+    const auto& t = crc_tables;
+    crc = ~crc;
+
+    const uint8_t* p = data.data();
+    size_t n = data.size();
+    while (n >= 8) {
+        uint32_t lo, hi;
+        memcpy(&lo, p, 4);
+        memcpy(&hi, p + 4, 4);
+        lo ^= crc;
+        crc = t[7][lo & 0xff] ^ t[6][(lo >> 8) & 0xff] ^
+              t[5][(lo >> 16) & 0xff] ^ t[4][lo >> 24] ^ t[3][hi & 0xff] ^
+              t[2][(hi >> 8) & 0xff] ^ t[1][(hi >> 16) & 0xff] ^
+              t[0][hi >> 24];
+        p += 8;
+        n -= 8;
+    }
+    while (n-- > 0) {
+        crc = (crc >> 8) ^ t[0][(crc ^ *p++) & 0xff];
+    }
+    return ~crc;
+}
+
+zarr::ZipStoreWriter::ZipStoreWriter(const std::string& path)
+  : writer_(replace_file(path))
+  , offset_(0)
+  , closed_(false)
+  , failed_(false) {
+    // entries carry the time the archive was created, in MS-DOS format
+    const auto now = std::time(nullptr);
+    const auto* local = std::localtime(&now);
+    dos_time_ = static_cast<uint16_t>(
+      (local->tm_hour << 11) | (local->tm_min << 5) | (local->tm_sec / 2));
+    dos_date_ = static_cast<uint16_t>(((local->tm_year - 80) << 9) |
+                                      ((local->tm_mon + 1) << 5) |
+                                      local->tm_mday);
+}
+
+zarr::ZipStoreWriter::~ZipStoreWriter() {
+    if (!closed_) {
+        close();
+    }
+}
+
+bool
+zarr::ZipStoreWriter::add(const std::string& name,
+                          const std::vector<std::vector<uint8_t>>& buffers) {
+    std::vector<std::span<const uint8_t>> spans(buffers.begin(), buffers.end());
+    return add(name, spans);
+}
+
+bool
+zarr::ZipStoreWriter::add(
+  const std::string& name,
+  const std::vector<std::span<const uint8_t>>& buffers) {
+    if (name.empty() || name.size() > max16) {
+        std::cerr << "Invalid zip entry name '" << name << "'" << std::endl;
+        return false;
+    }
+
+    uint64_t nbytes = 0;
+    uint32_t crc = 0;
+    for (const auto& buffer : buffers) {
+        nbytes += buffer.size();
+        crc = crc32(buffer, crc);
+    }
+
+    // sizes that don't fit move to a zip64 extra field
+    const bool zip64 = nbytes >= max32;
+    std::vector<uint8_t> header;
+    header.reserve(30 + name.size() + 20);
+    put<uint32_t>(header, local_header_signature);
+    put<uint16_t>(header, zip64 ? version_zip64 : version_default);
+    put<uint16_t>(header, flag_utf8_name);
+    put<uint16_t>(header, 0); // stored
+    put<uint16_t>(header, dos_time_);
+    put<uint16_t>(header, dos_date_);
+    put<uint32_t>(header, crc);
+    put<uint32_t>(header, zip64 ? max32 : nbytes); // compressed
+    put<uint32_t>(header, zip64 ? max32 : nbytes); // uncompressed
+    put<uint16_t>(header, name.size());
+    put<uint16_t>(header, zip64 ? 20 : 0);
+    put(header, name);
+    if (zip64) {
+        put<uint16_t>(header, zip64_extra_id);
+        put<uint16_t>(header, 16);
+        put<uint64_t>(header, nbytes);
+        put<uint64_t>(header, nbytes);
+    }
+
+    uint64_t offset;
+    {
+        std::scoped_lock lock(mutex_);
+        if (closed_) {
+            return false;
+        }
+        offset = offset_;
+        offset_ += header.size() + nbytes;
+        entries_.push_back({ name, crc, nbytes, offset });
+    }
+
+    std::vector<std::span<const uint8_t>> spans;
+    spans.reserve(buffers.size() + 1);
+    spans.emplace_back(header);
+    for (const auto& buffer : buffers) {
+        if (!buffer.empty()) {
+            spans.push_back(buffer);
+        }
+    }
+
+    if (!writer_.write_vectors(spans, offset)) {
+        std::scoped_lock lock(mutex_);
+        failed_ = true;
+        return false;
+    }
+    return true;
+}
+
+bool
+zarr::ZipStoreWriter::close() {
+    std::scoped_lock lock(mutex_);
+    if (closed_) {
+        return !failed_;
+    }
+    closed_ = true;
+
+    std::vector<uint8_t> directory;
+    for (const auto& entry : entries_) {
+        const bool zip64_size = entry.size >= max32;
+        const bool zip64_offset = entry.offset >= max32;
+        const uint16_t zip64_fields =
+          (zip64_size ? 16 : 0) + (zip64_offset ? 8 : 0);
+        const uint16_t version =
+          zip64_fields > 0 ? version_zip64 : version_default;
+
+        put<uint32_t>(directory, central_header_signature);
+        put<uint16_t>(directory, version_zip64); // made by
+        put<uint16_t>(directory, version);
+        put<uint16_t>(directory, flag_utf8_name);
+        put<uint16_t>(directory, 0); // stored
+        put<uint16_t>(directory, dos_time_);
+        put<uint16_t>(directory, dos_date_);
+        put<uint32_t>(directory, entry.crc32);
+        put<uint32_t>(directory, zip64_size ? max32 : entry.size);
+        put<uint32_t>(directory, zip64_size ? max32 : entry.size);
+        put<uint16_t>(directory, entry.name.size());
+        put<uint16_t>(directory, zip64_fields > 0 ? 4 + zip64_fields : 0);
+        put<uint16_t>(directory, 0); // comment length
+        put<uint16_t>(directory, 0); // disk number
+        put<uint16_t>(directory, 0); // internal attributes
+        put<uint32_t>(directory, 0); // external attributes
+        put<uint32_t>(directory, zip64_offset ? max32 : entry.offset);
+        put(directory, entry.name);
+        if (zip64_fields > 0) {
+            put<uint16_t>(directory, zip64_extra_id);
+            put<uint16_t>(directory, zip64_fields);
+            if (zip64_size) {
+                put<uint64_t>(directory, entry.size);
+                put<uint64_t>(directory, entry.size);
+            }
+            if (zip64_offset) {
+                put<uint64_t>(directory, entry.offset);
+            }
+        }
+    }
+
+    const uint64_t directory_offset = offset_;
+    const uint64_t directory_size = directory.size();
+    const uint64_t nentries = entries_.size();
+    const bool zip64 = nentries >= max16 || directory_offset >= max32 ||
+                       directory_size >= max32;
+
+    if (zip64) {
+        const uint64_t zip64_end_offset = directory_offset + directory_size;
+        put<uint32_t>(directory, zip64_end_signature);
+        put<uint64_t>(directory, 44); // size of the rest of this record
+        put<uint16_t>(directory, version_zip64); // made by
+        put<uint16_t>(directory, version_zip64);
+        put<uint32_t>(directory, 0); // this disk
+        put<uint32_t>(directory, 0); // disk with the central directory
+        put<uint64_t>(directory, nentries); // on this disk
+        put<uint64_t>(directory, nentries);
+        put<uint64_t>(directory, directory_size);
+        put<uint64_t>(directory, directory_offset);
+
+        put<uint32_t>(directory, zip64_locator_signature);
+        put<uint32_t>(directory, 0); // disk with the zip64 end record
+        put<uint64_t>(directory, zip64_end_offset);
+        put<uint32_t>(directory, 1); // total disks
+    }
+
+    put<uint32_t>(directory, end_signature);
+    put<uint16_t>(directory, 0); // this disk
+    put<uint16_t>(directory, 0); // disk with the central directory
+    put<uint16_t>(directory, zip64 ? max16 : nentries); // on this disk
+    put<uint16_t>(directory, zip64 ? max16 : nentries);
+    put<uint32_t>(directory, zip64 ? max32 : directory_size);
+    put<uint32_t>(directory, zip64 ? max32 : directory_offset);
+    put<uint16_t>(directory, 0); // comment length
+
+    const std::vector<std::span<const uint8_t>> spans{ directory };
+    if (!writer_.write_vectors(spans, directory_offset)) {
+        failed_ = true;
+    }
+    offset_ += directory.size();
+    return !failed_;
+}
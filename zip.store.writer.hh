@@ -0,0 +1,75 @@
+#pragma once
+
+#include "vectorized.file.writer.hh"
+
+#include <cstdint>
+#include <mutex>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace zarr {
+/**
+ * @brief Writes a zarr ZipStore directly: one stored (uncompressed) zip
+ * entry per key, in a single pass.
+ *
+ * Each entry's local header and data go out with a single vectored write,
+ * without copying the data. The central directory is built in memory as
+ * entries are added and written once, with the end records, by close().
+ * Zip64 records are used only when an entry, the archive or the number of
+ * entries outgrows the classic format.
+ *
+ * Entries may be added from several threads; each reserves its own range of
+ * the file. close() must not overlap add().
+ */
+class ZipStoreWriter
+{
+  public:
+    /// Replaces any existing file at @p path.
+    explicit ZipStoreWriter(const std::string& path);
+
+    /// Closes the archive if close() has not been called.
+    ~ZipStoreWriter();
+
+    ZipStoreWriter(const ZipStoreWriter&) = delete;
+    ZipStoreWriter& operator=(const ZipStoreWriter&) = delete;
+
+    /// Add the entry @p name, whose contents are @p buffers concatenated.
+    /// Returns false if the write failed or the archive is closed.
+    bool add(const std::string& name,
+             const std::vector<std::vector<uint8_t>>& buffers);
+    bool add(const std::string& name,
+             const std::vector<std::span<const uint8_t>>& buffers);
+
+    /// Write the central directory and end records.
+    bool close();
+
+    size_t nentries() const { return entries_.size(); }
+
+    /// Bytes in the archive so far, including the end records once closed.
+    uint64_t size() const { return offset_; }
+
+  private:
+    struct Entry
+    {
+        std::string name;
+        uint32_t crc32;
+        uint64_t size;
+        uint64_t offset; // of the local header
+    };
+
+    VectorizedFileWriter writer_;
+    uint16_t dos_time_;
+    uint16_t dos_date_;
+
+    std::mutex mutex_;
+    std::vector<Entry> entries_;
+    uint64_t offset_;
+    bool closed_;
+    bool failed_;
+};
+
+/// CRC-32 (the zip/gzip polynomial) of @p data, continuing from @p crc.
+uint32_t
+crc32(std::span<const uint8_t> data, uint32_t crc = 0);
+} // namespace zarr